@@ -1,6 +1,7 @@
 #include "../common/ocArgumentParser.h"
 #include "../common/ocCommon.h"
 #include "../common/ocConfigFileReader.h"
+#include "../common/ocFramePool.h"
 #include "../common/ocIpcSocket.h"
 #include "../common/ocLogger.h"
 #include "../common/ocMember.h"
@@ -150,9 +151,10 @@ int main(int argc, const char **argv)
     member.attach();
 
     ocIpcSocket *socket = member.get_socket();
-    ocSharedMemory *shared_memory = member.get_shared_memory();
+    ocFramePool *frame_pool = member.get_frame_pool();
     ocLogger *logger = member.get_logger();
 
+    frame_pool || die();
     read_config_file(&settings, logger) || die();
     read_cmd_params(argc, argv, &settings, logger) || die();
 
@@ -176,7 +178,7 @@ int main(int argc, const char **argv)
     socket->send_packet(ipc_packet);
 
     ocCamera cam;
-    while (!cam.init(settings, shared_memory->cam_data, OC_NUM_CAM_BUFFERS))
+    while (!cam.init(settings, frame_pool))
     {
         logger->warn("main(): Retrying in 3 Seconds...");
         usleep(1000 * 1000 * 3);
@@ -196,8 +198,9 @@ int main(int argc, const char **argv)
     float expected_framerate = cam.get_expected_framerate();
     while (running)
     {
+        cam.unlock_free_buffers();
+        // The driver writes into the active buffer while we wait for it.
         uint32_t index = cam.get_image_index();
-        shared_memory->cam_data[index].frame_number = 0;
 
         bool ret_camera = cam.read_frame();
         TIMED_BLOCK("check frame");
@@ -222,21 +225,21 @@ int main(int argc, const char **argv)
             current_second = now.get_seconds();
         }
 
-        if (ret_camera)
+        if (ret_camera && index < OC_NUM_CAM_BUFFERS && cam.lock_buffer(index))
         {
             ocTime   frame_time   = cam.get_image_time();
             uint32_t frame_number = cam.get_image_number();
 
-            shared_memory->cam_data[index].frame_time   = frame_time;
-            shared_memory->cam_data[index].frame_number = frame_number;
-            shared_memory->last_written_cam_data_index  = index;
+            ocFrame *frame = cam.get_frame(index);
+            frame->frame_time   = frame_time;
+            frame->frame_number = frame_number;
+            frame_pool->publish(frame, ocImageType::Cam);
 
             ipc_packet.set_message_id(ocMessageId::Camera_Image_Available);
             ipc_packet.clear_and_edit()
                 .write<ocTime>(frame_time)
                 .write<uint32_t>(frame_number)
-                .write<ptrdiff_t>((std::byte *)&shared_memory->cam_data[index] - (std::byte *)shared_memory) // offsetof doesn't work here, because the index isn't constexpr.
-                .write<size_t>(sizeof(shared_memory->cam_data[index]));
+                .write<ocFrameHandle>(frame_pool->get_handle(frame));
             socket->send_packet(ipc_packet);
 
             ++fps_count;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../common/ocFramePool.h"
 #include "../common/ocProfiler.h"
 #include "../common/ocTime.h"
 #include "../common/ocTypes.h" // ocPixelLayout
@@ -32,6 +33,11 @@ private:
 
     HIDS _device;
     int32_t  _pids[OC_NUM_CAM_BUFFERS];
+    // The driver writes straight into these frame pool slots. We keep our
+    // reference to them for as long as the camera runs.
+    ocFramePool *_frame_pool = nullptr;
+    ocFrame     *_frames[OC_NUM_CAM_BUFFERS] = {};
+    bool         _locked[OC_NUM_CAM_BUFFERS] = {};
     uint32_t _width = 0;
     uint32_t _height = 0;
     ocCameraSettings _settings;
@@ -284,9 +290,10 @@ public:
 
     bool init(
         ocCameraSettings settings,
-        ocCamData *cam_data,
-        int32_t cam_data_count)
+        ocFramePool *frame_pool)
     {
+        _frame_pool = frame_pool;
+
         int ret_val;
 
         int num_cameras;
@@ -338,16 +345,24 @@ public:
         uint32_t pixel_bytes = bytes_per_pixel(pixel_format);
         uint32_t memory_size = _width * _height * pixel_bytes;
 
-        if (OC_CAM_BUFFER_SIZE < memory_size)
+        // Make the image memory from the frame pool known to the camera driver
+        for (int i = 0; i < OC_NUM_CAM_BUFFERS; ++i)
         {
-            _logger.error("Error: Camera image is larger than the space in the shared memory!");
-            return false;
-        }
+            // the slots from an earlier attempt may be too small now
+            if (_frames[i] && _frames[i]->capacity < memory_size)
+            {
+                _frame_pool->release(_frames[i]);
+                _frames[i] = nullptr;
+            }
+            if (!_frames[i]) _frames[i] = _frame_pool->acquire_for_write(memory_size);
+            if (!_frames[i])
+            {
+                _logger.error("Error: No room for a camera image of %u bytes in the frame pool!", memory_size);
+                return false;
+            }
+            _locked[i] = false;
 
-        // Make the image memory from the shared memory known to the camera driver
-        for (int i = 0; i < cam_data_count; ++i)
-        {
-            char *memory = (char *)cam_data[i].img_buffer;
+            char *memory = (char *)_frame_pool->get_data(_frames[i]);
             mlock(memory, memory_size);
 
             ret_val = is_SetAllocatedImageMem(_device, (int)_width, (int)_height, (int)pixel_bytes * 8, memory, &_pids[i]);
@@ -369,9 +384,9 @@ public:
                 return false;
             }
 
-            cam_data[i].width  = _width;
-            cam_data[i].height = _height;
-            cam_data[i].pixel_format = pixel_format;
+            _frames[i]->width  = _width;
+            _frames[i]->height = _height;
+            _frames[i]->pixel_format = pixel_format;
         }
 
         if (!set_framerate(settings.frame_rate)) return false;
@@ -449,6 +464,43 @@ public:
         return true;
     }
 
+    ocFrame *get_frame(uint32_t index) const
+    {
+        return _frames[index];
+    }
+
+    /**
+     * A published frame may still be read by others, so we lock its buffer
+     * and the driver skips it. Once nobody but us holds a reference anymore,
+     * the slot gets a new generation and the driver may fill it again.
+     */
+    bool lock_buffer(uint32_t index)
+    {
+        int ret = is_LockSeqBuf(_device, _pids[index], (char *)_frame_pool->get_data(_frames[index]));
+        if (ret != IS_SUCCESS)
+        {
+            _logger.error("is_LockSeqBuf ERROR: %i in buffer %u", ret, index);
+            return false;
+        }
+        _locked[index] = true;
+        return true;
+    }
+
+    void unlock_free_buffers()
+    {
+        for (uint32_t i = 0; i < OC_NUM_CAM_BUFFERS; ++i)
+        {
+            if (!_locked[i] || !_frame_pool->recycle(_frames[i])) continue;
+            int ret = is_UnlockSeqBuf(_device, _pids[i], (char *)_frame_pool->get_data(_frames[i]));
+            if (ret != IS_SUCCESS)
+            {
+                _logger.error("is_UnlockSeqBuf ERROR: %i in buffer %u", ret, i);
+                continue;
+            }
+            _locked[i] = false;
+        }
+    }
+
     int set_parameter(int32_t param_id, double val1, double val2)
     {
         return is_SetAutoParameter(_device, param_id, &val1, &val2);
@@ -1,15 +1,19 @@
 #include "ocCanGateway.h"
+#include "../common/ocHistogram.h"
 #include "../common/ocLogger.h"
 #include "../common/ocMember.h"
 #include "../common/ocPollEngine.h"
 #include "../common/ocProfiler.h"
 #include "../common/ocTypes.h"
 
+// Driving tasks between two reports of their latency.
+#define LATENCY_REPORT_COUNT 500
+
 int32_t main()
 {
     // create and init the ocMember we use to communicate with other processes
     ocMember member(ocMemberId::Can_Gateway, "CAN Gateway");
-    member.attach();
+    member.attach(ocIpcTransport::Shared_Memory_Ring);
 
     ocIpcSocket *ipc_socket = member.get_socket();
     ocLogger *logger = member.get_logger();
@@ -33,6 +37,10 @@ int32_t main()
 
     ocPacket time_packet(ocMessageId::Timing_Events);
 
+    // ms from the exposure of a camera frame until the driving task computed
+    // from it goes out on the CAN bus
+    ocHistogram task_latency(0.5f, 400);
+
     // create a poll engine with which we can wait for any communication to occur
     ocPollEngine pe(2);
     pe.add_fd(gateway.get_socket());
@@ -105,6 +113,20 @@ int32_t main()
                         ipc_socket->send(ocMessageId::Can_Frame_Transmitted, can_frame[i]);
                     }
                 }
+
+                ocStartDrivingTask task;
+                if (0 < num_frames && ipc_packet[0].read(&task) && ocTime::null() != task.frame_time)
+                {
+                    task_latency.add((ocTime::now() - task.frame_time).get_float_milliseconds());
+                    if (LATENCY_REPORT_COUNT <= task_latency.get_count())
+                    {
+                        logger->log("Frame to CAN latency of %llu tasks: mean %.1f ms, p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms",
+                                    (unsigned long long)task_latency.get_count(), task_latency.get_mean(),
+                                    task_latency.get_percentile(0.5f), task_latency.get_percentile(0.9f),
+                                    task_latency.get_percentile(0.99f), task_latency.get_max());
+                        task_latency.clear();
+                    }
+                }
             }
             if (ipc_packet[0].get_message_id() == ocMessageId::Request_Timing_Sites)
             {
@@ -215,14 +215,15 @@ int ocCanGateway::ipc_to_can(const ocPacket *packet, ocCanFrame *frame)
         } break;
         case ocMessageId::Start_Driving_Task:
         {
+            ocStartDrivingTask task;
+            if (!packet->read(&task)) return 0;
             frame->clear();
             frame->id = ocCanId::Set_Task;
-            int16_t speed = reader.read<int16_t>();
-            frame->write<int8_t>((int8_t)(speed / 4)); // speed
-            frame->write<int8_t>(reader.read<int8_t>()); // steering front
-            frame->write<int8_t>(reader.read<int8_t>()); // steering rear
-            frame->write<uint8_t>(reader.read<uint8_t>()); // id
-            frame->write<int32_t>(reader.read<int32_t>() - _steps_times_4 / 4); // steps // TODO: serious sam should get the absolute steps
+            frame->write<int8_t>((int8_t)(task.speed / 4)); // speed
+            frame->write<int8_t>(task.steering_front); // steering front
+            frame->write<int8_t>(task.steering_rear); // steering rear
+            frame->write<uint8_t>(task.id); // id
+            frame->write<int32_t>(task.steps_ab - _steps_times_4 / 4); // steps // TODO: serious sam should get the absolute steps
         } break;
         default:
         {
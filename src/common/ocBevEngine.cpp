@@ -0,0 +1,396 @@
+#include "ocBevEngine.h"
+#include "ocAssert.h"
+#include "ocProfiler.h"
+
+#include <algorithm> // std::min, std::max
+#include <functional>
+#include <cmath> // floor, exp, lround
+#include <cstring> // memset
+
+// Output pixels are rendered in square tiles. Neighbouring output pixels of a
+// tile read neighbouring camera pixels, no matter in which direction the
+// perspective stretches the image. A band is one row of tiles.
+static constexpr uint32_t TILE_SIZE = 32;
+
+ocBevEngine::ocBevEngine(float reference_width, float reference_height) :
+    _reference_width(reference_width),
+    _reference_height(reference_height)
+{
+    oc_assert(0.0f < reference_width && 0.0f < reference_height);
+}
+
+uint32_t ocBevEngine::add_view(const double bev_to_reference[9], uint32_t width, uint32_t height, uint32_t blur_size)
+{
+    oc_assert(0 < width && 0 < height, width, height);
+    oc_assert(width <= UINT16_MAX && height <= UINT16_MAX, width, height);
+    oc_assert(0 == blur_size || 1 == blur_size % 2, blur_size);
+
+    ocBevView view = {};
+    for (int i = 0; i < 9; ++i) view.bev_to_reference[i] = bev_to_reference[i];
+    view.width = width;
+    view.height = height;
+    view.blur_size = blur_size;
+
+    if (1 < blur_size)
+    {
+        // Same sigma as OpenCV picks for a kernel size without a sigma.
+        double sigma = 0.3 * ((double)(blur_size - 1) * 0.5 - 1.0) + 0.8;
+        int32_t radius = (int32_t)blur_size / 2;
+        std::vector<double> weights(blur_size);
+        double sum = 0.0;
+        for (int32_t i = -radius; i <= radius; ++i)
+        {
+            weights[(size_t)(i + radius)] = exp(-(double)(i * i) / (2.0 * sigma * sigma));
+            sum += weights[(size_t)(i + radius)];
+        }
+        view.blur_kernel.resize(blur_size);
+        int32_t total = 0;
+        for (size_t i = 0; i < blur_size; ++i)
+        {
+            view.blur_kernel[i] = (uint16_t)lround(weights[i] / sum * 256.0);
+            total += view.blur_kernel[i];
+        }
+        // rounding errors go to the center, so the kernel keeps the brightness
+        view.blur_kernel[(size_t)radius] = (uint16_t)(view.blur_kernel[(size_t)radius] + 256 - total);
+    }
+
+    _views.push_back(std::move(view));
+
+    uint32_t view_index = (uint32_t)(_views.size() - 1);
+    for (uint32_t row = 0; row < height; row += TILE_SIZE)
+    {
+        _bands.push_back({view_index, row, std::min(row + TILE_SIZE, height)});
+    }
+    set_region(view_index, nullptr, 0);
+    return view_index;
+}
+
+void ocBevEngine::_collect_runs(const std::vector<uint8_t> &mask, uint32_t width, uint32_t height, ocBevPixels *pixels)
+{
+    pixels->runs.clear();
+    pixels->first_run.resize(height + 1);
+    uint32_t sample_count = 0;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        pixels->first_run[y] = (uint32_t)pixels->runs.size();
+        const uint8_t *row = &mask[(size_t)y * width];
+        uint32_t x = 0;
+        while (x < width)
+        {
+            while (x < width && !row[x]) ++x;
+            if (width == x) break;
+            uint32_t begin = x;
+            while (x < width && row[x]) ++x;
+            pixels->runs.push_back({(uint16_t)begin, (uint16_t)x, sample_count});
+            sample_count += x - begin;
+        }
+    }
+    pixels->first_run[height] = (uint32_t)pixels->runs.size();
+    pixels->pixel_count = sample_count;
+}
+
+void ocBevEngine::set_region(uint32_t view_index, const ocBevSpan *spans, size_t span_count)
+{
+    oc_assert(view_index < _views.size(), view_index);
+    ocBevView &view = _views[view_index];
+    const uint32_t width = view.width;
+    const uint32_t height = view.height;
+
+    std::vector<uint8_t> mask((size_t)width * height, 0 == span_count ? 1 : 0);
+    for (size_t i = 0; i < span_count; ++i)
+    {
+        const ocBevSpan &span = spans[i];
+        if (height <= span.y) continue;
+        uint32_t begin = std::min<uint32_t>(span.x_begin, width);
+        uint32_t end = std::min<uint32_t>(span.x_end, width);
+        if (begin < end) memset(&mask[(size_t)span.y * width + begin], 1, end - begin);
+    }
+    _collect_runs(mask, width, height, &view.output);
+
+    // The vertical blur pass reads the rows around every output pixel and the
+    // horizontal pass the columns around those.
+    int32_t radius = (int32_t)view.blur_size / 2;
+    if (0 < radius)
+    {
+        std::vector<uint8_t> grown((size_t)width * height, 0);
+        for (int32_t y = 0; y < (int32_t)height; ++y)
+        {
+            int32_t top = std::max(y - radius, 0);
+            int32_t bottom = std::min(y + radius, (int32_t)height - 1);
+            for (int32_t from = top; from <= bottom; ++from)
+            {
+                const uint8_t *src = &mask[(size_t)from * width];
+                uint8_t *dst = &grown[(size_t)y * width];
+                for (uint32_t x = 0; x < width; ++x) dst[x] |= src[x];
+            }
+        }
+        _collect_runs(grown, width, height, &view.blurred);
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t *src = &grown[(size_t)y * width];
+            uint8_t *dst = &mask[(size_t)y * width];
+            memset(dst, 0, width);
+            for (int32_t x = 0; x < (int32_t)width; ++x)
+            {
+                if (!src[x]) continue;
+                int32_t left = std::max(x - radius, 0);
+                int32_t right = std::min(x + radius, (int32_t)width - 1);
+                memset(&dst[left], 1, (size_t)(right - left + 1));
+            }
+        }
+        _collect_runs(mask, width, height, &view.rendered);
+    }
+    else
+    {
+        view.blurred = view.output;
+        view.rendered = view.output;
+    }
+
+    if (0 < _image_width) _build_samples(view);
+}
+
+size_t ocBevEngine::get_rendered_pixel_count(uint32_t view_index) const
+{
+    oc_assert(view_index < _views.size(), view_index);
+    return _views[view_index].rendered.pixel_count;
+}
+
+void ocBevEngine::_build_samples(ocBevView &view)
+{
+    oc_assert(2 <= _image_width && 2 <= _image_height, _image_width, _image_height);
+
+    const double *m = view.bev_to_reference;
+    double scale_x = (double)_image_width / (double)_reference_width;
+    double scale_y = (double)_image_height / (double)_reference_height;
+    double max_x = (double)(_image_width - 1);
+    double max_y = (double)(_image_height - 1);
+
+    const ocBevPixels &rendered = view.rendered;
+    view.samples.resize(rendered.pixel_count);
+    // The runs are in row order, so the samples are in the same order.
+    ocBevSample *sample = view.samples.data();
+    for (uint32_t v = 0; v < view.height; ++v)
+    {
+        for (uint32_t r = rendered.first_run[v]; r < rendered.first_run[v + 1]; ++r)
+        {
+            const ocBevRun &run = rendered.runs[r];
+            for (uint32_t u = run.x_begin; u < run.x_end; ++u, ++sample)
+            {
+                double w = m[6] * u + m[7] * v + m[8];
+                double x = (m[0] * u + m[1] * v + m[2]) / w * scale_x;
+                double y = (m[3] * u + m[4] * v + m[5]) / w * scale_y;
+                if (!(0.0 <= x && x <= max_x && 0.0 <= y && y <= max_y))
+                {
+                    *sample = {-1, 0, 0};
+                    continue;
+                }
+                // The right and bottom neighbours always have to exist, so the
+                // last column and row are sampled from one pixel further in.
+                double x0 = std::min(floor(x), max_x - 1.0);
+                double y0 = std::min(floor(y), max_y - 1.0);
+                sample->index = (int32_t)y0 * (int32_t)_image_width + (int32_t)x0;
+                sample->weight_x = (uint16_t)lround((x - x0) * 256.0);
+                sample->weight_y = (uint16_t)lround((y - y0) * 256.0);
+            }
+        }
+    }
+}
+
+template<ocPixelFormat Format>
+static uint32_t gray_at(const uint8_t *image, int32_t index)
+{
+    if constexpr (ocPixelFormat::Gray_U8 == Format)
+    {
+        return image[index];
+    }
+    else
+    {
+        const uint8_t *p = &image[(size_t)index * (ocPixelFormat::Bgr_U8 == Format ? 3 : 4)];
+        return gray_from_bgr(p[0], p[1], p[2]);
+    }
+}
+
+template<ocPixelFormat Format>
+void ocBevEngine::_render(const ocBevView &view, const ocBevBand &band, const uint8_t *image, uint8_t *output)
+{
+    const int32_t stride = (int32_t)_image_width;
+    const ocBevPixels &rendered = view.rendered;
+    for (uint32_t tile_x = 0; tile_x < view.width; tile_x += TILE_SIZE)
+    {
+        uint32_t end_x = std::min(tile_x + TILE_SIZE, view.width);
+        for (uint32_t v = band.row_begin; v < band.row_end; ++v)
+        {
+            uint8_t *row = &output[(size_t)v * view.width];
+            for (uint32_t r = rendered.first_run[v]; r < rendered.first_run[v + 1]; ++r)
+            {
+                const ocBevRun &run = rendered.runs[r];
+                uint32_t begin = std::max<uint32_t>(run.x_begin, tile_x);
+                uint32_t end = std::min<uint32_t>(run.x_end, end_x);
+                for (uint32_t u = begin; u < end; ++u)
+                {
+                    const ocBevSample &sample = view.samples[run.first_sample + (u - run.x_begin)];
+                    if (sample.index < 0)
+                    {
+                        row[u] = 0;
+                        continue;
+                    }
+                    uint32_t wx = sample.weight_x;
+                    uint32_t wy = sample.weight_y;
+                    uint32_t top = gray_at<Format>(image, sample.index) * (256 - wx) +
+                                   gray_at<Format>(image, sample.index + 1) * wx;
+                    uint32_t bottom = gray_at<Format>(image, sample.index + stride) * (256 - wx) +
+                                      gray_at<Format>(image, sample.index + stride + 1) * wx;
+                    row[u] = (uint8_t)((top * (256 - wy) + bottom * wy + (1 << 15)) >> 16);
+                }
+            }
+        }
+    }
+}
+
+// Mirrors indices at the border without repeating the border pixel, like
+// OpenCV's default BORDER_REFLECT_101.
+static int32_t reflect(int32_t i, int32_t length)
+{
+    if (i < 0) return -i;
+    if (length <= i) return 2 * length - 2 - i;
+    return i;
+}
+
+void ocBevEngine::_blur_horizontal(ocBevView &view, const ocBevBand &band, const uint8_t *output)
+{
+    const int32_t width = (int32_t)view.width;
+    const int32_t radius = (int32_t)view.blur_size / 2;
+    const uint16_t *kernel = view.blur_kernel.data();
+
+    // Keeps 8 fractional bits, so the result is only rounded once after the
+    // vertical pass.
+    const ocBevPixels &blurred = view.blurred;
+    for (int32_t y = (int32_t)band.row_begin; y < (int32_t)band.row_end; ++y)
+    {
+        const uint8_t *src = &output[y * width];
+        uint16_t *dst = &view.blur_rows[(size_t)(y * width)];
+        for (uint32_t r = blurred.first_run[y]; r < blurred.first_run[y + 1]; ++r)
+        {
+            for (int32_t x = blurred.runs[r].x_begin; x < blurred.runs[r].x_end; ++x)
+            {
+                uint32_t sum = 0;
+                if (radius <= x && x < width - radius)
+                {
+                    for (int32_t k = -radius; k <= radius; ++k) sum += src[x + k] * kernel[k + radius];
+                }
+                else
+                {
+                    for (int32_t k = -radius; k <= radius; ++k) sum += src[reflect(x + k, width)] * kernel[k + radius];
+                }
+                dst[x] = (uint16_t)sum;
+            }
+        }
+    }
+}
+
+void ocBevEngine::_blur_vertical(ocBevView &view, const ocBevBand &band, uint8_t *output)
+{
+    const int32_t width = (int32_t)view.width;
+    const int32_t height = (int32_t)view.height;
+    const int32_t radius = (int32_t)view.blur_size / 2;
+    const uint16_t *kernel = view.blur_kernel.data();
+
+    const ocBevPixels &pixels = view.output;
+    for (int32_t y = (int32_t)band.row_begin; y < (int32_t)band.row_end; ++y)
+    {
+        uint8_t *dst = &output[y * width];
+        for (uint32_t r = pixels.first_run[y]; r < pixels.first_run[y + 1]; ++r)
+        {
+            for (int32_t x = pixels.runs[r].x_begin; x < pixels.runs[r].x_end; ++x)
+            {
+                uint32_t sum = 0;
+                for (int32_t k = -radius; k <= radius; ++k)
+                {
+                    sum += view.blur_rows[(size_t)(reflect(y + k, height) * width + x)] * kernel[k + radius];
+                }
+                dst[x] = (uint8_t)((sum + (1 << 15)) >> 16);
+            }
+        }
+    }
+}
+
+bool ocBevEngine::render(
+    ocPixelFormat pixel_format,
+    const void *image,
+    uint32_t image_width,
+    uint32_t image_height,
+    uint8_t *const *outputs,
+    ocWorkerPool *pool)
+{
+    oc_assert(image && outputs);
+
+    void (ocBevEngine::*render_band)(const ocBevView&, const ocBevBand&, const uint8_t*, uint8_t*);
+    switch (pixel_format)
+    {
+        case ocPixelFormat::Gray_U8: render_band = &ocBevEngine::_render<ocPixelFormat::Gray_U8>; break;
+        case ocPixelFormat::Bgr_U8:  render_band = &ocBevEngine::_render<ocPixelFormat::Bgr_U8>; break;
+        case ocPixelFormat::Bgra_U8: render_band = &ocBevEngine::_render<ocPixelFormat::Bgra_U8>; break;
+        default: return false;
+    }
+
+    if (image_width != _image_width || image_height != _image_height)
+    {
+        _image_width = image_width;
+        _image_height = image_height;
+        for (ocBevView &view : _views) _build_samples(view);
+    }
+
+    // The blur of a band needs the rows around it, so every pass has to be
+    // done for all bands before the next one starts.
+    auto run = [&](const std::function<void(uint32_t)> &task)
+    {
+        if (pool) pool->run((uint32_t)_bands.size(), task);
+        else for (uint32_t i = 0; i < (uint32_t)_bands.size(); ++i) task(i);
+    };
+
+    // Each pass is timed as a whole on the calling thread, it waits for the
+    // workers anyway.
+    const uint8_t *pixels = (const uint8_t *)image;
+    {
+        TIMED_BLOCK("BEV lookup table remap");
+        run([&](uint32_t i)
+        {
+            const ocBevBand &band = _bands[i];
+            (this->*render_band)(_views[band.view], band, pixels, outputs[band.view]);
+        });
+    }
+
+    bool any_blur = false;
+    for (ocBevView &view : _views)
+    {
+        if (1 < view.blur_size)
+        {
+            oc_assert((int32_t)view.blur_size / 2 < (int32_t)std::min(view.width, view.height), view.blur_size);
+            view.blur_rows.resize((size_t)view.width * view.height);
+            any_blur = true;
+        }
+    }
+    if (any_blur)
+    {
+        {
+            TIMED_BLOCK("BEV horizontal blur");
+            run([&](uint32_t i)
+            {
+                const ocBevBand &band = _bands[i];
+                ocBevView &view = _views[band.view];
+                if (1 < view.blur_size) _blur_horizontal(view, band, outputs[band.view]);
+            });
+        }
+        {
+            TIMED_BLOCK("BEV vertical blur");
+            run([&](uint32_t i)
+            {
+                const ocBevBand &band = _bands[i];
+                ocBevView &view = _views[band.view];
+                if (1 < view.blur_size) _blur_vertical(view, band, outputs[band.view]);
+            });
+        }
+    }
+    return true;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "ocImageOps.h" // ocPixelFormat
+#include "ocTypes.h" // ocBevSpan
+#include "ocWorkerPool.h"
+
+#include <cstddef> // size_t
+#include <cstdint> // _t types
+#include <vector>
+
+/**
+ * Renders birds eye views straight from full resolution camera frames. The
+ * source position of every output pixel is computed once per view and kept
+ * in a table, after that a frame only costs one lookup and one bilinear
+ * sample per output pixel. Camera pixels are converted to gray while they are
+ * sampled, so there is no intermediate gray or downscaled image. The tables
+ * are rebuilt whenever the camera resolution changes.
+ *
+ * The homographies are relative to a reference size of the camera image, the
+ * size the perspective points were measured in. A view can also blur its
+ * output, which happens right after rendering while it is still in the cache.
+ *
+ * A view can be restricted to a region, then the table only holds the pixels
+ * of the region and the ones its blur reads. Everything else is skipped.
+ *
+ * With a worker pool, all views are split into bands of rows that are
+ * rendered and blurred concurrently.
+ */
+class ocBevEngine final
+{
+private:
+    struct ocBevSample
+    {
+        // index of the top left source pixel, -1 if it lies outside the image
+        int32_t  index;
+        // weights of the right and bottom neighbours, from 0 to 256
+        uint16_t weight_x;
+        uint16_t weight_y;
+    };
+
+    // Pixels from x_begin up to x_end of one row. first_sample is the index
+    // of the sample of x_begin, if the run belongs to the rendered pixels.
+    struct ocBevRun
+    {
+        uint16_t x_begin;
+        uint16_t x_end;
+        uint32_t first_sample;
+    };
+
+    // The pixels a pass works on, as runs per row. The runs of row y are
+    // runs[first_run[y]] up to runs[first_run[y + 1]].
+    struct ocBevPixels
+    {
+        std::vector<ocBevRun> runs;
+        std::vector<uint32_t> first_run;
+        uint32_t              pixel_count = 0;
+    };
+
+    struct ocBevView
+    {
+        double   bev_to_reference[9];
+        uint32_t width;
+        uint32_t height;
+        // Gaussian blur with sigma 0 like cv::GaussianBlur, 0 is no blur
+        uint32_t blur_size;
+        // the region and what the two blur passes read around it
+        ocBevPixels output;
+        ocBevPixels blurred;
+        ocBevPixels rendered;
+        // one sample per rendered pixel, in the order of the runs
+        std::vector<ocBevSample> samples;
+        // fixed point kernel, the weights add up to 256
+        std::vector<uint16_t> blur_kernel;
+        // result of the horizontal blur pass, with 8 fractional bits
+        std::vector<uint16_t> blur_rows;
+    };
+
+    struct ocBevBand
+    {
+        uint32_t view;
+        uint32_t row_begin;
+        uint32_t row_end;
+    };
+
+    float    _reference_width;
+    float    _reference_height;
+    uint32_t _image_width  = 0;
+    uint32_t _image_height = 0;
+    std::vector<ocBevView> _views;
+    std::vector<ocBevBand> _bands;
+
+    static void _collect_runs(const std::vector<uint8_t> &mask, uint32_t width, uint32_t height, ocBevPixels *pixels);
+
+    void _build_samples(ocBevView &view);
+
+    template<ocPixelFormat Format>
+    void _render(const ocBevView &view, const ocBevBand &band, const uint8_t *image, uint8_t *output);
+
+    void _blur_horizontal(ocBevView &view, const ocBevBand &band, const uint8_t *output);
+    void _blur_vertical(ocBevView &view, const ocBevBand &band, uint8_t *output);
+
+public:
+    ocBevEngine(float reference_width, float reference_height);
+
+    /**
+     * Adds a view and returns its index. The homography maps output pixels to
+     * pixels of the reference image, row major like the data of a cv::Mat. So
+     * it is the inverse of what cv::warpPerspective gets. blur_size has to be
+     * odd or 0.
+     */
+    uint32_t add_view(const double bev_to_reference[9], uint32_t width, uint32_t height, uint32_t blur_size = 0);
+
+    /**
+     * Restricts a view to the pixels covered by the given spans, they may
+     * overlap. Without spans the whole view is rendered again. Outside of the
+     * region the output is left in an undefined state.
+     */
+    void set_region(uint32_t view, const ocBevSpan *spans, size_t span_count);
+
+    // Number of pixels that are sampled from the camera image for a view.
+    [[nodiscard]] size_t get_rendered_pixel_count(uint32_t view) const;
+
+    /**
+     * Renders all views from one camera frame. There has to be one output per
+     * view, in the order they were added, each big enough for its view.
+     * Returns false if there is no gray conversion for the pixel format.
+     * Without a worker pool everything runs on the calling thread.
+     */
+    bool render(
+        ocPixelFormat pixel_format,
+        const void *image,
+        uint32_t image_width,
+        uint32_t image_height,
+        uint8_t *const *outputs,
+        ocWorkerPool *pool = nullptr);
+};
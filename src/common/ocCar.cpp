@@ -512,6 +512,30 @@ float ocCarState::get_braking_distance() const
   }
 }
 
+ocPose drive_car(const ocCarState& state, float distance)
+{
+  ocPose result = state.pose;
+  if (state.steering_front == state.steering_rear)
+  {
+    float angle = state.pose.heading + state.steering_front;
+    result.pos.x = state.pose.pos.x + std::cos(angle) * distance;
+    result.pos.y = state.pose.pos.y + std::sin(angle) * distance;
+  }
+  else
+  {
+    float radius = state.steering_to_radius(state.steering_front, state.steering_rear);
+    float angle = distance / radius;
+    float pivot_x, pivot_y;
+    state.steering_to_pivot(state.steering_front, state.steering_rear, &pivot_x, &pivot_y);
+    float cos_a = std::cos(angle);
+    float sin_a = std::sin(angle);
+    result.pos.x = (state.pose.pos.x - pivot_x) * cos_a - (state.pose.pos.y - pivot_y) * sin_a + pivot_x;
+    result.pos.y = (state.pose.pos.x - pivot_x) * sin_a + (state.pose.pos.y - pivot_y) * cos_a + pivot_y;
+    result.heading = normalize_radians(state.pose.heading + angle);
+  }
+  return result;
+}
+
 static ocCarState simulate_car_step(const ocCarState& state, const ocCarAction& action, float duration)
 {
   oc_assert(0.0f < duration, duration);
@@ -549,26 +573,7 @@ static ocCarState simulate_car_step(const ocCarState& state, const ocCarAction&
   result.velocity = {speed + motor_accel * duration, 0.0f};
   result.steering_front = state.steering_front + front_steer_accel * duration;
   result.steering_rear  = state.steering_rear  + rear_steer_accel  * duration;
-
-  if (state.steering_front == state.steering_rear)
-  {
-    float angle = state.pose.heading + state.steering_front;
-    result.pose.pos.x = state.pose.pos.x + std::cos(angle) * distance;
-    result.pose.pos.y = state.pose.pos.y + std::sin(angle) * distance;
-  }
-  else
-  {
-    float radius = state.steering_to_radius(state.steering_front, state.steering_rear);
-    float angle = distance / radius;
-    float pivot_x, pivot_y;
-    state.steering_to_pivot(state.steering_front, state.steering_rear, &pivot_x, &pivot_y);
-    float cos_a = std::cos(angle);
-    float sin_a = std::sin(angle);
-    result.pose.pos.x = (state.pose.pos.x - pivot_x) * cos_a - (state.pose.pos.y - pivot_y) * sin_a + pivot_x;
-    result.pose.pos.y = (state.pose.pos.x - pivot_x) * sin_a + (state.pose.pos.y - pivot_y) * cos_a + pivot_y;
-    result.pose.pos.z = state.pose.pos.z;
-    result.pose.heading = normalize_radians(state.pose.heading + angle);
-  }
+  result.pose = drive_car(state, distance);
 
   result.wheel_revolutions += distance / state.properties->wheel.circumference;
 
@@ -289,3 +289,10 @@ struct ocCarState final
 };
 
 ocCarState simulate_car(const ocCarState& state, const ocCarAction& action, float duration, float step_size = 0.001f);
+
+/**
+ * Returns the pose of the car after it drove the given distance (in cm) with
+ * its current steering angles. This is how simulate_car moves the car, so
+ * odometry can be turned into a movement the same way.
+ */
+ocPose drive_car(const ocCarState& state, float distance);
@@ -6,10 +6,26 @@
 // magic value that is sent from the ipc hub to a new client
 #define OC_AUTH_PASSWORD        0x12345678
 
-// Image properties
-#define OC_CAM_BUFFER_SIZE (1024 * 1280 * 4)
+// size of each of the two rings of a member that uses the ring transport
+#define OC_IPC_RING_SIZE (1 << 20)
+
+// how many bytes an IPC socket tries to receive with a single recv
+#define OC_IPC_READ_CHUNK_SIZE (64 * 1024)
+
+// how many packets the hub holds back for a member that can't keep up
+#define OC_IPC_SEND_QUEUE_LIMIT 256
+
+// Camera frames live in the frame pool. These are the defaults, the IPC hub
+// can be started with other values.
+#define OC_FRAME_POOL_SLOTS 8
+#define OC_FRAME_POOL_SIZE (64 * 1024 * 1024)
+// how many frames the camera driver fills in turn
 #define OC_NUM_CAM_BUFFERS 3
+
+// Image properties
 #define OC_BIN_BUFFER_SIZE (1024 * 1280 * 1)
 #define OC_NUM_BIN_BUFFERS 2
 #define OC_BEV_BUFFER_SIZE (400 * 400 * 1)
 #define OC_NUM_BEV_BUFFERS 4
+// span count of a Bev_Region_Request that asks for the whole view
+#define OC_BEV_WHOLE_VIEW 0xFFFFFFFF
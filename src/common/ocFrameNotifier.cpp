@@ -0,0 +1,58 @@
+#include "ocFrameNotifier.h"
+#include "ocAssert.h"
+
+#include <cerrno> // errno
+
+#include <sys/eventfd.h> // eventfd
+#include <unistd.h> // read, write, close
+
+ocFrameNotifier::ocFrameNotifier(ocFramePool *pool, ocImageType channel) :
+    _pool(pool),
+    _channel(channel)
+{
+    oc_assert(pool && pool->is_attached());
+    _fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    oc_assert(0 <= _fd, errno);
+    _thread = std::thread(&ocFrameNotifier::_wait_for_frames, this);
+}
+
+ocFrameNotifier::~ocFrameNotifier()
+{
+    _running = false;
+    _pool->wake_waiters(_channel);
+    _thread.join();
+    close(_fd);
+}
+
+void ocFrameNotifier::_wait_for_frames()
+{
+    // Starting at 0 means a frame that was published before we got here is
+    // reported right away. The timeout is only there in case the wake from
+    // the destructor comes before we started waiting.
+    uint32_t seen = 0;
+    while (_running)
+    {
+        uint32_t count = _pool->wait_for_publish(_channel, seen, ocTime::milliseconds(100));
+        if (count == seen) continue;
+        seen = count;
+        uint64_t one = 1;
+        (void)!write(_fd, &one, sizeof(one));
+    }
+}
+
+ocFrameLease ocFrameNotifier::next_frame()
+{
+    uint64_t count;
+    (void)!read(_fd, &count, sizeof(count));
+
+    ocFrame *frame = _pool->acquire_latest(_channel);
+    if (!frame) return ocFrameLease();
+    ocFrameHandle handle = _pool->get_handle(frame);
+    if (handle.slot == _last_handle.slot && handle.generation == _last_handle.generation)
+    {
+        _pool->release(frame);
+        return ocFrameLease();
+    }
+    _last_handle = handle;
+    return ocFrameLease(_pool, frame);
+}
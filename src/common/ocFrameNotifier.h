@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ocFramePool.h"
+#include "ocTypes.h" // ocImageType
+
+#include <atomic>
+#include <thread>
+
+/**
+ * Turns the futex of a frame pool channel into a file descriptor that can be
+ * put on an ocPollEngine together with the IPC socket. The descriptor becomes
+ * readable when a new frame was published. A background thread does the
+ * actual waiting, so the futex wait doesn't block the event loop.
+ *
+ * Frames that get published while the consumer is still busy are merged into
+ * one notification, next_frame() always hands out the newest one.
+ */
+class ocFrameNotifier final
+{
+private:
+    ocFramePool      *_pool;
+    ocImageType       _channel;
+    int               _fd = -1;
+    std::atomic<bool> _running = true;
+    std::thread       _thread;
+    // no frame ever has generation 0, so this matches nothing
+    ocFrameHandle     _last_handle = {0, 0};
+
+    void _wait_for_frames();
+
+public:
+    ocFrameNotifier(ocFramePool *pool, ocImageType channel);
+    ~ocFrameNotifier();
+
+    ocFrameNotifier(const ocFrameNotifier&) = delete;
+    void operator=(const ocFrameNotifier&) = delete;
+
+    [[nodiscard]] int get_fd() const { return _fd; }
+
+    /**
+     * Call this once the file descriptor is readable. Returns a lease of the
+     * newest frame, or an empty lease if that frame was already handed out
+     * or is gone already.
+     */
+    [[nodiscard]] ocFrameLease next_frame();
+};
@@ -0,0 +1,390 @@
+#include "ocFramePool.h"
+#include "ocAssert.h"
+#include "ocFutex.h"
+
+#include <new> // placement new
+
+static constexpr uint64_t Reference_Mask = 0xFFFFFFFF;
+
+static uint32_t get_references(uint64_t state)
+{
+    return (uint32_t)(state & Reference_Mask);
+}
+
+static uint32_t get_generation(uint64_t state)
+{
+    return (uint32_t)(state >> 32);
+}
+
+static uint64_t make_state(uint32_t generation, uint32_t references)
+{
+    return (uint64_t)generation << 32 | references;
+}
+
+static size_t align_frame(size_t size)
+{
+    return (size + 63) & ~(size_t)63;
+}
+
+size_t ocFramePool::memory_size(uint32_t slot_count, size_t data_size)
+{
+    return align_frame(sizeof(ocFramePoolHeader) + slot_count * sizeof(ocFrame)) + data_size;
+}
+
+void ocFramePool::init(void *memory, uint32_t slot_count, size_t data_size)
+{
+    oc_assert(memory);
+    oc_assert(0 < slot_count, slot_count);
+    ocFramePoolHeader *header = new (memory) ocFramePoolHeader;
+    header->slot_count = slot_count;
+    header->data_size = data_size;
+    header->data_used.store(0);
+    header->write_counter.store(0);
+    for (auto &latest : header->latest) latest.store(0);
+    for (auto &publish_count : header->publish_count) publish_count.store(0);
+    header->waiters.store(0);
+    header->leases.store(0);
+    header->held_time_total_us.store(0);
+    header->held_time_max_us.store(0);
+    header->skipped_slots.store(0);
+
+    ocFrame *slots = (ocFrame *)(header + 1);
+    for (uint32_t i = 0; i < slot_count; ++i)
+    {
+        ocFrame *slot = new (&slots[i]) ocFrame;
+        slot->state.store(0);
+        slot->offset = 0;
+        slot->capacity = 0;
+        slot->last_write = 0;
+        slot->frame_number = 0;
+        slot->width = 0;
+        slot->height = 0;
+        slot->pixel_format = ocPixelFormat::None;
+    }
+    attach(memory);
+}
+
+void ocFramePool::attach(void *memory)
+{
+    oc_assert(memory);
+    _header = (ocFramePoolHeader *)memory;
+    _slots = (ocFrame *)(_header + 1);
+    _data = (std::byte *)memory + align_frame(sizeof(ocFramePoolHeader) + _header->slot_count * sizeof(ocFrame));
+}
+
+bool ocFramePool::is_attached() const
+{
+    return nullptr != _header;
+}
+
+uint32_t ocFramePool::get_slot_count() const
+{
+    oc_assert(_header);
+    return _header->slot_count;
+}
+
+uint32_t ocFramePool::get_free_slot_count() const
+{
+    oc_assert(_header);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < _header->slot_count; ++i)
+    {
+        if (0 == get_references(_slots[i].state.load(std::memory_order_relaxed))) count += 1;
+    }
+    return count;
+}
+
+ocFrame *ocFramePool::_claim(ocFrame *slot, uint64_t state)
+{
+    // A new generation makes all handles to the old frame useless, even for
+    // consumers that read the handle before we claimed the slot.
+    uint64_t claimed = make_state(get_generation(state) + 1, 1);
+    if (!slot->state.compare_exchange_strong(state, claimed, std::memory_order_acq_rel)) return nullptr;
+    slot->last_write = _header->write_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    return slot;
+}
+
+bool ocFramePool::_assign_buffer(ocFrame *slot, size_t size)
+{
+    size_t aligned_size = align_frame(size);
+    uint64_t used = _header->data_used.load(std::memory_order_relaxed);
+    do
+    {
+        if (_header->data_size < used + aligned_size) return false;
+    }
+    while (!_header->data_used.compare_exchange_weak(used, used + aligned_size, std::memory_order_relaxed));
+    slot->offset = used;
+    slot->capacity = aligned_size;
+    return true;
+}
+
+bool ocFramePool::_is_leased(const ocFrame *slot, uint64_t state, uint32_t own_references) const
+{
+    // The newest frame of a channel is referenced by the channel itself, that
+    // doesn't count as a lease, and neither does the caller's own reference.
+    uint64_t token = (uint64_t)get_generation(state) << 32 | ((uint32_t)(slot - _slots) + 1);
+    uint32_t channel_references = 0;
+    for (auto &latest : _header->latest)
+    {
+        if (token == latest.load(std::memory_order_relaxed)) channel_references += 1;
+    }
+    return channel_references + own_references < get_references(state);
+}
+
+ocFrame *ocFramePool::acquire_for_write(size_t size)
+{
+    oc_assert(_header);
+    oc_assert(0 < size);
+
+    // Other producers compete for the same slots, so we start over whenever
+    // someone else claimed the slot we picked.
+    for (int attempt = 0; attempt < 16; ++attempt)
+    {
+        ocFrame *best = nullptr;
+        uint64_t best_state = 0;
+        ocFrame *unused = nullptr;
+        uint64_t unused_state = 0;
+        uint64_t skipped = 0;
+        for (uint32_t i = 0; i < _header->slot_count; ++i)
+        {
+            ocFrame *slot = &_slots[i];
+            uint64_t state = slot->state.load(std::memory_order_acquire);
+            if (0 != get_references(state))
+            {
+                if (_is_leased(slot, state, 0)) skipped += 1;
+                continue;
+            }
+            if (0 == slot->capacity)
+            {
+                if (!unused)
+                {
+                    unused = slot;
+                    unused_state = state;
+                }
+            }
+            else if (size <= slot->capacity && (!best || slot->last_write < best->last_write))
+            {
+                best = slot;
+                best_state = state;
+            }
+        }
+
+        if (best)
+        {
+            if (!_claim(best, best_state)) continue;
+            _header->skipped_slots.fetch_add(skipped, std::memory_order_relaxed);
+            return best;
+        }
+        _header->skipped_slots.fetch_add(skipped, std::memory_order_relaxed);
+        if (!unused) return nullptr;
+        if (!_claim(unused, unused_state)) continue;
+        if (_assign_buffer(unused, size)) return unused;
+
+        // Out of memory. The slot stays without a buffer, so it can still be
+        // used by a producer with smaller frames.
+        release(unused);
+        return nullptr;
+    }
+    return nullptr;
+}
+
+bool ocFramePool::recycle(ocFrame *slot)
+{
+    oc_assert(_header);
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    if (1 != get_references(state))
+    {
+        if (_is_leased(slot, state, 1)) _header->skipped_slots.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    uint64_t recycled = make_state(get_generation(state) + 1, 1);
+    return slot->state.compare_exchange_strong(state, recycled, std::memory_order_acq_rel);
+}
+
+void ocFramePool::publish(ocFrame *slot, ocImageType channel)
+{
+    oc_assert(_header);
+    oc_assert(0 < (int)channel && (int)channel < OC_FRAME_POOL_CHANNELS, (int)channel);
+    uint64_t state = slot->state.fetch_add(1, std::memory_order_acq_rel);
+    // only someone who holds a reference may publish
+    oc_assert(0 < get_references(state), get_generation(state));
+
+    uint32_t index = (uint32_t)(slot - _slots);
+    uint64_t latest = (uint64_t)get_generation(state) << 32 | (index + 1);
+    uint64_t previous = _header->latest[(int)channel].exchange(latest, std::memory_order_acq_rel);
+    if (0 != previous)
+    {
+        // The channel held a reference, so the slot still has that generation.
+        release(&_slots[(previous & Reference_Mask) - 1]);
+    }
+
+    _header->publish_count[(int)channel].fetch_add(1, std::memory_order_seq_cst);
+    if (0 < _header->waiters.load(std::memory_order_seq_cst))
+    {
+        futex_wake(&_header->publish_count[(int)channel]);
+    }
+}
+
+uint32_t ocFramePool::get_publish_count(ocImageType channel) const
+{
+    oc_assert(_header);
+    oc_assert(0 < (int)channel && (int)channel < OC_FRAME_POOL_CHANNELS, (int)channel);
+    return _header->publish_count[(int)channel].load(std::memory_order_acquire);
+}
+
+uint32_t ocFramePool::wait_for_publish(ocImageType channel, uint32_t publish_count, ocTime timeout)
+{
+    oc_assert(_header);
+    oc_assert(0 < (int)channel && (int)channel < OC_FRAME_POOL_CHANNELS, (int)channel);
+    std::atomic<uint32_t> *count = &_header->publish_count[(int)channel];
+    if (publish_count != count->load(std::memory_order_acquire)) return count->load(std::memory_order_acquire);
+
+    // We have to count ourselves in before the last check, otherwise a
+    // producer could publish in between and not wake us.
+    _header->waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (publish_count == count->load(std::memory_order_seq_cst))
+    {
+        futex_wait(count, publish_count, timeout);
+    }
+    _header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return count->load(std::memory_order_acquire);
+}
+
+void ocFramePool::wake_waiters(ocImageType channel)
+{
+    oc_assert(_header);
+    oc_assert(0 < (int)channel && (int)channel < OC_FRAME_POOL_CHANNELS, (int)channel);
+    futex_wake(&_header->publish_count[(int)channel]);
+}
+
+ocFrame *ocFramePool::acquire_latest(ocImageType channel)
+{
+    oc_assert(_header);
+    oc_assert(0 < (int)channel && (int)channel < OC_FRAME_POOL_CHANNELS, (int)channel);
+    // If a new frame gets published between loading the handle and taking the
+    // reference, the old frame may be gone already. Just try the new one.
+    for (int attempt = 0; attempt < 16; ++attempt)
+    {
+        uint64_t latest = _header->latest[(int)channel].load(std::memory_order_acquire);
+        if (0 == latest) return nullptr;
+        ocFrame *slot = acquire({(uint32_t)(latest & Reference_Mask) - 1, get_generation(latest)});
+        if (slot) return slot;
+    }
+    return nullptr;
+}
+
+ocFrame *ocFramePool::acquire(ocFrameHandle handle)
+{
+    oc_assert(_header);
+    if (_header->slot_count <= handle.slot) return nullptr;
+    ocFrame *slot = &_slots[handle.slot];
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    // A slot without references still holds its frame until a producer claims
+    // it, which changes the generation.
+    while (get_generation(state) == handle.generation)
+    {
+        if (slot->state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel)) return slot;
+    }
+    return nullptr;
+}
+
+void ocFramePool::release(ocFrame *slot)
+{
+    oc_assert(_header);
+    uint64_t state = slot->state.fetch_sub(1, std::memory_order_acq_rel);
+    oc_assert(0 < get_references(state), get_generation(state));
+}
+
+ocFrameHandle ocFramePool::get_handle(const ocFrame *slot) const
+{
+    oc_assert(_header);
+    uint64_t state = slot->state.load(std::memory_order_relaxed);
+    return {(uint32_t)(slot - _slots), get_generation(state)};
+}
+
+uint8_t *ocFramePool::get_data(const ocFrame *slot) const
+{
+    oc_assert(_header);
+    return (uint8_t *)(_data + slot->offset);
+}
+
+ocFrameLease ocFramePool::lease(ocFrameHandle handle)
+{
+    return ocFrameLease(this, acquire(handle));
+}
+
+ocFrameLease ocFramePool::lease_latest(ocImageType channel)
+{
+    return ocFrameLease(this, acquire_latest(channel));
+}
+
+void ocFramePool::_end_lease(ocFrame *slot, ocTime held_time)
+{
+    release(slot);
+    uint64_t held_us = (uint64_t)held_time.get_microseconds();
+    _header->leases.fetch_add(1, std::memory_order_relaxed);
+    _header->held_time_total_us.fetch_add(held_us, std::memory_order_relaxed);
+    uint64_t max = _header->held_time_max_us.load(std::memory_order_relaxed);
+    while (max < held_us && !_header->held_time_max_us.compare_exchange_weak(max, held_us, std::memory_order_relaxed));
+}
+
+ocFrameLeaseStats ocFramePool::collect_lease_stats()
+{
+    oc_assert(_header);
+    ocFrameLeaseStats stats;
+    stats.leases             = _header->leases.exchange(0, std::memory_order_relaxed);
+    stats.held_time_total_us = _header->held_time_total_us.exchange(0, std::memory_order_relaxed);
+    stats.held_time_max_us   = _header->held_time_max_us.exchange(0, std::memory_order_relaxed);
+    stats.skipped_slots      = _header->skipped_slots.exchange(0, std::memory_order_relaxed);
+    return stats;
+}
+
+ocFrameLease::ocFrameLease(ocFramePool *pool, ocFrame *frame) :
+    _pool(pool),
+    _frame(frame),
+    _start(ocTime::now())
+{}
+
+ocFrameLease::ocFrameLease(ocFrameLease &&other) :
+    _pool(other._pool),
+    _frame(other._frame),
+    _start(other._start)
+{
+    other._frame = nullptr;
+}
+
+ocFrameLease &ocFrameLease::operator=(ocFrameLease &&other)
+{
+    if (this != &other)
+    {
+        release();
+        _pool  = other._pool;
+        _frame = other._frame;
+        _start = other._start;
+        other._frame = nullptr;
+    }
+    return *this;
+}
+
+ocFrameLease::~ocFrameLease()
+{
+    release();
+}
+
+const uint8_t *ocFrameLease::get_data() const
+{
+    oc_assert(_frame);
+    return _pool->get_data(_frame);
+}
+
+ocTime ocFrameLease::get_held_time() const
+{
+    return ocTime::now() - _start;
+}
+
+void ocFrameLease::release()
+{
+    if (!_frame) return;
+    _pool->_end_lease(_frame, get_held_time());
+    _frame = nullptr;
+}
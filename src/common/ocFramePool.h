@@ -0,0 +1,203 @@
+#pragma once
+
+#include "ocTime.h"
+#include "ocTypes.h" // ocImageType, ocPixelFormat
+
+#include <atomic>
+#include <cstddef> // size_t
+#include <cstdint> // _t types
+
+/**
+ * Identifies one frame in the pool. A slot gets a new generation every time a
+ * producer starts writing a new frame into it, so a handle to an old frame
+ * can't be used to grab whatever is in the slot now.
+ */
+struct ocFrameHandle
+{
+    uint32_t slot;
+    uint32_t generation;
+};
+
+/**
+ * One slot of the pool. It lives in the shared memory, so the frame info is
+ * written by the producer before it publishes the frame and only read after
+ * that.
+ */
+struct ocFrame
+{
+    // generation in the upper 32 bits, reference count in the lower 32 bits
+    std::atomic<uint64_t> state;
+    // Where the buffer of this slot is in the data area. A slot gets its
+    // buffer the first time it is used and keeps it after that.
+    uint64_t      offset;
+    uint64_t      capacity;
+    // value of the pool's write counter when the slot was last claimed, used
+    // to hand out the slot with the oldest frame first
+    uint64_t      last_write;
+
+    ocTime        frame_time;
+    uint32_t      frame_number;
+    uint32_t      width;
+    uint32_t      height;
+    ocPixelFormat pixel_format;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// one channel per ocImageType, channel 0 is unused
+#define OC_FRAME_POOL_CHANNELS 4
+
+struct ocFrameLeaseStats
+{
+    uint64_t leases;
+    uint64_t held_time_total_us;
+    uint64_t held_time_max_us;
+    // how often a producer had to pass over a slot because it was leased
+    uint64_t skipped_slots;
+};
+
+struct ocFramePoolHeader
+{
+    uint32_t slot_count;
+    uint64_t data_size;
+    alignas(64) std::atomic<uint64_t> data_used;
+    std::atomic<uint64_t> write_counter;
+    // the newest published frame of every channel as generation << 32 | slot + 1,
+    // or 0 if nothing was published yet
+    alignas(64) std::atomic<uint64_t> latest[OC_FRAME_POOL_CHANNELS];
+    // Counts the frames published in every channel. Consumers wait on these
+    // with a futex, the waiter count lets producers skip the wake syscall
+    // while nobody waits.
+    alignas(64) std::atomic<uint32_t> publish_count[OC_FRAME_POOL_CHANNELS];
+    std::atomic<uint32_t> waiters;
+    // lease statistics since the last collect_lease_stats()
+    alignas(64) std::atomic<uint64_t> leases;
+    std::atomic<uint64_t> held_time_total_us;
+    std::atomic<uint64_t> held_time_max_us;
+    std::atomic<uint64_t> skipped_slots;
+};
+
+class ocFramePool;
+
+/**
+ * A reference to a frame that is released when the lease goes out of scope.
+ * As long as a consumer holds the lease, no producer writes to the frame, so
+ * slow consumers can work on the frame in place instead of copying it.
+ */
+class ocFrameLease final
+{
+private:
+    ocFramePool *_pool  = nullptr;
+    ocFrame     *_frame = nullptr;
+    ocTime       _start;
+
+public:
+    ocFrameLease() = default;
+    ocFrameLease(ocFramePool *pool, ocFrame *frame);
+    ocFrameLease(ocFrameLease &&other);
+    ocFrameLease &operator=(ocFrameLease &&other);
+    ocFrameLease(const ocFrameLease &) = delete;
+    ocFrameLease &operator=(const ocFrameLease &) = delete;
+    ~ocFrameLease();
+
+    explicit operator bool() const { return nullptr != _frame; }
+    const ocFrame *operator->() const { return _frame; }
+    const ocFrame &operator*() const { return *_frame; }
+    [[nodiscard]] const uint8_t *get_data() const;
+    [[nodiscard]] ocTime get_held_time() const;
+
+    // gives the frame back early, the lease is empty afterwards
+    void release();
+};
+
+/**
+ * Pool of reference counted image frames in a shared memory segment that the
+ * IPC hub creates at startup. Producers claim a slot that is big enough for
+ * their frame, fill it and publish it. Consumers take a reference to a frame
+ * and the slot isn't reused before the last reference is released, so nobody
+ * ever reads a frame that is being overwritten. Slots without references keep
+ * their frame until a producer needs the slot again, the oldest ones go first.
+ *
+ * References don't know who owns them. A process that crashes while holding
+ * one keeps that slot busy until the hub restarts.
+ */
+class ocFramePool final
+{
+private:
+    ocFramePoolHeader *_header = nullptr;
+    ocFrame           *_slots  = nullptr;
+    std::byte         *_data   = nullptr;
+
+    ocFrame *_claim(ocFrame *slot, uint64_t state);
+    bool     _assign_buffer(ocFrame *slot, size_t size);
+    bool     _is_leased(const ocFrame *slot, uint64_t state, uint32_t own_references) const;
+    void     _end_lease(ocFrame *slot, ocTime held_time);
+
+    friend class ocFrameLease;
+
+public:
+    [[nodiscard]] static size_t memory_size(uint32_t slot_count, size_t data_size);
+
+    // Formats the memory as an empty pool. Only the hub does this, everyone
+    // else attaches.
+    void init(void *memory, uint32_t slot_count, size_t data_size);
+    void attach(void *memory);
+
+    [[nodiscard]] bool is_attached() const;
+    [[nodiscard]] uint32_t get_slot_count() const;
+    [[nodiscard]] uint32_t get_free_slot_count() const;
+
+    /**
+     * Producer side. Returns a slot with room for at least size bytes that
+     * holds one reference for the caller, or nullptr if all slots are in use
+     * or the pool ran out of memory. Leased slots are skipped.
+     */
+    [[nodiscard]] ocFrame *acquire_for_write(size_t size);
+
+    /**
+     * Producer side, for producers that keep their slots and write into them
+     * over and over again. Starts a new generation for a slot that only the
+     * caller holds a reference to. Returns false if someone else still holds
+     * one, in that case the slot must not be written to and counts as
+     * skipped.
+     */
+    [[nodiscard]] bool recycle(ocFrame *slot);
+
+    // Makes the frame the newest one of the channel. The channel holds its own
+    // reference until the next frame is published.
+    void publish(ocFrame *slot, ocImageType channel);
+
+    /**
+     * Consumer side. Takes a reference to the newest frame of the channel, or
+     * to the frame with the given handle if it is still in the pool. Returns
+     * nullptr if there is no such frame.
+     */
+    [[nodiscard]] ocFrame *acquire_latest(ocImageType channel);
+    [[nodiscard]] ocFrame *acquire(ocFrameHandle handle);
+
+    void release(ocFrame *slot);
+
+    /**
+     * Like acquire and acquire_latest, but the reference belongs to the
+     * returned lease. The lease is empty if there is no such frame.
+     */
+    [[nodiscard]] ocFrameLease lease(ocFrameHandle handle);
+    [[nodiscard]] ocFrameLease lease_latest(ocImageType channel);
+
+    /**
+     * Blocks until a frame was published in the channel since publish_count
+     * was read, or the timeout ran out, and returns the current count. Works
+     * across processes, no IPC packets involved.
+     */
+    [[nodiscard]] uint32_t get_publish_count(ocImageType channel) const;
+    uint32_t wait_for_publish(ocImageType channel, uint32_t publish_count, ocTime timeout = ocTime::forever());
+    // wakes everyone who waits on the channel, even without a new frame
+    void wake_waiters(ocImageType channel);
+
+    // Returns the statistics of all leases that ended since the last call and
+    // starts over. Meant to be called by one process only, the IPC hub.
+    ocFrameLeaseStats collect_lease_stats();
+
+    [[nodiscard]] ocFrameHandle get_handle(const ocFrame *slot) const;
+    [[nodiscard]] uint8_t *get_data(const ocFrame *slot) const;
+};
@@ -0,0 +1,49 @@
+#include "ocFrameSlot.h"
+
+#include <atomic>
+
+// The slots are plain structs in the shared memory, so they are accessed
+// through atomic_ref. The sequence numbers are naturally aligned uint32_t.
+static_assert(std::atomic_ref<uint32_t>::is_always_lock_free);
+
+void begin_frame_write(uint32_t &sequence)
+{
+    std::atomic_ref<uint32_t> atomic_sequence(sequence);
+    // If a producer died in the middle of a write, the sequence is still odd.
+    uint32_t odd = atomic_sequence.load(std::memory_order_relaxed) | 1;
+    atomic_sequence.store(odd, std::memory_order_relaxed);
+    // Nothing we write to the slot after this may become visible before the
+    // odd sequence.
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void end_frame_write(uint32_t &sequence)
+{
+    std::atomic_ref<uint32_t> atomic_sequence(sequence);
+    uint32_t odd = atomic_sequence.load(std::memory_order_relaxed) | 1;
+    atomic_sequence.store(odd + 1, std::memory_order_release);
+}
+
+void publish_frame_index(uint32_t &last_written_index, uint32_t index)
+{
+    std::atomic_ref<uint32_t>(last_written_index).store(index, std::memory_order_release);
+}
+
+uint32_t get_published_frame_index(const uint32_t &last_written_index)
+{
+    // atomic_ref<const T> only exists since C++26, loading doesn't write.
+    return std::atomic_ref<uint32_t>(const_cast<uint32_t &>(last_written_index)).load(std::memory_order_acquire);
+}
+
+uint32_t begin_frame_read(const uint32_t &sequence)
+{
+    return std::atomic_ref<uint32_t>(const_cast<uint32_t &>(sequence)).load(std::memory_order_acquire);
+}
+
+bool end_frame_read(const uint32_t &sequence, uint32_t begin)
+{
+    // The reads of the slot must not move past the second load of the sequence.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t end = std::atomic_ref<uint32_t>(const_cast<uint32_t &>(sequence)).load(std::memory_order_relaxed);
+    return 0 == (begin & 1) && begin == end;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <sched.h> // sched_yield
+
+/**
+ * Every image slot in the shared memory (ocBinData, ocBevData) starts with
+ * a sequence number that works like a seqlock. The producer makes it odd
+ * before it touches the slot and even again once the frame is complete.
+ * A reader remembers the sequence before it looks at the slot and checks it
+ * again afterwards. If it changed, the producer wrote to the slot in the
+ * meantime and whatever the reader saw may be a mix of two frames.
+ *
+ * The last_written_*_index fields are published with release semantics after
+ * the frame is complete, so a reader that loads the index with acquire
+ * semantics also sees everything that was written to the slot.
+ */
+
+// Producer side, brackets all writes to a slot.
+void begin_frame_write(uint32_t &sequence);
+void end_frame_write(uint32_t &sequence);
+
+void publish_frame_index(uint32_t &last_written_index, uint32_t index);
+[[nodiscard]] uint32_t get_published_frame_index(const uint32_t &last_written_index);
+
+/**
+ * Consumer side. begin_frame_read returns the sequence that has to be passed
+ * to end_frame_read after reading the slot. end_frame_read returns false if
+ * the slot was written to in between, or if it was already being written when
+ * begin_frame_read was called.
+ */
+[[nodiscard]] uint32_t begin_frame_read(const uint32_t &sequence);
+[[nodiscard]] bool end_frame_read(const uint32_t &sequence, uint32_t begin);
+
+/**
+ * Calls read(slot) until it saw a consistent frame and returns true, or gives
+ * up after the given number of attempts and returns false. The callback may be
+ * called multiple times, so it should only copy or compute and not have any
+ * side effects that can't be repeated.
+ */
+template<typename TSlot, typename TRead>
+bool read_frame(const TSlot &slot, TRead &&read, int attempts = 8)
+{
+    for (int i = 0; i < attempts; ++i)
+    {
+        uint32_t sequence = begin_frame_read(slot.sequence);
+        if (0 == (sequence & 1))
+        {
+            read(slot);
+            if (end_frame_read(slot.sequence, sequence)) return true;
+        }
+        sched_yield();
+    }
+    return false;
+}
+
+/**
+ * Like read_frame, but picks the slot that was published last and picks again
+ * if that one gets overwritten while reading.
+ */
+template<typename TSlot, size_t N, typename TRead>
+bool read_newest_frame(const TSlot (&slots)[N], const uint32_t &last_written_index, TRead &&read, int attempts = 8)
+{
+    for (int i = 0; i < attempts; ++i)
+    {
+        uint32_t index = get_published_frame_index(last_written_index);
+        if (N <= index) return false;
+        if (read_frame(slots[index], read, 1)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,28 @@
+#include "ocFutex.h"
+
+#include <climits> // INT_MAX
+#include <ctime> // timespec
+
+#include <linux/futex.h> // FUTEX_WAIT, FUTEX_WAKE
+#include <sys/syscall.h> // SYS_futex
+#include <unistd.h> // syscall
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, ocTime timeout)
+{
+    timespec ts;
+    timespec *tsp = nullptr;
+    if (ocTime::forever() != timeout)
+    {
+        ts.tv_sec  = (time_t)timeout.get_seconds();
+        ts.tv_nsec = (long)(timeout.get_nanoseconds() % 1000000000);
+        tsp = &ts;
+    }
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, tsp, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t> *word)
+{
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
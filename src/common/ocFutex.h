@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ocTime.h"
+
+#include <atomic>
+#include <cstdint> // uint32_t
+
+/**
+ * Futexes on words in shared memory, so they can't be private futexes. A
+ * waiter only sleeps while the word still holds the expected value, so a
+ * wake between reading the word and calling futex_wait isn't lost. The wait
+ * can also end early for no reason, callers have to check their condition
+ * again afterwards.
+ */
+void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, ocTime timeout);
+void futex_wake(std::atomic<uint32_t> *word);
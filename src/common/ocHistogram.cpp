@@ -0,0 +1,50 @@
+#include "ocHistogram.h"
+#include "ocAssert.h"
+
+#include <algorithm> // std::max, std::clamp
+#include <cmath> // ceil
+
+ocHistogram::ocHistogram(float bin_width, uint32_t bin_count)
+    : _bins(bin_count), _bin_width(bin_width)
+{
+    oc_assert(0.0f < bin_width, bin_width);
+    oc_assert(0 < bin_count);
+}
+
+void ocHistogram::add(float value)
+{
+    int64_t bin = (int64_t)(value / _bin_width);
+    bin = std::clamp<int64_t>(bin, 0, (int64_t)_bins.size() - 1);
+    _bins[(size_t)bin] += 1;
+    _max = (0 == _count) ? value : std::max(_max, value);
+    _sum += value;
+    _count += 1;
+}
+
+void ocHistogram::clear()
+{
+    std::fill(_bins.begin(), _bins.end(), 0);
+    _count = 0;
+    _sum   = 0.0;
+    _max   = 0.0f;
+}
+
+float ocHistogram::get_mean() const
+{
+    if (0 == _count) return 0.0f;
+    return (float)(_sum / (double)_count);
+}
+
+float ocHistogram::get_percentile(float fraction) const
+{
+    if (0 == _count) return 0.0f;
+    uint64_t target = (uint64_t)std::ceil(std::clamp(fraction, 0.0f, 1.0f) * (float)_count);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t bin = 0; bin < _bins.size(); ++bin)
+    {
+        seen += _bins[bin];
+        if (target <= seen) return (float)(bin + 1) * _bin_width;
+    }
+    return (float)_bins.size() * _bin_width;
+}
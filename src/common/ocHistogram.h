@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint> // _t types
+#include <vector>
+
+/**
+ * Counts values in bins of equal width, e.g. latencies in ms, to report
+ * percentiles without keeping every value. Values below 0 land in the first
+ * bin and values past the last bin in the last one, so percentiles there
+ * are only bounds.
+ */
+class ocHistogram final
+{
+private:
+    std::vector<uint32_t> _bins;
+    float    _bin_width;
+    uint64_t _count = 0;
+    double   _sum   = 0.0;
+    float    _max   = 0.0f;
+
+public:
+    ocHistogram(float bin_width, uint32_t bin_count);
+
+    void add(float value);
+    void clear();
+
+    [[nodiscard]] uint64_t get_count() const { return _count; }
+    [[nodiscard]] float    get_mean() const;
+    [[nodiscard]] float    get_max() const { return _max; }
+
+    /**
+     * Returns the upper edge of the bin that the given fraction of all
+     * values is in or below, e.g. 0.99 for the 99th percentile. Without
+     * values it returns 0.
+     */
+    [[nodiscard]] float get_percentile(float fraction) const;
+};
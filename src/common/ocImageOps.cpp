@@ -1,5 +1,14 @@
 #include "ocImageOps.h"
 
+#include <algorithm> // std::min
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 const char *to_string(ocPixelFormat pixel_format)
 {
   switch (pixel_format)
@@ -53,9 +62,7 @@ template<> RgbF32 PixelFormat::convert<GrayU8, RgbF32>(GrayU8 pixel)
 template<> GrayU8 PixelFormat::convert<BgrU8, GrayU8>(BgrU8 pixel)
 {
   GrayU8 result;
-  result.value = (uint8_t)roundf((float)pixel.r * 0.2126f +
-                                 (float)pixel.g * 0.7152f +
-                                 (float)pixel.b * 0.0722f);
+  result.value = gray_from_bgr(pixel.b, pixel.g, pixel.r);
   return result;
 }
 template<> BgrU8 PixelFormat::convert<BgrU8, BgrU8>(BgrU8 pixel)
@@ -73,11 +80,8 @@ template<> RgbF32 PixelFormat::convert<BgrU8, RgbF32>(BgrU8 pixel)
 
 template<> GrayU8 PixelFormat::convert<BgrxU8, GrayU8>(BgrxU8 pixel)
 {
-  // TODO: LUT for byte->byte
   GrayU8 result;
-  result.value = (uint8_t)roundf((float)pixel.r * 0.2126f +
-                                 (float)pixel.g * 0.7152f +
-                                 (float)pixel.b * 0.0722f);
+  result.value = gray_from_bgr(pixel.b, pixel.g, pixel.r);
   return result;
 }
 template<> BgrU8 PixelFormat::convert<BgrxU8, BgrU8>(BgrxU8 pixel)
@@ -97,79 +101,248 @@ template<> RgbF32 PixelFormat::convert<BgrxU8, RgbF32>(BgrxU8 pixel)
   return result;
 }
 
+// Converts a row of BGRx pixels to gray, as many pixels at once as the
+// instruction set allows. The rest goes through the scalar conversion.
+static void convert_row_bgrx_to_gray(const BgrxU8 *src, GrayU8 *dst, size_t count)
+{
+  [[maybe_unused]] uint8_t *dst_bytes = (uint8_t *)dst;
+  size_t i = 0;
+#if defined(__AVX2__)
+  {
+    const __m256i weights = _mm256_setr_epi16(
+      GRAY_WEIGHT_B, GRAY_WEIGHT_G, GRAY_WEIGHT_R, 0, GRAY_WEIGHT_B, GRAY_WEIGHT_G, GRAY_WEIGHT_R, 0,
+      GRAY_WEIGHT_B, GRAY_WEIGHT_G, GRAY_WEIGHT_R, 0, GRAY_WEIGHT_B, GRAY_WEIGHT_G, GRAY_WEIGHT_R, 0);
+    const __m256i rounding = _mm256_set1_epi32(1 << 14);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256i pixels = _mm256_loadu_si256((const __m256i *)&src[i]);
+      // b*wb + g*wg and r*wr of two pixels per 128 bit lane
+      __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), weights);
+      __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), weights);
+      lo = _mm256_add_epi32(lo, _mm256_srli_epi64(lo, 32));
+      hi = _mm256_add_epi32(hi, _mm256_srli_epi64(hi, 32));
+      __m256i sums = _mm256_castps_si256(_mm256_shuffle_ps(
+        _mm256_castsi256_ps(lo), _mm256_castsi256_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+      sums = _mm256_srli_epi32(_mm256_add_epi32(sums, rounding), 15);
+      __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+      _mm_storel_epi64((__m128i *)&dst_bytes[i], _mm_packus_epi16(words, words));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i weights = _mm_setr_epi16(
+      GRAY_WEIGHT_B, GRAY_WEIGHT_G, GRAY_WEIGHT_R, 0, GRAY_WEIGHT_B, GRAY_WEIGHT_G, GRAY_WEIGHT_R, 0);
+    const __m128i rounding = _mm_set1_epi32(1 << 14);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128i pixels = _mm_loadu_si128((const __m128i *)&src[i]);
+      __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+      __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+      lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+      hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+      __m128i sums = _mm_castps_si128(_mm_shuffle_ps(
+        _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+      sums = _mm_srli_epi32(_mm_add_epi32(sums, rounding), 15);
+      __m128i words = _mm_packs_epi32(sums, sums);
+      uint32_t bytes = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+      memcpy(&dst_bytes[i], &bytes, 4);
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 8 <= count; i += 8)
+  {
+    uint8x8x4_t pixels = vld4_u8((const uint8_t *)&src[i]);
+    uint16x8_t b = vmovl_u8(pixels.val[0]);
+    uint16x8_t g = vmovl_u8(pixels.val[1]);
+    uint16x8_t r = vmovl_u8(pixels.val[2]);
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(r), GRAY_WEIGHT_R);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(r), GRAY_WEIGHT_R);
+    lo = vmlal_n_u16(lo, vget_low_u16(g), GRAY_WEIGHT_G);
+    hi = vmlal_n_u16(hi, vget_high_u16(g), GRAY_WEIGHT_G);
+    lo = vmlal_n_u16(lo, vget_low_u16(b), GRAY_WEIGHT_B);
+    hi = vmlal_n_u16(hi, vget_high_u16(b), GRAY_WEIGHT_B);
+    // rounding shift, adds 1 << 14 before shifting
+    uint16x8_t words = vcombine_u16(vrshrn_n_u32(lo, 15), vrshrn_n_u32(hi, 15));
+    vst1_u8(&dst_bytes[i], vmovn_u16(words));
+  }
+#endif
+  for (; i < count; ++i)
+  {
+    dst[i] = convert<BgrxU8, GrayU8>(src[i]);
+  }
+}
+
+static void convert_row_bgr_to_gray(const BgrU8 *src, GrayU8 *dst, size_t count)
+{
+  // The kernel wants four bytes per pixel, so the row is padded in chunks
+  // that stay in the cache.
+  BgrxU8 chunk[64];
+  for (size_t i = 0; i < count; i += 64)
+  {
+    size_t n = std::min<size_t>(64, count - i);
+    for (size_t j = 0; j < n; ++j)
+    {
+      chunk[j] = BgrxU8 { src[i + j].b, src[i + j].g, src[i + j].r, 0 };
+    }
+    convert_row_bgrx_to_gray(chunk, &dst[i], n);
+  }
+}
+
+template<typename SrcFormat, typename DstFormat>
+static void convert_row(const SrcFormat *src, DstFormat *dst, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    dst[i] = convert<SrcFormat, DstFormat>(src[i]);
+  }
+}
+
+/**
+ * Same result as convert_and_downscale, but row by row. The nearest neighbour
+ * columns are looked up once per call instead of dividing for every pixel.
+ * Rows are gathered into a contiguous buffer first, unless nothing has to be
+ * dropped horizontally, so that the row function can work on whole rows.
+ */
+template<typename SrcFormat, typename DstFormat, typename RowFunction>
+static void convert_rows(
+  const SrcFormat *src_data,
+  size_t src_width,
+  size_t src_height,
+  DstFormat *dst_data,
+  size_t dst_width,
+  size_t dst_height,
+  RowFunction convert_row_function)
+{
+  oc_assert(nullptr != src_data);
+  oc_assert(nullptr != dst_data);
+  oc_assert(0 != dst_width);
+  oc_assert(0 != dst_height);
+  oc_assert(dst_width <= src_width, dst_width, src_width);
+  oc_assert(dst_height <= src_height, dst_height, src_height);
+
+  thread_local std::vector<uint32_t> columns;
+  thread_local std::vector<SrcFormat> gathered;
+  bool gather = dst_width != src_width;
+  if (gather)
+  {
+    columns.resize(dst_width);
+    gathered.resize(dst_width);
+    for (size_t dst_x = 0; dst_x < dst_width; ++dst_x)
+    {
+      columns[dst_x] = (uint32_t)(dst_x * src_width / dst_width);
+    }
+  }
+
+  for (size_t dst_y = 0; dst_y < dst_height; ++dst_y)
+  {
+    size_t src_y = dst_y * src_height / dst_height;
+    const SrcFormat *src_row = &src_data[src_y * src_width];
+    if (gather)
+    {
+      for (size_t dst_x = 0; dst_x < dst_width; ++dst_x)
+      {
+        gathered[dst_x] = src_row[columns[dst_x]];
+      }
+      src_row = gathered.data();
+    }
+    convert_row_function(src_row, &dst_data[dst_y * dst_width], dst_width);
+  }
+}
+
+static void copy_row_gray(const GrayU8 *src, GrayU8 *dst, size_t count)
+{
+  memcpy(dst, src, count * sizeof(GrayU8));
+}
+static void copy_row_bgr(const BgrU8 *src, BgrU8 *dst, size_t count)
+{
+  memcpy(dst, src, count * sizeof(BgrU8));
+}
+
 void convert_gray_u8_to_gray_u8(const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<GrayU8, GrayU8>(
+  convert_rows<GrayU8, GrayU8>(
     (const GrayU8 *)src_data,
     src_width, src_height,
     (GrayU8 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    copy_row_gray);
 }
 void convert_gray_u8_to_bgr_u8(const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<GrayU8, BgrU8>(
+  convert_rows<GrayU8, BgrU8>(
     (const GrayU8 *)src_data,
     src_width, src_height,
     (BgrU8 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row<GrayU8, BgrU8>);
 }
 void convert_gray_u8_to_rgb_f32(const uint8_t *src_data, size_t src_width, size_t src_height, float *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<GrayU8, RgbF32>(
+  convert_rows<GrayU8, RgbF32>(
     (const GrayU8 *)src_data,
     src_width, src_height,
     (RgbF32 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row<GrayU8, RgbF32>);
 }
 
 void convert_bgr_u8_to_gray_u8(const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<BgrU8, GrayU8>(
+  convert_rows<BgrU8, GrayU8>(
     (const BgrU8 *)src_data,
     src_width, src_height,
     (GrayU8 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row_bgr_to_gray);
 }
 void convert_bgr_u8_to_bgr_u8(const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<BgrU8, BgrU8>(
+  convert_rows<BgrU8, BgrU8>(
     (const BgrU8 *)src_data,
     src_width, src_height,
     (BgrU8 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    copy_row_bgr);
 }
 void convert_bgr_u8_to_rgb_f32(const uint8_t *src_data, size_t src_width, size_t src_height, float *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<BgrU8, RgbF32>(
+  convert_rows<BgrU8, RgbF32>(
     (const BgrU8 *)src_data,
     src_width, src_height,
     (RgbF32 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row<BgrU8, RgbF32>);
 }
 
 void convert_bgra_u8_to_gray_u8(const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<BgrxU8, GrayU8>(
+  convert_rows<BgrxU8, GrayU8>(
     (const BgrxU8 *)src_data,
     src_width, src_height,
     (GrayU8 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row_bgrx_to_gray);
 }
 void convert_bgra_u8_to_bgr_u8(const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<BgrxU8, BgrU8>(
+  convert_rows<BgrxU8, BgrU8>(
     (const BgrxU8 *)src_data,
     src_width, src_height,
     (BgrU8 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row<BgrxU8, BgrU8>);
 }
 void convert_bgra_u8_to_rgb_f32(const uint8_t *src_data, size_t src_width, size_t src_height, float *dst_data, size_t dst_width, size_t dst_height)
 {
-  convert_and_downscale<BgrxU8, RgbF32>(
+  convert_rows<BgrxU8, RgbF32>(
     (const BgrxU8 *)src_data,
     src_width, src_height,
     (RgbF32 *)dst_data,
-    dst_width, dst_height);
+    dst_width, dst_height,
+    convert_row<BgrxU8, RgbF32>);
 }
 
 bool convert_to_gray_u8(ocPixelFormat src_format, const void *src_data, size_t src_width, size_t src_height, uint8_t *dst_data, size_t dst_width, size_t dst_height)
@@ -23,6 +23,21 @@ enum class ocPixelFormat: uint8_t
 const char *to_string(ocPixelFormat pixel_format);
 uint8_t bytes_per_pixel(ocPixelFormat pixel_format);
 
+// Rec. 709 luma weights (0.2126, 0.7152, 0.0722) in 1.15 fixed point. They
+// add up to exactly 1 << 15, so white stays white. Integers make the SIMD
+// kernels give the same result as the scalar code on every machine, which
+// isn't a given with floats and fused multiply-adds.
+constexpr uint32_t GRAY_WEIGHT_R = 6966;
+constexpr uint32_t GRAY_WEIGHT_G = 23436;
+constexpr uint32_t GRAY_WEIGHT_B = 2366;
+static_assert(GRAY_WEIGHT_R + GRAY_WEIGHT_G + GRAY_WEIGHT_B == (1 << 15));
+
+inline uint8_t gray_from_bgr(uint8_t b, uint8_t g, uint8_t r)
+{
+  uint32_t sum = r * GRAY_WEIGHT_R + g * GRAY_WEIGHT_G + b * GRAY_WEIGHT_B;
+  return (uint8_t)((sum + (1 << 14)) >> 15);
+}
+
 void convert_gray_u8_to_gray_u8 (const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t  *dst_data, size_t dst_width, size_t dst_height);
 void convert_gray_u8_to_bgr_u8  (const uint8_t *src_data, size_t src_width, size_t src_height, uint8_t  *dst_data, size_t dst_width, size_t dst_height);
 void convert_gray_u8_to_rgb_f32 (const uint8_t *src_data, size_t src_width, size_t src_height, float    *dst_data, size_t dst_width, size_t dst_height);
@@ -166,6 +181,9 @@ namespace PixelFormat
   template<> RgbF32  convert<BgrxU8,  RgbF32 >(BgrxU8  pixel);
 }
 
+// Converts pixel by pixel with a nearest neighbour downscale. The convert_*
+// functions above give exactly the same result, but work on whole rows with
+// precomputed column indices and SIMD where it pays off.
 template<typename SrcFormat, typename DstFormat>
 void convert_and_downscale(
   const SrcFormat *src_data,
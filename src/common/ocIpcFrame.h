@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ocPacket.h"
+#include "ocTypes.h" // ocMemberId, ocMessageId
+
+#include <cstddef> // std::byte
+#include <cstdint> // uint32_t
+#include <cstring> // memcpy
+
+/**
+ * A packet payload that is copied once and then shared between the send queues
+ * of many sockets, e.g. when the hub sends one packet to all its subscribers.
+ * Each queue holds a reference and the frame deletes itself when the last one
+ * is released. The reference count isn't atomic, frames must not be shared
+ * between threads.
+ */
+class ocIpcFrame final
+{
+private:
+    ocMessageId _message_id = ocMessageId::None;
+    ocMemberId  _sender     = ocMemberId::None;
+    uint32_t    _length     = 0;
+    uint32_t    _references = 1;
+    std::byte  *_payload    = nullptr;
+
+    ocIpcFrame() = default;
+    ~ocIpcFrame()
+    {
+        delete[] _payload;
+    }
+
+public:
+    ocIpcFrame(const ocIpcFrame&) = delete;
+    ocIpcFrame &operator=(const ocIpcFrame&) = delete;
+
+    // The new frame starts out with one reference owned by the caller.
+    static ocIpcFrame *create(const ocPacketView &packet)
+    {
+        ocIpcFrame *frame = new ocIpcFrame();
+        frame->_message_id = packet.get_message_id();
+        frame->_sender = packet.get_sender();
+        frame->_length = packet.get_length();
+        if (0 < frame->_length)
+        {
+            frame->_payload = new std::byte[frame->_length];
+            memcpy(frame->_payload, packet.get_data(), frame->_length);
+        }
+        return frame;
+    }
+
+    ocIpcFrame *acquire()
+    {
+        ++_references;
+        return this;
+    }
+
+    void release()
+    {
+        if (0 == --_references) delete this;
+    }
+
+    ocMessageId get_message_id() const
+    {
+        return _message_id;
+    }
+    ocMemberId get_sender() const
+    {
+        return _sender;
+    }
+    const std::byte *get_data() const
+    {
+        return _payload;
+    }
+    uint32_t get_length() const
+    {
+        return _length;
+    }
+};
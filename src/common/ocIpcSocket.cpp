@@ -1,18 +1,18 @@
 #include "ocAssert.h"
+#include "ocConst.h"
 #include "ocIpcSocket.h"
 
 #include <sys/socket.h>
+#include <sys/uio.h> // iovec
 #include <unistd.h> // close()
 
+#include <algorithm> // std::min
 #include <cerrno> // errno
 #include <cstring> // memcpy, memmove
 
-struct ocPacketHeader
-{
-    ocMessageId message_id;
-    ocMemberId  sender_id;
-    uint32_t counter_and_length; // (length << 8) | counter
-};
+// How long a producer sleeps on a full ring before it looks again, in case
+// the consumer died or never got the doorbell.
+static const ocTime Ring_Space_Timeout = ocTime::milliseconds(10);
 
 ocIpcSocket::ocIpcSocket() :
     _send_buffer((1 << 24) - 1 + sizeof(ocPacketHeader)),
@@ -22,6 +22,7 @@ ocIpcSocket::ocIpcSocket() :
 ocIpcSocket::~ocIpcSocket()
 {
     if (0 <= _socket_fd) close(_socket_fd);
+    for (ocQueuedFrame &queued : _send_queue) queued.frame->release();
 }
 
 int32_t ocIpcSocket::get_fd() const
@@ -45,7 +46,22 @@ int32_t ocIpcSocket::send(
 {
     oc_assert(-1 != _socket_fd);
     oc_assert(length < (1 << 24), length);
+    oc_assert(_send_queue.empty(), _send_queue.size());
+
+    if (_send_ring.is_attached())
+    {
+        return _send_to_ring(sender_id, message_id, data, length, blocking);
+    }
+    return _send_to_socket(sender_id, message_id, data, length, blocking);
+}
 
+int32_t ocIpcSocket::_send_to_socket(
+    ocMemberId sender_id,
+    ocMessageId message_id,
+    const void *data,
+    size_t length,
+    bool blocking)
+{
     auto writer = _send_buffer.clear_and_edit();
 
     writer.write<ocPacketHeader>({
@@ -105,94 +121,485 @@ int32_t ocIpcSocket::send_packet(const ocPacket &packet, bool blocking)
     return send(sender_id, message_id, data, length, blocking);
 }
 
-int32_t ocIpcSocket::_read(void *buffer, size_t length, bool blocking)
+int32_t ocIpcSocket::send_packet(const ocPacketView &packet, bool blocking)
 {
-    int flags = 0;
-    if (!blocking) flags |= MSG_DONTWAIT;
-    // First try the fastest thing: read the requested amount of data into the
-    // target buffer. If that doesn't work, we fall back onto the _read_buffer.
-    if (_read_buffer.is_empty())
+    return send(packet.get_sender(), packet.get_message_id(), packet.get_data(), packet.get_length(), blocking);
+}
+
+int32_t ocIpcSocket::send_batch(const ocPacket *const *packets, size_t count, bool blocking)
+{
+    oc_assert(-1 != _socket_fd);
+    oc_assert(_send_queue.empty(), _send_queue.size());
+
+    if (_send_ring.is_attached())
     {
-        ssize_t result = ::recv(_socket_fd, buffer, length, flags);
-        if (result <= 0)
+        for (size_t i = 0; i < count; ++i)
         {
-            if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            if (!_send_ring.can_ever_fit(packets[i]->get_length()))
+            {
+                errno = EMSGSIZE;
+                return -1;
+            }
+        }
+        if (!blocking && !_send_ring.can_write(packets, count)) return 0;
+
+        // Everything goes into the ring first, so the other side gets woken
+        // up only once for the whole batch, unless it has to make room.
+        int32_t bytes_sent = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ocPacket *packet = packets[i];
+            uint32_t length = packet->get_length();
+            while (!_send_ring.write(packet->get_message_id(), packet->get_sender(), packet->get_payload()->get_space(length), length))
             {
-                return 0; // 0 = would have to block
+                // The other side only drains the ring after a doorbell, if it
+                // went to sleep on what we wrote so far.
+                if (_send_ring.take_wakeup())
+                {
+                    int32_t result = _send_to_socket(ocMemberId::None, ocMessageId::Ring_Doorbell, nullptr, 0, true);
+                    if (result < 0) return result;
+                }
+                _send_ring.wait_for_space(length, Ring_Space_Timeout);
             }
-            return -1; // -1 == error
+            bytes_sent += (int32_t)(sizeof(ocShmRingRecord) + length);
         }
-        if (length == (size_t)result)
+        if (_send_ring.take_wakeup())
         {
-            return (int32_t)length;
+            int32_t result = _send_to_socket(ocMemberId::None, ocMessageId::Ring_Doorbell, nullptr, 0, blocking);
+            if (result < 0) return result;
         }
-        // If not enough data was read by the recv, we pull it back out
-        // from the target and append it to the _read_buffer.
-        // (technically, we don't "append", because the buffer is empty,
-        // but this matches the stuff happening below.)
-        _read_buffer.edit_from_end().write(buffer, (size_t)result);
+        return bytes_sent;
     }
-    // At this point either the read_buffer isn't empty, of the recv above
-    // didn't return enough data.
-    size_t bytes_read = _read_buffer.get_length();
-    while (bytes_read < length)
+
+    constexpr size_t max_packets = 64;
+    ocPacketHeader headers[max_packets];
+    iovec iov[2 * max_packets];
+
+    int32_t bytes_sent = 0;
+    for (size_t first = 0; first < count; first += max_packets)
     {
-        size_t len = length - bytes_read;
-        ssize_t result = ::recv(_socket_fd, _read_buffer.make_space(bytes_read, len), len, flags);
-        if (result <= 0)
+        size_t batch = std::min(count - first, max_packets);
+        size_t iov_count = 0;
+        size_t bytes_total = 0;
+        for (size_t i = 0; i < batch; ++i)
         {
-            if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            const ocPacket *packet = packets[first + i];
+            uint32_t length = packet->get_length();
+            oc_assert(length < (1 << 24), length);
+            ocPacketHeader &header = headers[i];
+            header = {
+                .message_id = packet->get_message_id(),
+                .sender_id = packet->get_sender(),
+                .counter_and_length = (uint32_t)(length << 8) | (uint8_t)(_send_counter + i)
+            };
+            iov[iov_count++] = {&header, sizeof(ocPacketHeader)};
+            if (0 < length)
             {
-                return 0; // 0 = would have to block
+                iov[iov_count++] = {(void *)packet->get_payload()->get_space(length), length};
             }
-            return -1; // -1 == error
+            bytes_total += sizeof(ocPacketHeader) + length;
         }
-        bytes_read += (size_t)result;
+
+        msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        size_t bytes_done = 0;
+        while (bytes_done < bytes_total)
+        {
+            // Once part of the batch went out, the rest has to follow no
+            // matter what, or the stream would be broken.
+            int flags = (blocking || 0 < bytes_done || 0 < first) ? 0 : MSG_DONTWAIT;
+            ssize_t result = ::sendmsg(_socket_fd, &message, flags);
+            if (result < 0)
+            {
+                if (0 != flags && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+                return -1;
+            }
+            bytes_done += (size_t)result;
+
+            // skip over everything that was sent
+            size_t skip = (size_t)result;
+            while (0 < message.msg_iovlen && message.msg_iov->iov_len <= skip)
+            {
+                skip -= message.msg_iov->iov_len;
+                message.msg_iov++;
+                message.msg_iovlen--;
+            }
+            if (0 < skip)
+            {
+                message.msg_iov->iov_base = (std::byte *)message.msg_iov->iov_base + skip;
+                message.msg_iov->iov_len -= skip;
+            }
+        }
+        _send_counter = (uint8_t)(_send_counter + batch);
+        bytes_sent += (int32_t)bytes_total;
     }
-    // If we haven't returned so far, we must have received all the bytes we asked for
-    // and collected them into the read_buffer. Now we shovel them over to the real
-    // target and clear the buffer for the next packet.
-    _read_buffer.read_from_start().read(buffer, length);
-    _read_buffer.clear();
-    return (int32_t)length;
+    return bytes_sent;
 }
 
-int32_t ocIpcSocket::read_packet(ocPacket &packet, bool blocking)
+int32_t ocIpcSocket::queue_frame(ocIpcFrame *frame, bool urgent)
 {
     oc_assert(-1 != _socket_fd);
+    oc_assert(frame);
 
-    ocPacketHeader header = {};
-    int32_t result;
+    size_t length = frame->get_length();
+    if (_send_ring.is_attached() && !_send_ring.can_ever_fit(length))
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
 
-    result = _read(&header, sizeof(ocPacketHeader), blocking);
-    if (result <= 0) return result;
+    // Urgent frames go behind the other urgent ones, but never in front of a
+    // frame that is partially sent.
+    size_t index = _send_queue.size();
+    if (urgent)
+    {
+        index = (0 < _send_queue_offset) ? 1 : 0;
+        while (index < _send_queue.size() && _send_queue[index].urgent) ++index;
+    }
 
-    uint8_t counter = (uint8_t)header.counter_and_length;
-    size_t length = header.counter_and_length >> 8;
-    oc_assert(_read_counter == counter, _read_counter, counter);
+    // The counters have to be in the order the frames go out. Everything
+    // behind the new frame hasn't been sent yet, so it just moves up by one.
+    uint8_t counter = _send_counter;
+    if (index < _send_queue.size())
+    {
+        counter = (uint8_t)_send_queue[index].header.counter_and_length;
+    }
+    _send_queue.insert(_send_queue.begin() + (ptrdiff_t)index, {
+        .frame = frame->acquire(),
+        .header = {
+            .message_id = frame->get_message_id(),
+            .sender_id = frame->get_sender(),
+            .counter_and_length = (uint32_t)(length << 8) | counter
+        },
+        .urgent = urgent
+    });
+    // With rings, the counter only counts the doorbells on the socket.
+    if (!_send_ring.is_attached())
+    {
+        for (size_t i = index + 1; i < _send_queue.size(); ++i)
+        {
+            ocPacketHeader &header = _send_queue[i].header;
+            header.counter_and_length = (header.counter_and_length & ~0xffu) | (uint8_t)(counter + (i - index));
+        }
+        _send_counter++;
+    }
 
-    packet.clear();
+    int32_t result = flush_queue();
+    if (result < 0) return result;
+    return (int32_t)(sizeof(ocPacketHeader) + length);
+}
 
-    if (0 < length)
+int32_t ocIpcSocket::_flush_queue_to_ring()
+{
+    int32_t bytes_sent = 0;
+    while (!_send_queue.empty())
     {
-        result = _read(packet.get_payload()->make_space(length), length, blocking);
+        ocIpcFrame *frame = _send_queue.front().frame;
+        int32_t result = _send_to_ring(
+            frame->get_sender(),
+            frame->get_message_id(),
+            frame->get_data(),
+            frame->get_length(),
+            false);
         if (result <= 0)
         {
             if (result < 0) return result;
-            // if result is 0 here, that means we're non-blocking and we already
-            // have received the header. So we need to stuff the header back in
-            // the front of the _read_buffer and then return.
-            size_t len = _send_buffer.get_length();
-            void *dst = _send_buffer.make_space(sizeof(ocPacketHeader), len);
-            void *src = _send_buffer.get_space(len);
-            memmove(dst, src, len);
-            memcpy(src, &header, sizeof(ocPacketHeader));
-            return 0;
+            break;
+        }
+        bytes_sent += result;
+        frame->release();
+        _send_queue.pop_front();
+    }
+    return bytes_sent;
+}
+
+int32_t ocIpcSocket::flush_queue()
+{
+    oc_assert(-1 != _socket_fd);
+
+    if (_send_ring.is_attached()) return _flush_queue_to_ring();
+
+    // Every frame needs two iovecs, one for its header and one for its
+    // payload. This limits how many frames go out with a single syscall.
+    constexpr size_t max_frames = 64;
+    iovec iov[2 * max_frames];
+
+    int32_t bytes_sent = 0;
+    while (!_send_queue.empty())
+    {
+        size_t iov_count = 0;
+        size_t bytes_queued = 0;
+        size_t skip = _send_queue_offset;
+        for (size_t i = 0; i < _send_queue.size() && i < max_frames; ++i)
+        {
+            ocQueuedFrame &queued = _send_queue[i];
+            size_t payload_length = queued.frame->get_length();
+            if (skip < sizeof(ocPacketHeader))
+            {
+                iov[iov_count].iov_base = (std::byte *)&queued.header + skip;
+                iov[iov_count].iov_len = sizeof(ocPacketHeader) - skip;
+                bytes_queued += iov[iov_count].iov_len;
+                iov_count++;
+                skip = 0;
+            }
+            else
+            {
+                skip -= sizeof(ocPacketHeader);
+            }
+            if (skip < payload_length)
+            {
+                iov[iov_count].iov_base = (std::byte *)queued.frame->get_data() + skip;
+                iov[iov_count].iov_len = payload_length - skip;
+                bytes_queued += iov[iov_count].iov_len;
+                iov_count++;
+            }
+            skip = 0;
+        }
+
+        msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        ssize_t result = ::sendmsg(_socket_fd, &message, MSG_DONTWAIT);
+        if (result < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        bytes_sent += (int32_t)result;
+
+        // drop all frames that went out completely, remember how much of the
+        // next one was sent
+        size_t remaining = _send_queue_offset + (size_t)result;
+        while (!_send_queue.empty())
+        {
+            size_t frame_size = sizeof(ocPacketHeader) + _send_queue.front().frame->get_length();
+            if (remaining < frame_size) break;
+            remaining -= frame_size;
+            _send_queue.front().frame->release();
+            _send_queue.pop_front();
+        }
+        _send_queue_offset = remaining;
+
+        if ((size_t)result < bytes_queued) break;
+    }
+    return bytes_sent;
+}
+
+size_t ocIpcSocket::get_queue_length() const
+{
+    return _send_queue.size();
+}
+
+size_t ocIpcSocket::get_queue_length(ocMessageId message_id) const
+{
+    size_t count = 0;
+    for (const ocQueuedFrame &queued : _send_queue)
+    {
+        if (message_id == queued.header.message_id) count++;
+    }
+    return count;
+}
+
+bool ocIpcSocket::replace_queued_frame(ocIpcFrame *frame)
+{
+    oc_assert(frame);
+    // A frame that is partially sent has to go out as it is.
+    size_t first = (0 < _send_queue_offset) ? 1 : 0;
+    for (size_t i = _send_queue.size(); first < i; --i)
+    {
+        ocQueuedFrame &queued = _send_queue[i - 1];
+        if (frame->get_message_id() != queued.header.message_id) continue;
+
+        uint8_t counter = (uint8_t)queued.header.counter_and_length;
+        queued.frame->release();
+        queued.frame = frame->acquire();
+        queued.header.sender_id = frame->get_sender();
+        queued.header.counter_and_length = (frame->get_length() << 8) | counter;
+        return true;
+    }
+    return false;
+}
+
+void ocIpcSocket::attach_rings(void *send_ring_memory, void *read_ring_memory)
+{
+    _send_ring.attach(send_ring_memory);
+    _read_ring.attach(read_ring_memory);
+}
+
+bool ocIpcSocket::uses_rings() const
+{
+    return _send_ring.is_attached();
+}
+
+int32_t ocIpcSocket::_send_to_ring(
+    ocMemberId sender_id,
+    ocMessageId message_id,
+    const void *data,
+    size_t length,
+    bool blocking)
+{
+    if (!_send_ring.can_ever_fit(length))
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    while (!_send_ring.write(message_id, sender_id, data, length))
+    {
+        if (!blocking) return 0;
+        // Same as in send_batch, the other side only makes room while it's
+        // awake, and then wakes us up.
+        if (_send_ring.take_wakeup())
+        {
+            int32_t result = _send_to_socket(ocMemberId::None, ocMessageId::Ring_Doorbell, nullptr, 0, true);
+            if (result < 0) return result;
         }
+        _send_ring.wait_for_space(length, Ring_Space_Timeout);
+    }
+
+    if (_send_ring.take_wakeup())
+    {
+        // If this would block, the socket is full of unread doorbells anyway,
+        // so the consumer is going to wake up either way.
+        int32_t result = _send_to_socket(ocMemberId::None, ocMessageId::Ring_Doorbell, nullptr, 0, blocking);
+        if (result < 0) return result;
     }
+    return (int32_t)(sizeof(ocShmRingRecord) + length);
+}
 
+int32_t ocIpcSocket::_fill_read_buffer(size_t needed, bool blocking)
+{
+    // Move whatever is left to the front, so there is room for the rest of
+    // the current packet and as many of the following ones as possible.
+    size_t rest = _read_buffer.get_length() - _read_begin;
+    if (0 < _read_begin)
+    {
+        if (0 < rest)
+        {
+            memmove(_read_buffer.get_space(rest), _read_buffer.get_space(_read_begin, rest), rest);
+        }
+        _read_buffer.set_length(rest);
+        _read_begin = 0;
+    }
+
+    size_t space = OC_IPC_READ_CHUNK_SIZE;
+    if (space < needed) space = needed;
+    space -= rest;
+
+    int flags = 0;
+    if (!blocking) flags |= MSG_DONTWAIT;
+    ssize_t result = ::recv(_socket_fd, _read_buffer.make_space(rest, space), space, flags);
+    if (result <= 0)
+    {
+        _read_buffer.set_length(rest);
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0; // 0 = would have to block
+        }
+        return -1; // -1 == error
+    }
+    _read_buffer.set_length(rest + (size_t)result);
+    return (int32_t)result;
+}
+
+int32_t ocIpcSocket::_peek_socket(ocPacketView &view, bool blocking)
+{
+    oc_assert(0 == _peeked_size, _peeked_size);
+    while (true)
+    {
+        size_t available = _read_buffer.get_length() - _read_begin;
+        size_t needed = sizeof(ocPacketHeader);
+        if (sizeof(ocPacketHeader) <= available)
+        {
+            ocPacketHeader header;
+            memcpy(&header, _read_buffer.get_space(_read_begin, sizeof(ocPacketHeader)), sizeof(ocPacketHeader));
+
+            uint8_t counter = (uint8_t)header.counter_and_length;
+            uint32_t length = header.counter_and_length >> 8;
+            oc_assert(_read_counter == counter, _read_counter, counter);
+
+            needed += length;
+            if (needed <= available)
+            {
+                // The whole packet is in the buffer, hand it out in place.
+                const std::byte *payload = nullptr;
+                if (0 < length) payload = _read_buffer.get_space(_read_begin + sizeof(ocPacketHeader), length);
+                view = ocPacketView(header.message_id, header.sender_id, payload, length);
+                _peeked_size = (uint32_t)needed;
+                return (int32_t)needed;
+            }
+        }
+
+        int32_t result = _fill_read_buffer(needed, blocking);
+        if (result <= 0) return result;
+    }
+}
+
+void ocIpcSocket::_release_socket()
+{
+    oc_assert(0 < _peeked_size);
+    _read_begin += _peeked_size;
+    _peeked_size = 0;
     _read_counter++;
-    packet.set_message_id(header.message_id);
-    packet.set_sender(header.sender_id);
-    return (int32_t)(sizeof(ocPacketHeader) + length);
+    if (_read_begin == _read_buffer.get_length())
+    {
+        _read_buffer.clear();
+        _read_begin = 0;
+    }
+}
+
+int32_t ocIpcSocket::read_packet(ocPacket &packet, bool blocking)
+{
+    ocPacketView view;
+    int32_t result = peek_packet(view, blocking);
+    if (result <= 0) return result;
+    view.copy_to(packet);
+    release_packet();
+    return result;
+}
+
+int32_t ocIpcSocket::_peek_ring(ocPacketView &view, bool blocking)
+{
+    while (true)
+    {
+        if (_read_ring.peek(view))
+        {
+            return (int32_t)(sizeof(ocShmRingRecord) + view.get_length());
+        }
+        // Ask for a doorbell and check again, the producer might have written
+        // something between the peek and now.
+        if (!_read_ring.prepare_wait()) continue;
+
+        // The socket only carries doorbells now, so all we do is swallow them
+        // or wait for one to arrive.
+        ocPacketView doorbell;
+        int32_t result = _peek_socket(doorbell, blocking);
+        if (result <= 0) return result;
+        oc_assert(ocMessageId::Ring_Doorbell == doorbell.get_message_id(), doorbell.get_message_id());
+        _release_socket();
+    }
+}
+
+int32_t ocIpcSocket::peek_packet(ocPacketView &view, bool blocking)
+{
+    oc_assert(-1 != _socket_fd);
+
+    if (_read_ring.is_attached())
+    {
+        return _peek_ring(view, blocking);
+    }
+    return _peek_socket(view, blocking);
+}
+
+void ocIpcSocket::release_packet()
+{
+    if (_read_ring.is_attached())
+    {
+        _read_ring.pop();
+    }
+    else
+    {
+        _release_socket();
+    }
 }
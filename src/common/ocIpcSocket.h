@@ -1,32 +1,82 @@
 #pragma once
 
+#include "ocIpcFrame.h"
 #include "ocPacket.h"
+#include "ocShmRing.h"
 #include "ocTypes.h"
 
 #include <cstdint> // int32_t
+#include <deque>
 #include <type_traits> // std::is_trivial_v
 
+// What goes over the socket in front of every payload.
+struct ocPacketHeader
+{
+    ocMessageId message_id;
+    ocMemberId  sender_id;
+    uint32_t counter_and_length; // (length << 8) | counter
+};
+
+enum class ocIpcTransport
+{
+    // every packet goes through the unix socket
+    Socket,
+    // packets go through two rings in shared memory, the socket only carries
+    // doorbells to wake up the other side
+    Shared_Memory_Ring
+};
+
 class ocIpcSocket final
 {
 private:
     // file descriptor of the socket
     int32_t _socket_fd = -1;
 
-    // queues to store the data for the read and send syscalls.
+    // queues to store the data for the read and send syscalls. The read
+    // buffer collects everything the socket has to offer in one recv,
+    // packets are then parsed out of it in place, starting at _read_begin.
     ocBuffer _send_buffer;
     ocBuffer _read_buffer;
+    size_t   _read_begin = 0;
+    // size of the packet handed out by the last peek, consumed by release
+    uint32_t _peeked_size = 0;
 
     // counters to make sure no packets were lost. Unsigned integers will just
     // wrap back to 0 on overflow.
     uint8_t _send_counter = 0;
     uint8_t _read_counter = 0;
 
+    // Only attached when the socket uses the ring transport.
+    ocShmRing _send_ring;
+    ocShmRing _read_ring;
+
+    // Frames waiting to be sent by flush_queue. The header is built when the
+    // frame is queued, so it already has the right counter. Urgent frames are
+    // kept in front of all others.
+    struct ocQueuedFrame
+    {
+        ocIpcFrame     *frame;
+        ocPacketHeader  header;
+        bool            urgent;
+    };
+    std::deque<ocQueuedFrame> _send_queue;
+    // bytes of the first queued frame that already went out
+    size_t _send_queue_offset = 0;
+
     /**
-     * Tries to recv the requested amount of data into the buffer. If not enough
-     * data was received, and blocking is false, the amount that was received
-     * is copied into the _read_buffer.
+     * Receives as much as is available, but at least the given amount of
+     * bytes when blocking, into the free space at the end of the _read_buffer.
+     * Returns the amount of bytes received, 0 if it would have to block or a
+     * negative error code.
      */
-    int32_t _read(void *buffer, size_t length, bool blocking);
+    int32_t _fill_read_buffer(size_t needed, bool blocking);
+    int32_t _peek_socket(ocPacketView &view, bool blocking);
+    void _release_socket();
+
+    int32_t _send_to_socket(ocMemberId sender_id, ocMessageId message_id, const void *data, size_t length, bool blocking);
+    int32_t _send_to_ring(ocMemberId sender_id, ocMessageId message_id, const void *data, size_t length, bool blocking);
+    int32_t _peek_ring(ocPacketView &view, bool blocking);
+    int32_t _flush_queue_to_ring();
 
 public:
 
@@ -59,6 +109,15 @@ public:
      */
     int32_t set_fd(int32_t fd);
 
+    /**
+     * Switches the socket over to the shared memory ring transport. Both rings
+     * must already be initialized, the other end of the socket attaches the
+     * same rings the other way around. From then on, the socket only carries
+     * doorbells.
+     */
+    void attach_rings(void *send_ring_memory, void *read_ring_memory);
+    bool uses_rings() const;
+
     /**
      * Reads a single packet if one is available and returns its size.
      * If no packet is available, the method will block or return 0 depending on the blocking parameter.
@@ -66,12 +125,70 @@ public:
      */
     int32_t read_packet(ocPacket &packet, bool blocking = true);
 
+    /**
+     * Same as read_packet, but doesn't copy the packet. The view points into
+     * the read buffer, or with the ring transport straight into shared memory.
+     * It stays valid until release_packet is called, which must happen before
+     * the next peek. Looping until this returns 0 drains the socket with a
+     * single recv for all packets that arrived together.
+     */
+    int32_t peek_packet(ocPacketView &view, bool blocking = true);
+    void release_packet();
+
     /**
      * Sends the given packet over the socket and returns the number of bytes sent.
      * If the send buffer is full, the method will block or return 0 depending on the blocking parameter.
-     * If an error occurred, a negative error code is returned.
+     * If an error occurred, a negative error code is returned. With the ring
+     * transport, packets that are larger than the ring fail with EMSGSIZE.
      */
     int32_t send_packet(const ocPacket &packet, bool blocking = true);
+    int32_t send_packet(const ocPacketView &packet, bool blocking = true);
+
+    /**
+     * Sends all the given packets with as few syscalls as possible, usually
+     * a single sendmsg. With the ring transport, the other side is woken up
+     * once, or whenever the ring is full and it has to make room. When not
+     * blocking, 0 is returned if nothing could be sent. Once part of the
+     * batch went out over the socket, the rest is sent blocking. A ring only
+     * takes the batch without blocking if all of it fits in at once.
+     */
+    int32_t send_batch(const ocPacket *const *packets, size_t count, bool blocking = true);
+
+    /**
+     * Queued sending, for sockets that send the same frames as many others.
+     * The frame is appended to the send queue, which keeps a reference to it,
+     * and as much of the queue as possible is sent right away without
+     * blocking. Whatever is left, including partially sent frames, goes out
+     * with flush_queue, e.g. when the socket becomes writable again. The
+     * direct send functions must not be used while the queue isn't empty.
+     * Returns the size of the queued packet or a negative error code.
+     *
+     * Urgent frames overtake everything in the queue that isn't urgent
+     * itself, except for a partially sent frame. They are meant for control
+     * messages that must not wait behind bulk traffic.
+     */
+    int32_t queue_frame(ocIpcFrame *frame, bool urgent = false);
+
+    /**
+     * Sends as much of the send queue as possible without blocking, coalescing
+     * many frames into one syscall. Returns the number of bytes sent, which is
+     * 0 if the socket is still full, or a negative error code.
+     */
+    int32_t flush_queue();
+
+    /**
+     * Returns the number of frames in the send queue, including a partially
+     * sent one.
+     */
+    size_t get_queue_length() const;
+    size_t get_queue_length(ocMessageId message_id) const;
+
+    /**
+     * Swaps the newest queued frame with the same message id for the given
+     * one, keeping its place in the queue. Frames that are partially sent
+     * can't be replaced. Returns false if there was no frame to replace.
+     */
+    bool replace_queued_frame(ocIpcFrame *frame);
 
     int32_t send(ocMemberId sender_id, ocMessageId message_id, const void *data, size_t length, bool blocking = true);
     int32_t send(ocMessageId message_id, bool blocking = true);
@@ -83,4 +200,11 @@ public:
         static_assert(std::is_trivial_v<T>);
         return send(ocMemberId::None, message_id, (const void *)&data, sizeof(T), blocking);
     }
+
+    // Sends a registered payload struct under its own message id.
+    template<ocRegisteredMessage Msg>
+    int32_t send(const Msg &msg, bool blocking = true)
+    {
+        return send(ocMemberId::None, Msg::message_id, (const void *)&msg, sizeof(Msg), blocking);
+    }
 };
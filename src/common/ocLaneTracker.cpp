@@ -0,0 +1,166 @@
+#include "ocLaneTracker.h"
+#include "ocCommon.h" // normalize_radians
+
+#include <algorithm> // std::max
+#include <cmath> // sqrt, hypot, atan2
+
+// How far the lane can change per cm the car drives, as standard deviations
+// that grow with the square root of the distance.
+static constexpr float CURVATURE_NOISE = 0.0005f;
+static constexpr float OFFSET_NOISE    = 0.3f;
+static constexpr float HEADING_NOISE   = 0.01f;
+
+// Standard deviations of a measurement with a confidence of 1.
+static constexpr float MEASURED_CURVATURE = 0.001f;
+static constexpr float MEASURED_OFFSET    = 3.0f;
+static constexpr float MEASURED_HEADING   = 0.05f;
+
+// Measurements further away from the prediction are ignored. This is the
+// 99.9% quantile of the chi-squared distribution with 3 degrees of freedom.
+static constexpr float GATE = 16.27f;
+
+// After that many ignored measurements in a row the prediction is more likely
+// wrong than the measurements, so the track starts again.
+static constexpr uint32_t MAX_REJECTED = 5;
+
+// Without measurements the track is lost once the offset is that uncertain.
+static constexpr float MAX_OFFSET_DEVIATION = 50.0f;
+
+// Below that curvature the lane is moved like a straight line, the center of
+// the circle would be too far away for floats.
+static constexpr float MIN_CURVATURE = 1e-6f;
+
+static bool circle_to_state(float center_x, float center_y, float radius, Vec3 *state)
+{
+    float dist = std::hypot(center_x, center_y);
+    if (dist < 1.0f || radius <= 0.0f) return false;
+    // A circle with the center on the right is a right curve.
+    float side = (center_y < 0.0f) ? -1.0f : 1.0f;
+    // The lane runs along the circle at the point closest to the car.
+    float tangent_x = side * (center_y / dist);
+    float tangent_y = side * (-center_x / dist);
+    state->x = side / radius;
+    state->y = side * (dist - radius);
+    state->z = std::atan2(tangent_y, tangent_x);
+    return true;
+}
+
+void ocLaneTracker::reset()
+{
+    _valid = false;
+    _rejected = 0;
+}
+
+void ocLaneTracker::predict(const ocPose &motion, float distance)
+{
+    if (!_valid) return;
+
+    float cos_h = std::cos(motion.heading);
+    float sin_h = std::sin(motion.heading);
+    auto to_car = [&](float x, float y, float *car_x, float *car_y)
+    {
+        x -= motion.pos.x;
+        y -= motion.pos.y;
+        *car_x =  cos_h * x + sin_h * y;
+        *car_y = -sin_h * x + cos_h * y;
+    };
+
+    float curvature = _state.x;
+    float normal_x = -std::sin(_state.z);
+    float normal_y =  std::cos(_state.z);
+    float point_x = _state.y * normal_x;
+    float point_y = _state.y * normal_y;
+    if (MIN_CURVATURE < std::abs(curvature))
+    {
+        float side = (curvature < 0.0f) ? -1.0f : 1.0f;
+        float radius = 1.0f / std::abs(curvature);
+        float center_x, center_y;
+        to_car(point_x + side * radius * normal_x, point_y + side * radius * normal_y, &center_x, &center_y);
+        float dist = std::hypot(center_x, center_y);
+        _state.y = side * (dist - radius);
+        _state.z = std::atan2(side * -center_x / dist, side * center_y / dist);
+    }
+    else
+    {
+        to_car(point_x, point_y, &point_x, &point_y);
+        _state.z = normalize_radians(_state.z - motion.heading);
+        _state.y = -std::sin(_state.z) * point_x + std::cos(_state.z) * point_y;
+    }
+
+    // Linearized for a car that drives straight along its x axis.
+    float s = distance;
+    Mat3 f(1.0f,         0.0f, 0.0f,
+           0.5f * s * s, 1.0f, s,
+           s,            0.0f, 1.0f);
+    float d = std::abs(distance);
+    Mat3 q(CURVATURE_NOISE * CURVATURE_NOISE * d, 0.0f, 0.0f,
+           0.0f, OFFSET_NOISE * OFFSET_NOISE * d, 0.0f,
+           0.0f, 0.0f, HEADING_NOISE * HEADING_NOISE * d);
+    _covariance = f * _covariance * transpose(f) + q;
+
+    if (MAX_OFFSET_DEVIATION < get_offset_deviation())
+    {
+        reset();
+    }
+}
+
+bool ocLaneTracker::update(float center_x, float center_y, float radius, float confidence)
+{
+    Vec3 measured;
+    if (confidence <= 0.0f || !circle_to_state(center_x, center_y, radius, &measured))
+    {
+        return false;
+    }
+
+    float scale = 1.0f / std::min(confidence, 1.0f);
+    Mat3 r(MEASURED_CURVATURE * MEASURED_CURVATURE * scale, 0.0f, 0.0f,
+           0.0f, MEASURED_OFFSET * MEASURED_OFFSET * scale, 0.0f,
+           0.0f, 0.0f, MEASURED_HEADING * MEASURED_HEADING * scale);
+
+    if (_valid)
+    {
+        Vec3 innovation = measured - _state;
+        innovation.z = normalize_radians(innovation.z);
+        Mat3 s_inverse = inverse(_covariance + r);
+        if (GATE < dot(innovation, s_inverse * innovation))
+        {
+            ++_rejected;
+            if (_rejected < MAX_REJECTED) return false;
+            // fall through and start a new track
+        }
+        else
+        {
+            Mat3 gain = _covariance * s_inverse;
+            _state += gain * innovation;
+            _state.z = normalize_radians(_state.z);
+            _covariance = (Mat3::identity() - gain) * _covariance;
+            _covariance = 0.5f * (_covariance + transpose(_covariance));
+            _rejected = 0;
+            return true;
+        }
+    }
+
+    _state = measured;
+    _covariance = r;
+    _valid = true;
+    _rejected = 0;
+    return true;
+}
+
+bool ocLaneTracker::get_lane(ocLaneData *lane_data) const
+{
+    if (!_valid) return false;
+    float side = (_state.x < 0.0f) ? -1.0f : 1.0f;
+    float radius = 1.0f / std::max(std::abs(_state.x), 1.0f / MAX_RADIUS);
+    float normal_x = -std::sin(_state.z);
+    float normal_y =  std::cos(_state.z);
+    lane_data->curve_center_x = (_state.y + side * radius) * normal_x;
+    lane_data->curve_center_y = (_state.y + side * radius) * normal_y;
+    lane_data->curve_radius   = radius;
+    return true;
+}
+
+float ocLaneTracker::get_offset_deviation() const
+{
+    return std::sqrt(_covariance(1, 1));
+}
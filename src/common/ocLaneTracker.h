@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ocMat.h"
+#include "ocPose.h"
+#include "ocTypes.h" // ocLaneData
+
+#include <cstdint> // _t types
+
+/**
+ * Follows the lane from frame to frame with an extended Kalman filter. The
+ * lane is described relative to the car, by its curvature, its lateral offset
+ * and its heading, which also works for straight lanes. Between two frames
+ * the lane is moved by how the car moved, see drive_car() in ocCar.h, then
+ * the circle measured in the new frame is fused in.
+ *
+ * Distances are in cm in the coordinates of ocCarState, like ocLaneData: x
+ * is forward and y is to the right.
+ */
+class ocLaneTracker final
+{
+private:
+    // curvature in 1/cm, lateral offset in cm and heading in rad, all
+    // positive to the right
+    Vec3     _state = {};
+    Mat3     _covariance = {};
+    bool     _valid = false;
+    // measurements that in a row didn't fit the prediction
+    uint32_t _rejected = 0;
+
+public:
+    // Straighter lanes are reported as a circle of this radius.
+    static constexpr float MAX_RADIUS = 10000.0f;
+
+    // Forgets the lane, the next measurement starts a new track.
+    void reset();
+
+    [[nodiscard]] bool is_valid() const { return _valid; }
+
+    /**
+     * Moves the lane into the car coordinates after the car moved. motion is
+     * where the car is now, relative to where it was at the last call, and
+     * distance is how far it drove to get there.
+     */
+    void predict(const ocPose &motion, float distance);
+
+    /**
+     * Fuses a circle measured in the current frame. confidence goes from 0
+     * to 1 and scales how much the measurement is trusted, with 0 nothing
+     * happens. Returns false if the measurement was too far off from the
+     * prediction and got ignored.
+     */
+    bool update(float center_x, float center_y, float radius, float confidence);
+
+    /**
+     * Writes the lane as a circle, if the tracker has one. Returns false and
+     * leaves the lane data alone otherwise.
+     */
+    bool get_lane(ocLaneData *lane_data) const;
+
+    // Standard deviation of the lateral offset in cm.
+    [[nodiscard]] float get_offset_deviation() const;
+};
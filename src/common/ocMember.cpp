@@ -19,7 +19,7 @@ ocMember::ocMember(ocMemberId identifier, std::string_view name) :
 
 /* register the process at the server with an id */
 
-void ocMember::attach()
+void ocMember::attach(ocIpcTransport transport)
 {
     int32_t sock = socket(AF_UNIX, SOCK_STREAM, 0);
     if (sock < 0)
@@ -43,17 +43,21 @@ void ocMember::attach()
 
     _socket.set_fd(sock);
 
-    if (EXIT_FAILURE == _auth()) {
+    if (EXIT_FAILURE == _auth(transport)) {
         exit(-1);
     }
 }
 
 /* private function to authenticate and get the shared memory id */
 
-int ocMember::_auth()
+int ocMember::_auth(ocIpcTransport transport)
 {
-    /* First we send the authentication packet */
+    /* First we send the authentication packet, optionally asking for rings */
     ocPacket auth_packet(ocMessageId::Auth_Request, _id);
+    if (ocIpcTransport::Shared_Memory_Ring == transport)
+    {
+        auth_packet.clear_and_edit().write<uint32_t>(OC_IPC_RING_SIZE);
+    }
     if (_socket.send_packet(auth_packet) <= 0)
     {
         _logger.error("Could not send auth packet: (%i) %s", errno, strerror(errno));
@@ -96,6 +100,52 @@ int ocMember::_auth()
 
     _shared_memory = (ocSharedMemory*) shmaddr;
 
+    /* the hub only sends a ring segment if we asked for one, otherwise -1 */
+    int ring_id = reader.read_or_default<int>(-1);
+    if (0 <= ring_id)
+    {
+        void *ring_addr = shmat(ring_id, nullptr, 0);
+        if (((void *)-1) == ring_addr)
+        {
+            _logger.error("Error while attaching the ring memory: (%i) %s", errno, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        // The first ring goes to the hub, the second one comes from it.
+        std::byte *to_hub = (std::byte *)ring_addr;
+        std::byte *from_hub = to_hub + ocShmRing::memory_size(OC_IPC_RING_SIZE);
+        _socket.attach_rings(to_hub, from_hub);
+        _logger.log("Using the shared memory ring transport, ring ID: 0x%x", ring_id);
+    }
+    else if (ocIpcTransport::Shared_Memory_Ring == transport)
+    {
+        _logger.warn("The IPC hub doesn't support the ring transport, falling back to the socket.");
+    }
+
+    /* the camera frames are in their own segment */
+    int frame_pool_id = reader.read_or_default<int>(-1);
+    if (0 <= frame_pool_id)
+    {
+        void *frame_pool_addr = shmat(frame_pool_id, nullptr, 0);
+        if (((void *)-1) == frame_pool_addr)
+        {
+            _logger.error("Error while attaching the frame pool: (%i) %s", errno, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        _frame_pool.attach(frame_pool_addr);
+    }
+    else
+    {
+        _logger.warn("The IPC hub didn't send a frame pool, camera frames are not available.");
+    }
+
     _logger.log("Connection successful, Shared Memory ID: 0x%x", sharedmemory_id);
     return EXIT_SUCCESS;
 }
+
+ocFrameNotifier *ocMember::get_frame_notifier(ocImageType type)
+{
+    if (!_frame_pool.is_attached()) return nullptr;
+    auto &notifier = _frame_notifiers[(int)type];
+    if (!notifier) notifier = std::make_unique<ocFrameNotifier>(&_frame_pool, type);
+    return notifier.get();
+}
@@ -1,17 +1,31 @@
 #pragma once
 
+#include "ocFrameNotifier.h" // ocFrameNotifier
+#include "ocFramePool.h" // ocFramePool
 #include "ocIpcSocket.h" // ocIpcSocket
 #include "ocLogger.h" // ocLogger
 #include "ocTypes.h" // ocSharedMemory, ocMemberId
 
+#include <memory> // unique_ptr
 #include <string_view>
 
 class ocMember final
 {
 public:
-    void attach();
+    // Connects to the IPC hub. With the ring transport, packets are exchanged
+    // through shared memory and the socket only wakes up the other side.
+    void attach(ocIpcTransport transport = ocIpcTransport::Socket);
 
     ocSharedMemory *get_shared_memory() {return _shared_memory;}
+    // nullptr if the hub didn't send a frame pool
+    ocFramePool *get_frame_pool() {return _frame_pool.is_attached() ? &_frame_pool : nullptr;}
+    // Pins a frame from the pool until the lease goes away. The lease is empty
+    // if the frame isn't in the pool (anymore) or there is no pool.
+    ocFrameLease lease_frame(ocFrameHandle handle) {return _frame_pool.is_attached() ? _frame_pool.lease(handle) : ocFrameLease();}
+    ocFrameLease lease_latest_frame(ocImageType type) {return _frame_pool.is_attached() ? _frame_pool.lease_latest(type) : ocFrameLease();}
+    // Readable file descriptor for every new frame of the given type, see
+    // ocFrameNotifier. Created on first use, nullptr if there is no pool.
+    ocFrameNotifier *get_frame_notifier(ocImageType type);
     ocIpcSocket *get_socket() {return &_socket;}
     ocLogger *get_logger() {return &_logger;}
 
@@ -21,7 +35,9 @@ private:
     ocSharedMemory *_shared_memory;
     ocMemberId      _id;
     ocIpcSocket     _socket;
+    ocFramePool     _frame_pool;
+    std::unique_ptr<ocFrameNotifier> _frame_notifiers[OC_FRAME_POOL_CHANNELS];
     ocLogger        _logger;
 
-    int _auth();
+    int _auth(ocIpcTransport transport);
 };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ocTypes.h" // ocMessageId
+
+#include <cstdint> // _t types
+#include <type_traits> // std::is_trivially_copyable_v, std::is_same_v
+
+/**
+ * Payloads of messages that are sent as a single struct instead of being
+ * written field by field. Each payload names its message id and has to be
+ * registered in ocRegisteredMessages below. Registered payloads are sent with
+ * ocIpcSocket::send(const Msg&) and read with ocPacket::read(Msg*) or
+ * ocPacketView::read(Msg*), which only accept packets of the right id and
+ * length. The IPC hub drops registered messages with a wrong length.
+ *
+ * The sizes are checked here, so a changed layout shows up at build time.
+ * Padding is spelled out, so no uninitialized bytes go over the wire.
+ */
+
+struct ocLaneDetectionValues final
+{
+    static constexpr ocMessageId message_id = ocMessageId::Lane_Detection_Values;
+
+    int16_t speed;
+    int8_t  steering_front;
+    int8_t  steering_rear;
+    uint8_t _padding[4] = {};
+    // exposure of the camera frame the values were computed from, null if
+    // values from that frame were already sent
+    ocTime  frame_time = ocTime::null();
+};
+static_assert(16 == sizeof(ocLaneDetectionValues));
+
+struct ocTrafficSignDetected final
+{
+    static constexpr ocMessageId message_id = ocMessageId::Traffic_Sign_Detected;
+
+    uint16_t sign_type; // TrafficSignType of the traffic sign detection
+    uint8_t  _padding[6] = {};
+    uint64_t distance;  // in cm
+};
+static_assert(16 == sizeof(ocTrafficSignDetected));
+
+// Object_Found carries an ocDetectedObject, which is defined in ocTypes.h.
+static_assert(24 == sizeof(ocDetectedObject));
+
+struct ocStartDrivingTask final
+{
+    static constexpr ocMessageId message_id = ocMessageId::Start_Driving_Task;
+
+    int16_t speed;
+    int8_t  steering_front;
+    int8_t  steering_rear;
+    // The highest bit tells the car to stop after the given steps.
+    uint8_t id;
+    uint8_t _padding[3] = {};
+    int32_t steps_ab;
+    uint8_t _padding2[4] = {};
+    // Exposure of the camera frame the task was computed from, null if it
+    // doesn't come from one or an earlier task already did. Used to measure
+    // the latency until it's sent.
+    ocTime  frame_time = ocTime::null();
+};
+static_assert(24 == sizeof(ocStartDrivingTask));
+
+template<typename ...Ts>
+struct ocMessageList final
+{
+    static_assert((std::is_trivially_copyable_v<Ts> && ...));
+
+    template<typename T>
+    static constexpr bool contains = (std::is_same_v<T, Ts> || ...);
+
+    static constexpr bool has_unique_ids()
+    {
+        const ocMessageId ids[] = {Ts::message_id...};
+        for (size_t i = 0; i < sizeof...(Ts); ++i)
+        {
+            for (size_t j = i + 1; j < sizeof...(Ts); ++j)
+            {
+                if (ids[i] == ids[j]) return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns the payload size of the given message or -1 if the message
+    // isn't in the list.
+    static constexpr int32_t payload_size(ocMessageId message_id)
+    {
+        int32_t size = -1;
+        ((message_id == Ts::message_id ? (void)(size = (int32_t)sizeof(Ts)) : (void)0), ...);
+        return size;
+    }
+};
+
+using ocRegisteredMessages = ocMessageList<
+    ocLaneDetectionValues,
+    ocTrafficSignDetected,
+    ocDetectedObject,
+    ocStartDrivingTask>;
+
+static_assert(ocRegisteredMessages::has_unique_ids());
+
+template<typename T>
+concept ocRegisteredMessage = ocRegisteredMessages::contains<T>;
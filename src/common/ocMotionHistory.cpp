@@ -0,0 +1,145 @@
+#include "ocMotionHistory.h"
+#include "ocAssert.h"
+
+#include <algorithm> // std::max, std::min
+
+ocMotionHistory::ocMotionHistory(ocCarProperties *properties)
+    : _properties(properties)
+{
+    oc_assert(properties);
+}
+
+const ocMotionHistory::Odometry& ocMotionHistory::get_odometry(size_t index) const
+{
+    return _odometry[(_odometry_next + capacity - _odometry_count + index) % capacity];
+}
+
+const ocMotionHistory::Command& ocMotionHistory::get_command(size_t index) const
+{
+    return _commands[(_command_next + capacity - _command_count + index) % capacity];
+}
+
+void ocMotionHistory::add_odometry(ocTime time, int32_t steps)
+{
+    if (0 < _odometry_count && time < get_odometry(_odometry_count - 1).time) return;
+    _odometry[_odometry_next] = {time, steps};
+    _odometry_next  = (_odometry_next + 1) % capacity;
+    _odometry_count = std::min(_odometry_count + 1, capacity);
+}
+
+void ocMotionHistory::add_command(ocTime time, int16_t speed, int8_t steering_front, int8_t steering_rear)
+{
+    if (0 < _command_count && time < get_command(_command_count - 1).time) return;
+    _commands[_command_next] = {
+        time,
+        (float)speed,
+        _properties->byte_to_front_steering_angle(steering_front),
+        _properties->byte_to_rear_steering_angle(steering_rear)
+    };
+    _command_next  = (_command_next + 1) % capacity;
+    _command_count = std::min(_command_count + 1, capacity);
+}
+
+void ocMotionHistory::clear()
+{
+    _odometry_count = 0;
+    _odometry_next  = 0;
+    _command_count  = 0;
+    _command_next   = 0;
+}
+
+// The odometry at a time between the first and the last sample, in cm.
+float ocMotionHistory::get_odometry_cm(ocTime time) const
+{
+    // Recent times are asked for most, so search from the newest sample.
+    size_t index = _odometry_count - 1;
+    while (0 < index && time < get_odometry(index - 1).time)
+    {
+        --index;
+    }
+    const Odometry &after = get_odometry(index);
+    if (0 == index || after.time <= time)
+    {
+        return _properties->steps_to_cm((float)after.steps);
+    }
+    const Odometry &before = get_odometry(index - 1);
+    float fraction = (time - before.time) / (after.time - before.time);
+    float steps = (float)before.steps + fraction * (float)(after.steps - before.steps);
+    return _properties->steps_to_cm(steps);
+}
+
+float ocMotionHistory::get_commanded_distance(ocTime from, ocTime to) const
+{
+    float distance = 0.0f;
+    for (size_t i = 0; i < _command_count; ++i)
+    {
+        const Command &command = get_command(i);
+        ocTime end = (i + 1 < _command_count) ? get_command(i + 1).time : to;
+        ocTime begin = std::max(command.time, from);
+        end = std::min(end, to);
+        if (begin < end)
+        {
+            distance += command.speed * (end - begin).get_float_seconds();
+        }
+    }
+    return distance;
+}
+
+float ocMotionHistory::get_distance(ocTime from, ocTime to) const
+{
+    if (to <= from) return 0.0f;
+    if (0 == _odometry_count) return get_commanded_distance(from, to);
+
+    ocTime first = get_odometry(0).time;
+    ocTime last  = get_odometry(_odometry_count - 1).time;
+    float distance = 0.0f;
+    if (from < first)
+    {
+        distance += get_commanded_distance(from, std::min(first, to));
+    }
+    if (last < to)
+    {
+        distance += get_commanded_distance(std::max(last, from), to);
+    }
+    ocTime begin = std::max(from, first);
+    ocTime end   = std::min(to, last);
+    if (begin < end)
+    {
+        distance += get_odometry_cm(end) - get_odometry_cm(begin);
+    }
+    return distance;
+}
+
+ocPose ocMotionHistory::get_motion(ocTime from, ocTime to, float *distance) const
+{
+    ocCarState car = {};
+    car.properties = _properties;
+    car.pose = ocPose(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    float total = 0.0f;
+
+    // Every command starts a piece of the path with its steering.
+    ocTime begin = from;
+    for (size_t i = 0; i < _command_count && begin < to; ++i)
+    {
+        const Command &command = get_command(i);
+        if (to <= command.time) break;
+        if (begin < command.time)
+        {
+            float piece = get_distance(begin, command.time);
+            car.pose = drive_car(car, piece);
+            total += piece;
+            begin = command.time;
+        }
+        car.steering_front = command.steering_front;
+        car.steering_rear  = command.steering_rear;
+    }
+    if (begin < to)
+    {
+        float piece = get_distance(begin, to);
+        car.pose = drive_car(car, piece);
+        total += piece;
+    }
+
+    if (distance) *distance = total;
+    return car.pose;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ocCar.h"
+#include "ocTime.h"
+
+#include <cstddef> // size_t
+#include <cstdint> // _t types
+
+/**
+ * Remembers the recent odometry and driving commands of the car, to tell how
+ * it moved between two points in time, e.g. from when a camera frame was
+ * exposed until now.
+ *
+ * The distance comes from the odometry, interpolated between its samples.
+ * Before the first and after the last sample, the commanded speed stands in
+ * for it. The path follows the steering of the commands, each one from the
+ * time it was sent, moved the same way as drive_car() in ocCar.h does.
+ *
+ * Samples have to be added in the order of their times, older ones are
+ * dropped. Poses are those of ocCarState, where y is to the right.
+ */
+class ocMotionHistory final
+{
+public:
+    static constexpr size_t capacity = 256;
+
+private:
+    struct Odometry
+    {
+        ocTime  time;
+        int32_t steps;
+    };
+
+    struct Command
+    {
+        ocTime time;
+        float  speed; // cm/s
+        float  steering_front;
+        float  steering_rear;
+    };
+
+    ocCarProperties *_properties;
+
+    Odometry _odometry[capacity];
+    size_t   _odometry_count = 0;
+    size_t   _odometry_next  = 0;
+
+    Command  _commands[capacity];
+    size_t   _command_count = 0;
+    size_t   _command_next  = 0;
+
+    const Odometry& get_odometry(size_t index) const;
+    const Command& get_command(size_t index) const;
+
+    float get_odometry_cm(ocTime time) const;
+    float get_commanded_distance(ocTime from, ocTime to) const;
+
+public:
+    explicit ocMotionHistory(ocCarProperties *properties);
+
+    // The absolute odometry steps, as sent with Received_Odo_Steps.
+    void add_odometry(ocTime time, int32_t steps);
+
+    // A driving command as sent with Start_Driving_Task, speed in cm/s.
+    void add_command(ocTime time, int16_t speed, int8_t steering_front, int8_t steering_rear);
+
+    void clear();
+
+    // The distance in cm the car drove between the two times.
+    [[nodiscard]] float get_distance(ocTime from, ocTime to) const;
+
+    /**
+     * Returns the pose at the time to, relative to the pose at the time from.
+     * The distance driven in between is written to distance if it is given.
+     * If to isn't after from, the car didn't move.
+     */
+    ocPose get_motion(ocTime from, ocTime to, float *distance = nullptr) const;
+};
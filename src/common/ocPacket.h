@@ -3,9 +3,11 @@
 #include "ocBuffer.h"
 #include "ocBufferReader.h"
 #include "ocBufferWriter.h"
+#include "ocMessages.h"
 #include "ocTypes.h" // ocMemberId, ocMessageId
 
 #include <cstdint> // _t types
+#include <cstring> // memcpy
 
 class ocPacket final
 {
@@ -80,4 +82,95 @@ public:
     {
         return _payload.read_from_start();
     }
+
+    // Sets the message id and makes the given struct the whole payload.
+    template<ocRegisteredMessage Msg>
+    void write(const Msg &msg)
+    {
+        _message_id = Msg::message_id;
+        _payload.clear_and_edit().write(&msg, sizeof(Msg));
+    }
+
+    // Copies the payload into the given struct. Returns false if the packet
+    // has a different message id or length, msg is left untouched then.
+    template<ocRegisteredMessage Msg>
+    [[nodiscard]] bool read(Msg *msg) const;
+};
+
+/**
+ * Non-owning view of a packet, e.g. straight into a shared memory ring. A view
+ * handed out by ocIpcSocket::peek_packet is only valid until release_packet.
+ */
+class ocPacketView final
+{
+private:
+    ocMessageId      _message_id = ocMessageId::None;
+    ocMemberId       _sender     = ocMemberId::None;
+    const std::byte *_data       = nullptr;
+    uint32_t         _length     = 0;
+
+public:
+    ocPacketView() = default;
+    ocPacketView(
+        ocMessageId message_id,
+        ocMemberId sender,
+        const std::byte *data,
+        uint32_t length)
+    {
+        _message_id = message_id;
+        _sender = sender;
+        _data = data;
+        _length = length;
+    }
+    explicit ocPacketView(const ocPacket &packet)
+    {
+        _message_id = packet.get_message_id();
+        _sender = packet.get_sender();
+        _length = packet.get_length();
+        _data = packet.get_payload()->get_space(_length);
+    }
+
+    ocMessageId get_message_id() const
+    {
+        return _message_id;
+    }
+    ocMemberId get_sender() const
+    {
+        return _sender;
+    }
+    void set_sender(ocMemberId sender)
+    {
+        _sender = sender;
+    }
+    const std::byte *get_data() const
+    {
+        return _data;
+    }
+    uint32_t get_length() const
+    {
+        return _length;
+    }
+
+    template<ocRegisteredMessage Msg>
+    [[nodiscard]] bool read(Msg *msg) const
+    {
+        if (Msg::message_id != _message_id || sizeof(Msg) != _length) return false;
+        memcpy((void *)msg, _data, sizeof(Msg));
+        return true;
+    }
+
+    // Copies the header and payload into a real packet, e.g. to parse it with
+    // an ocBufferReader.
+    void copy_to(ocPacket &packet) const
+    {
+        packet.set_header(_message_id, _sender);
+        auto writer = packet.clear_and_edit();
+        if (0 < _length) writer.write(_data, _length);
+    }
 };
+
+template<ocRegisteredMessage Msg>
+bool ocPacket::read(Msg *msg) const
+{
+    return ocPacketView(*this).read(msg);
+}
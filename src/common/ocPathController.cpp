@@ -0,0 +1,71 @@
+#include "ocPathController.h"
+
+#include <algorithm> // std::clamp, std::min
+#include <cmath> // sqrt, hypot, atan2
+
+bool ocPathController::update(const ocCarState &car, float duration, Command *command)
+{
+    if (!_lane.is_valid())
+    {
+        _speed = 0.0f;
+        return false;
+    }
+
+    // The lane circle in the coordinates of the car as it is now.
+    float cos_h = std::cos(car.pose.heading);
+    float sin_h = std::sin(car.pose.heading);
+    float dx = _lane.curve_center_x - car.pose.pos.x;
+    float dy = _lane.curve_center_y - car.pose.pos.y;
+    float center_x =  cos_h * dx + sin_h * dy;
+    float center_y = -sin_h * dx + cos_h * dy;
+    float radius = _lane.curve_radius;
+    float dist = std::hypot(center_x, center_y);
+    if (dist < 1.0f)
+    {
+        _speed = 0.0f;
+        return false;
+    }
+
+    // From the point of the lane closest to the car, go ahead along the lane.
+    float normal_x = -center_x / dist;
+    float normal_y = -center_y / dist;
+    float tangent_x = -normal_y;
+    float tangent_y =  normal_x;
+    float direction = 1.0f;
+    if (tangent_x < 0.0f)
+    {
+        tangent_x = -tangent_x;
+        tangent_y = -tangent_y;
+        direction = -1.0f;
+    }
+    float lookahead = _settings.min_lookahead + _settings.lookahead_time * _speed;
+    float angle = direction * lookahead / radius;
+    float cos_a = std::cos(angle);
+    float sin_a = std::sin(angle);
+    float target_x = center_x + radius * (cos_a * normal_x - sin_a * normal_y);
+    float target_y = center_y + radius * (sin_a * normal_x + cos_a * normal_y);
+    float target_heading = std::atan2(sin_a * tangent_x + cos_a * tangent_y, cos_a * tangent_x - sin_a * tangent_y);
+
+    ocCarState local = car;
+    local.pose = ocPose(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    if (0.0f == target_heading)
+    {
+        // target_to_steering() doesn't move sideways without turning
+        float crab = std::clamp(std::atan2(target_y, target_x),
+                                std::max(car.properties->min_steering_angle_front, car.properties->min_steering_angle_rear),
+                                std::min(car.properties->max_steering_angle_front, car.properties->max_steering_angle_rear));
+        command->steering_front = crab;
+        command->steering_rear  = crab;
+    }
+    else
+    {
+        local.target_to_steering(target_x, target_y, target_heading, &command->steering_front, &command->steering_rear);
+    }
+
+    float target_speed = std::clamp(std::sqrt(_settings.max_lateral_acceleration * radius), _settings.min_speed, _settings.max_speed);
+    _speed = std::clamp(target_speed,
+                        _speed - _settings.max_deceleration * duration,
+                        _speed + _settings.max_acceleration * duration);
+    command->speed = _speed;
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ocCar.h"
+#include "ocTypes.h" // ocLaneData
+
+/**
+ * Steers the car along the lane at a fixed control rate, independent of the
+ * camera. Between two lanes from the camera the car keeps moving, so every
+ * call gets the pose of the car relative to where it was when the lane was
+ * seen, see drive_car() in ocCar.h.
+ *
+ * The controller looks ahead along the lane by a distance that grows with
+ * the speed, and steers front and rear axle so the car reaches that point
+ * with the heading of the lane there, see ocCarState::target_to_steering().
+ * On a curve that is the curve itself. The speed follows the curvature, so
+ * the lateral acceleration stays below a limit.
+ *
+ * The lane and the poses are in the coordinates of ocCarState, x is forward
+ * and y is to the right, and positive angles steer to the right.
+ */
+class ocPathController final
+{
+public:
+    struct Settings
+    {
+        // cm to look ahead, plus how far the car gets in lookahead_time s
+        float min_lookahead = 30.0f;
+        float lookahead_time = 0.4f;
+        // cm/s, the car was only tuned for 60, so it keeps that speed in
+        // curves too unless these are set apart
+        float min_speed = 60.0f;
+        float max_speed = 60.0f;
+        // cm/s^2, the speed in a curve of radius r is sqrt(a * r)
+        float max_lateral_acceleration = 60.0f;
+        // cm/s^2, how fast the speed may change between two calls
+        float max_acceleration = 100.0f;
+        float max_deceleration = 400.0f;
+    };
+
+    struct Command
+    {
+        float speed; // cm/s
+        float steering_front;
+        float steering_rear;
+    };
+
+private:
+    Settings   _settings;
+    ocLaneData _lane = {};
+    float      _speed = 0.0f;
+
+public:
+    ocPathController() = default;
+    explicit ocPathController(const Settings &settings) : _settings(settings) {}
+
+    /**
+     * Sets the lane the car follows. Poses given to update() are relative to
+     * where the car was when the lane was seen. An invalid lane stops the
+     * controller until it gets the next one.
+     */
+    void set_lane(const ocLaneData &lane) { _lane = lane; }
+    [[nodiscard]] bool has_lane() const { return _lane.is_valid(); }
+
+    /**
+     * Computes the next command for a car at car.pose. duration is the time
+     * since the last call in s, it limits how much the speed changes.
+     * Returns false if there is no lane, the speed then starts from 0 again.
+     */
+    bool update(const ocCarState &car, float duration, Command *command);
+
+    // The speed of the last command in cm/s.
+    [[nodiscard]] float get_speed() const { return _speed; }
+};
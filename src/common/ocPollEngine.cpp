@@ -17,23 +17,40 @@ ocPollEngine::ocPollEngine(uint32_t max_size)
     _max_events = max_size;
 }
 
+static uint32_t to_epoll_events(ocPollDirection direction)
+{
+    switch (direction)
+    {
+        case ocPollDirection::None:       return 0;
+        case ocPollDirection::Read:       return EPOLLIN;
+        case ocPollDirection::Write:      return EPOLLOUT;
+        case ocPollDirection::Read_Write: return EPOLLIN | EPOLLOUT;
+    }
+    return 0;
+}
+
 ocPollReport ocPollEngine::add_fd(int fd, ocPollDirection direction)
 {
     oc_assert(_fd_count != _max_events);
     _fd_count++;
     epoll_event ev;
     ev.data.fd = fd;
-    switch (direction)
-    {
-        case ocPollDirection::Read:       ev.events = EPOLLIN; break;
-        case ocPollDirection::Write:      ev.events = EPOLLOUT; break;
-        case ocPollDirection::Read_Write: ev.events = EPOLLIN | EPOLLOUT; break;
-    }
+    ev.events = to_epoll_events(direction);
     int res = epoll_ctl(_ev_fd, EPOLL_CTL_ADD, fd, &ev);
     if (-1 == res) return ocPollReport::Failure;
     return ocPollReport::Success;
 }
 
+ocPollReport ocPollEngine::modify_fd(int fd, ocPollDirection direction)
+{
+    epoll_event ev;
+    ev.data.fd = fd;
+    ev.events = to_epoll_events(direction);
+    int res = epoll_ctl(_ev_fd, EPOLL_CTL_MOD, fd, &ev);
+    if (-1 == res) return ocPollReport::Failure;
+    return ocPollReport::Success;
+}
+
 ocPollReport ocPollEngine::delete_fd(int fd)
 {
     oc_assert(_fd_count);
@@ -64,3 +81,23 @@ bool ocPollEngine::was_triggered(int fd) const
     }
     return false;
 }
+
+bool ocPollEngine::was_triggered(int fd, ocPollDirection direction) const
+{
+    uint32_t events = to_epoll_events(direction);
+    if (events & EPOLLIN) events |= EPOLLHUP | EPOLLERR;
+    for (int32_t i = 0; i < _last_event_count; ++i)
+    {
+        if (_event_buffer[i].data.fd == fd) return 0 != (_event_buffer[i].events & events);
+    }
+    return false;
+}
+
+bool ocPollEngine::was_hung_up(int fd) const
+{
+    for (int32_t i = 0; i < _last_event_count; ++i)
+    {
+        if (_event_buffer[i].data.fd == fd) return 0 != (_event_buffer[i].events & (EPOLLHUP | EPOLLERR));
+    }
+    return false;
+}
@@ -12,6 +12,8 @@ enum class ocPollReport
 
 enum class ocPollDirection
 {
+    // stays on the watchlist, but only reports hangups and errors
+    None       = 0,
     Read       = 1,
     Write      = 2,
     Read_Write = 3
@@ -54,6 +56,12 @@ public:
      */
     ocPollReport add_fd(int fd, ocPollDirection direction = ocPollDirection::Read);
 
+    /**
+     * Changes the direction a file descriptor on the watchlist is watched for,
+     * e.g. to only wait for write readiness while there is something to write.
+     */
+    ocPollReport modify_fd(int fd, ocPollDirection direction);
+
     /**
      * Removes a file descriptors from the watchlist.
      */
@@ -80,4 +88,16 @@ public:
      * changes when the poll() function was last called.
      */
     bool was_triggered(int fd) const;
+
+    /**
+     * Same as above, but only for the given direction. Hangups and errors count
+     * as read events, so a read will report them.
+     */
+    bool was_triggered(int fd, ocPollDirection direction) const;
+
+    /**
+     * Returns weather the given file descriptor reported a hangup or an error.
+     * These are reported even for file descriptors watched for nothing.
+     */
+    bool was_hung_up(int fd) const;
 };
@@ -1,6 +1,7 @@
 #include "ocAssert.h"
 #include "ocProfiler.h"
 
+#include <atomic>
 #include <cstring> // memmove, strlen
 #include <cstdlib> // size_t
 #include <ctime> // clock_gettime, timespec
@@ -9,7 +10,10 @@ static ocTimingEvent timing_event_store[TIMING_EVENT_STORE_SIZE] = {};
 
 // pointer to the next place to write a new event or site
 ocTimingSite *next_timing_site  = nullptr;
-static ocTimingEvent *next_timing_event = &timing_event_store[0];
+static std::atomic<uint32_t> next_timing_event_index = 0;
+
+static std::atomic<uint8_t> next_thread_index = 0;
+static thread_local uint8_t thread_index = next_thread_index++;
 
 // pointers to the events and sites that have not been transmitted
 // over ipc yet. Should be reset after transmission.
@@ -29,17 +33,19 @@ void _log_timing_event(uint16_t site_index, ocTimingEventType event_type)
   cpu_time_ns += cpu_ts.tv_nsec;
   cpu_time_ns += cpu_ts.tv_sec * 1000000000L;
 
-  oc_assert(next_timing_event < &timing_event_store[TIMING_EVENT_STORE_SIZE]);
-  ocTimingEvent *event = next_timing_event++;
+  uint32_t index = next_timing_event_index.fetch_add(1, std::memory_order_relaxed);
+  oc_assert(index < TIMING_EVENT_STORE_SIZE, index);
+  ocTimingEvent *event = &timing_event_store[index];
   event->real_time  = (uint32_t)real_time_ns;
   event->cpu_time   = (uint32_t)cpu_time_ns;
   event->type       = event_type;
   event->site_index = site_index;
+  event->stuff      = thread_index;
 }
 
 void clear_timing_events()
 {
-  next_timing_event = &timing_event_store[0];
+  next_timing_event_index = 0;
 }
 
 uint32_t timing_site_count()
@@ -50,7 +56,7 @@ uint32_t timing_site_count()
 
 uint32_t timing_event_count()
 {
-  return (uint32_t) (next_timing_event - &timing_event_store[0]);
+  return next_timing_event_index;
 }
 
 uint32_t write_timing_sites_to_buffer(ocBuffer *buffer)
@@ -84,22 +90,18 @@ uint32_t write_timing_sites_to_buffer(ocBuffer *buffer)
 uint32_t write_timing_events_to_buffer(ocBuffer *buffer)
 {
   uint32_t counter = 0;
-  ocTimingEvent *event = &timing_event_store[0];
+  uint32_t event_count = next_timing_event_index;
   auto editor = buffer->clear_and_edit();
-  while (event != next_timing_event && editor.can_write<ocTimingEvent>())
+  while (counter < event_count && editor.can_write<ocTimingEvent>())
   {
-    editor.write<ocTimingEvent>(*event++);
+    editor.write<ocTimingEvent>(timing_event_store[counter]);
     ++counter;
   }
-  if (event != next_timing_event)
-  {
-    size_t remaining = (size_t)(next_timing_event - event);
-    memmove(&timing_event_store[0], event, remaining * sizeof(ocTimingEvent));
-    next_timing_event = &timing_event_store[remaining];
-  }
-  else
+  uint32_t remaining = event_count - counter;
+  if (0 < remaining)
   {
-    next_timing_event = &timing_event_store[0];
+    memmove(&timing_event_store[0], &timing_event_store[counter], remaining * sizeof(ocTimingEvent));
   }
+  next_timing_event_index = remaining;
   return counter;
 }
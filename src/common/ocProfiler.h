@@ -4,11 +4,9 @@
 
 #include <cstdint> // uint64_t
 
-// This profiler doesn't handle multi-threading yet. Which shouldn't be a problem because
-// we usually have just a single thread and multiple processes. But if you need profiling
-// for multiple threads, here are some things you need to do:
-// - Add a thread ID to the ocTimingEvent.
-// - Put an atomic increment in the c file for the next_event_index variable.
+// Events can be logged from multiple threads, each event carries the index of the thread
+// that logged it in its stuff byte. The events and sites are only written out by one thread
+// though, and only while no other thread is logging, e.g. while a worker pool is idle.
 
 #define TIMING_EVENT_STORE_SIZE 1024
 
@@ -117,6 +115,8 @@ struct ocTimingEvent
   ocTimingEventType type;
 
   // These bytes are there anyways because of padding. So let's make them usable!
+  // Holds the index of the thread that logged the event, in the order the threads
+  // logged their first event.
   uint8_t stuff;
 };
 
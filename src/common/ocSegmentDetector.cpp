@@ -0,0 +1,178 @@
+#include "ocSegmentDetector.h"
+
+#include <algorithm> // std::min, std::max, std::fill
+#include <cmath> // sqrt, atan2
+
+// Gradient magnitude (L2 of the Sobel filter) a pixel needs to be an edge, and
+// to start a region. Same as the Canny thresholds the edge image had before.
+static constexpr uint32_t EDGE_MAGNITUDE = 40;
+static constexpr uint32_t SEED_MAGNITUDE = 170;
+
+// Edge pixels join a region if their gradient points at most this far away
+// from the one of the region, 22.5 degrees like LSD.
+static constexpr int ANGLE_TOLERANCE = 16;
+
+// Smaller regions are noise, they don't show up in the edges either.
+static constexpr uint32_t MIN_REGION_SIZE = 10;
+
+// Shorter regions don't become segments, in pixels.
+static constexpr float MIN_LENGTH = 15.0f;
+
+static constexpr float DIRECTION_TO_RADIANS = (float)M_PI / 128.0f;
+
+static uint8_t to_direction(float radians)
+{
+    return (uint8_t)((int)std::lround(radians / DIRECTION_TO_RADIANS) & 0xFF);
+}
+
+static int direction_difference(uint8_t a, uint8_t b)
+{
+    return std::abs((int)(int8_t)(uint8_t)(a - b));
+}
+
+ocSegmentDetector::ocSegmentDetector(uint32_t width, uint32_t height, uint32_t max_segments)
+    : _width(width), _height(height),
+      _magnitude(width * height), _direction(width * height),
+      _used(width * height), _edges(width * height),
+      _region(width * height), _segments(max_segments)
+{
+}
+
+void ocSegmentDetector::_compute_gradient(const uint8_t *image)
+{
+    const uint32_t w = _width;
+    const int stride = (int)_width;
+    std::fill(_magnitude.begin(), _magnitude.begin() + w, 0);
+    std::fill(_magnitude.end() - w, _magnitude.end(), 0);
+    for (uint32_t y = 1; y + 1 < _height; ++y)
+    {
+        const uint8_t *p = image + y * w;
+        uint16_t *magnitude = _magnitude.data() + y * w;
+        uint8_t *direction = _direction.data() + y * w;
+        magnitude[0] = 0;
+        magnitude[w - 1] = 0;
+        for (uint32_t x = 1; x + 1 < w; ++x)
+        {
+            const uint8_t *q = p + x;
+            int gx = (q[1 - stride] + 2 * q[1] + q[1 + stride])
+                   - (q[-1 - stride] + 2 * q[-1] + q[-1 + stride]);
+            int gy = (q[stride - 1] + 2 * q[stride] + q[stride + 1])
+                   - (q[-stride - 1] + 2 * q[-stride] + q[-stride + 1]);
+            int squared = gx * gx + gy * gy;
+            if (squared < (int)(EDGE_MAGNITUDE * EDGE_MAGNITUDE))
+            {
+                magnitude[x] = 0;
+                continue;
+            }
+            magnitude[x] = (uint16_t)std::sqrt((float)squared);
+            direction[x] = to_direction(std::atan2((float)gy, (float)gx));
+        }
+    }
+}
+
+void ocSegmentDetector::_grow_region(uint32_t seed)
+{
+    const int w = (int)_width;
+    const int neighbours[8] = {-w - 1, -w, -w + 1, -1, 1, w - 1, w, w + 1};
+
+    uint32_t size = 0;
+    float sum_cos = 0.0f, sum_sin = 0.0f;
+    uint8_t region_direction = _direction[seed];
+    _used[seed] = 1;
+    _region[size++] = seed;
+    sum_cos += std::cos(region_direction * DIRECTION_TO_RADIANS);
+    sum_sin += std::sin(region_direction * DIRECTION_TO_RADIANS);
+
+    // Pixels on the border have no magnitude, so neighbours of region pixels
+    // are always inside the image.
+    for (uint32_t next = 0; next < size; ++next)
+    {
+        uint32_t pixel = _region[next];
+        for (int offset : neighbours)
+        {
+            uint32_t neighbour = pixel + offset;
+            if (0 == _magnitude[neighbour] || _used[neighbour] ||
+                ANGLE_TOLERANCE < direction_difference(_direction[neighbour], region_direction))
+            {
+                continue;
+            }
+            _used[neighbour] = 1;
+            _region[size++] = neighbour;
+            float radians = _direction[neighbour] * DIRECTION_TO_RADIANS;
+            sum_cos += std::cos(radians);
+            sum_sin += std::sin(radians);
+            region_direction = to_direction(std::atan2(sum_sin, sum_cos));
+        }
+    }
+
+    if (size < MIN_REGION_SIZE) return;
+
+    // Main axis of the pixels, weighted by their magnitude.
+    double sum = 0, sum_x = 0, sum_y = 0, sum_xx = 0, sum_yy = 0, sum_xy = 0;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        uint32_t pixel = _region[i];
+        double weight = _magnitude[pixel];
+        double x = pixel % _width;
+        double y = pixel / _width;
+        sum += weight;
+        sum_x += weight * x;
+        sum_y += weight * y;
+        sum_xx += weight * x * x;
+        sum_yy += weight * y * y;
+        sum_xy += weight * x * y;
+        _edges[pixel] = (uint8_t)std::min<uint16_t>(_magnitude[pixel], 255);
+    }
+    double center_x = sum_x / sum;
+    double center_y = sum_y / sum;
+    double xx = sum_xx / sum - center_x * center_x;
+    double yy = sum_yy / sum - center_y * center_y;
+    double xy = sum_xy / sum - center_x * center_y;
+    double angle = 0.5 * std::atan2(2.0 * xy, xx - yy);
+    double axis_x = std::cos(angle);
+    double axis_y = std::sin(angle);
+
+    double first = INFINITY, last = -INFINITY;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        uint32_t pixel = _region[i];
+        double along = (double)(pixel % _width - center_x) * axis_x
+                     + (double)(pixel / _width - center_y) * axis_y;
+        first = std::min(first, along);
+        last = std::max(last, along);
+    }
+
+    float length = (float)(last - first);
+    // Once the arena is full the remaining segments get lost, the edges are
+    // still complete.
+    if (length < MIN_LENGTH || _segments.size() <= _segment_count) return;
+
+    float degrees = (float)(angle * 180.0 / M_PI);
+    if (degrees < 0.0f) degrees += 180.0f;
+    if (180.0f <= degrees) degrees -= 180.0f;
+
+    ocLineSegment &segment = _segments[_segment_count++];
+    segment.x1 = (float)(center_x + first * axis_x);
+    segment.y1 = (float)(center_y + first * axis_y);
+    segment.x2 = (float)(center_x + last * axis_x);
+    segment.y2 = (float)(center_y + last * axis_y);
+    segment.length = length;
+    segment.angle = degrees;
+}
+
+uint32_t ocSegmentDetector::detect(const uint8_t *image)
+{
+    _segment_count = 0;
+    std::fill(_used.begin(), _used.end(), 0);
+    std::fill(_edges.begin(), _edges.end(), 0);
+
+    _compute_gradient(image);
+
+    const uint32_t size = _width * _height;
+    for (uint32_t pixel = 0; pixel < size; ++pixel)
+    {
+        if (_magnitude[pixel] < SEED_MAGNITUDE || _used[pixel]) continue;
+        _grow_region(pixel);
+    }
+    return _segment_count;
+}
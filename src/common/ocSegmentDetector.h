@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint> // _t types
+#include <vector>
+
+struct ocLineSegment final
+{
+    float x1, y1;
+    float x2, y2;
+    float length;
+    // direction of the line in degrees from 0 up to 180, 0 is along the x
+    // axis and 90 along the y axis
+    float angle;
+};
+
+/**
+ * Finds straight edges in a gray image, like a Canny edge detector followed
+ * by tracing and simplifying the contours, but in one go and without
+ * allocations per image.
+ *
+ * The gradient of every pixel is computed with a 3x3 Sobel filter. Strong
+ * edge pixels start a region, which grows into neighbouring edge pixels
+ * whose gradient points in about the same direction (hysteresis like Canny,
+ * grouping like LSD). A region that is long enough becomes a segment along
+ * its main axis. The two sides of a bright line have opposite gradients and
+ * become two segments.
+ *
+ * The input should be smoothed already, e.g. by the blur of an ocBevEngine
+ * view.
+ */
+class ocSegmentDetector final
+{
+private:
+    uint32_t _width;
+    uint32_t _height;
+    // gradient magnitude, 0 for pixels below the edge threshold
+    std::vector<uint16_t> _magnitude;
+    // gradient direction, a full turn is 256
+    std::vector<uint8_t>  _direction;
+    // pixels that belong to a region already
+    std::vector<uint8_t>  _used;
+    std::vector<uint8_t>  _edges;
+    // pixel indices of the region that is grown, reused for every region
+    std::vector<uint32_t> _region;
+    std::vector<ocLineSegment> _segments;
+    uint32_t _segment_count = 0;
+
+    void _compute_gradient(const uint8_t *image);
+    void _grow_region(uint32_t seed);
+
+public:
+    ocSegmentDetector(uint32_t width, uint32_t height, uint32_t max_segments = 1024);
+
+    // Finds the segments of an image with the size given to the constructor.
+    // Returns the number of segments.
+    uint32_t detect(const uint8_t *image);
+
+    // The segments of the last image, valid until the next detect().
+    [[nodiscard]] const ocLineSegment *get_segments() const { return _segments.data(); }
+    [[nodiscard]] uint32_t get_segment_count() const { return _segment_count; }
+
+    /**
+     * Gradient magnitude of the pixels of all regions of the last image, 0
+     * everywhere else. Curved edges are in here as well, even if they didn't
+     * make it into a segment.
+     */
+    [[nodiscard]] const uint8_t *get_edges() const { return _edges.data(); }
+};
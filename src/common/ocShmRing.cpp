@@ -0,0 +1,210 @@
+#include "ocShmRing.h"
+#include "ocAssert.h"
+#include "ocFutex.h"
+
+#include <cstring> // memcpy
+#include <new> // placement new
+
+// marks the unused rest at the end of the ring
+static constexpr uint32_t Ring_Padding = 0xFFFFFFFF;
+
+static size_t align_record(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+size_t ocShmRing::memory_size(uint32_t capacity)
+{
+    return sizeof(ocShmRingHeader) + capacity;
+}
+
+void ocShmRing::init(void *memory, uint32_t capacity)
+{
+    oc_assert(memory);
+    oc_assert(8 <= capacity && 0 == (capacity & (capacity - 1)), capacity);
+    ocShmRingHeader *header = new (memory) ocShmRingHeader;
+    header->write_pos.store(0);
+    header->read_pos.store(0);
+    // Start out waiting, so the first packet always rings the doorbell, even
+    // if the consumer never read from the ring before it went to sleep.
+    header->consumer_waiting.store(1);
+    header->capacity = capacity;
+    header->producer_waiting.store(0);
+    header->space_freed.store(0);
+    attach(memory);
+}
+
+void ocShmRing::attach(void *memory)
+{
+    oc_assert(memory);
+    _header = (ocShmRingHeader *)memory;
+    _data = (std::byte *)memory + sizeof(ocShmRingHeader);
+    _capacity = _header->capacity;
+    _peeked_size = 0;
+}
+
+bool ocShmRing::is_attached() const
+{
+    return nullptr != _header;
+}
+
+uint32_t ocShmRing::get_capacity() const
+{
+    return _capacity;
+}
+
+bool ocShmRing::can_ever_fit(size_t length) const
+{
+    return align_record(sizeof(ocShmRingRecord) + length) <= _capacity;
+}
+
+bool ocShmRing::write(ocMessageId message_id, ocMemberId sender_id, const void *data, size_t length)
+{
+    oc_assert(_header);
+    oc_assert(can_ever_fit(length), length, _capacity);
+
+    size_t record_size = align_record(sizeof(ocShmRingRecord) + length);
+
+    uint64_t write_pos = _header->write_pos.load(std::memory_order_relaxed);
+    uint64_t read_pos  = _header->read_pos.load(std::memory_order_acquire);
+
+    size_t offset     = (size_t)(write_pos & (_capacity - 1));
+    size_t contiguous = _capacity - offset;
+    size_t needed     = record_size;
+    if (contiguous < record_size) needed += contiguous;
+
+    if (_capacity - (write_pos - read_pos) < needed) return false;
+
+    if (contiguous < record_size)
+    {
+        ocShmRingRecord padding = {ocMessageId::None, ocMemberId::None, Ring_Padding};
+        memcpy(_data + offset, &padding, sizeof(ocShmRingRecord));
+        write_pos += contiguous;
+        offset = 0;
+    }
+
+    ocShmRingRecord record = {message_id, sender_id, (uint32_t)length};
+    memcpy(_data + offset, &record, sizeof(ocShmRingRecord));
+    if (0 < length) memcpy(_data + offset + sizeof(ocShmRingRecord), data, length);
+
+    // seq_cst, so this store can't be reordered with the load of
+    // consumer_waiting in take_wakeup.
+    _header->write_pos.store(write_pos + record_size, std::memory_order_seq_cst);
+    return true;
+}
+
+bool ocShmRing::can_write(const ocPacket *const *packets, size_t count) const
+{
+    oc_assert(_header);
+
+    uint64_t write_pos = _header->write_pos.load(std::memory_order_relaxed);
+    uint64_t read_pos  = _header->read_pos.load(std::memory_order_acquire);
+
+    // the same steps as write(), without writing anything
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t length = packets[i]->get_length();
+        if (!can_ever_fit(length)) return false;
+        size_t record_size = align_record(sizeof(ocShmRingRecord) + length);
+        size_t offset      = (size_t)(write_pos & (_capacity - 1));
+        size_t contiguous  = _capacity - offset;
+        size_t needed      = record_size;
+        if (contiguous < record_size) needed += contiguous;
+        if (_capacity - (write_pos - read_pos) < needed) return false;
+        write_pos += needed;
+    }
+    return true;
+}
+
+bool ocShmRing::_fits(size_t length) const
+{
+    size_t record_size = align_record(sizeof(ocShmRingRecord) + length);
+
+    uint64_t write_pos = _header->write_pos.load(std::memory_order_relaxed);
+    // seq_cst, so this load can't be reordered with the store of
+    // producer_waiting in wait_for_space.
+    uint64_t read_pos  = _header->read_pos.load(std::memory_order_seq_cst);
+
+    size_t offset     = (size_t)(write_pos & (_capacity - 1));
+    size_t contiguous = _capacity - offset;
+    size_t needed     = record_size;
+    if (contiguous < record_size) needed += contiguous;
+    return needed <= _capacity - (write_pos - read_pos);
+}
+
+void ocShmRing::wait_for_space(size_t length, ocTime timeout)
+{
+    oc_assert(_header);
+    oc_assert(can_ever_fit(length), length, _capacity);
+
+    // Announce the wait before checking again, so either the consumer sees
+    // the flag or we see the room it made.
+    uint32_t space_freed = _header->space_freed.load(std::memory_order_seq_cst);
+    _header->producer_waiting.store(1, std::memory_order_seq_cst);
+    if (!_fits(length)) futex_wait(&_header->space_freed, space_freed, timeout);
+    _header->producer_waiting.store(0, std::memory_order_relaxed);
+}
+
+bool ocShmRing::take_wakeup()
+{
+    oc_assert(_header);
+    if (0 == _header->consumer_waiting.load(std::memory_order_seq_cst)) return false;
+    return 0 != _header->consumer_waiting.exchange(0, std::memory_order_seq_cst);
+}
+
+bool ocShmRing::peek(ocPacketView &view)
+{
+    oc_assert(_header);
+    oc_assert(0 == _peeked_size, _peeked_size);
+
+    uint64_t read_pos = _header->read_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        uint64_t write_pos = _header->write_pos.load(std::memory_order_acquire);
+        if (read_pos == write_pos) return false;
+
+        size_t offset = (size_t)(read_pos & (_capacity - 1));
+        ocShmRingRecord record;
+        memcpy(&record, _data + offset, sizeof(ocShmRingRecord));
+
+        if (Ring_Padding == record.length)
+        {
+            read_pos += _capacity - offset;
+            _header->read_pos.store(read_pos, std::memory_order_release);
+            continue;
+        }
+
+        view = ocPacketView(
+            record.message_id,
+            record.sender_id,
+            _data + offset + sizeof(ocShmRingRecord),
+            record.length);
+        _peeked_size = (uint32_t)align_record(sizeof(ocShmRingRecord) + record.length);
+        return true;
+    }
+}
+
+void ocShmRing::pop()
+{
+    oc_assert(_header);
+    oc_assert(0 < _peeked_size);
+    uint64_t read_pos = _header->read_pos.load(std::memory_order_relaxed);
+    // seq_cst, so this store can't be reordered with the load of
+    // producer_waiting below.
+    _header->read_pos.store(read_pos + _peeked_size, std::memory_order_seq_cst);
+    _peeked_size = 0;
+
+    if (0 == _header->producer_waiting.load(std::memory_order_seq_cst)) return;
+    if (0 == _header->producer_waiting.exchange(0, std::memory_order_seq_cst)) return;
+    _header->space_freed.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(&_header->space_freed);
+}
+
+bool ocShmRing::prepare_wait()
+{
+    oc_assert(_header);
+    _header->consumer_waiting.store(1, std::memory_order_seq_cst);
+    uint64_t read_pos  = _header->read_pos.load(std::memory_order_relaxed);
+    uint64_t write_pos = _header->write_pos.load(std::memory_order_seq_cst);
+    return read_pos == write_pos;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ocPacket.h"
+#include "ocTime.h"
+#include "ocTypes.h" // ocMemberId, ocMessageId
+
+#include <atomic>
+#include <cstddef> // size_t, std::byte
+#include <cstdint> // _t types
+
+/**
+ * Control block at the start of every ring. It lives in shared memory, so the
+ * two processes only communicate through these atomics. The positions only
+ * ever grow, the offset into the data is position & (capacity - 1).
+ */
+struct ocShmRingHeader
+{
+    alignas(64) std::atomic<uint64_t> write_pos;
+    alignas(64) std::atomic<uint64_t> read_pos;
+    // Set by the consumer before it goes to sleep, cleared by the producer
+    // when it decides to ring the doorbell.
+    alignas(64) std::atomic<uint32_t> consumer_waiting;
+    uint32_t capacity;
+    // The same the other way around, set by a producer that waits for space
+    // and cleared by the consumer, which then bumps space_freed. The producer
+    // sleeps on space_freed as a futex.
+    alignas(64) std::atomic<uint32_t> producer_waiting;
+    std::atomic<uint32_t> space_freed;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+/**
+ * Every packet in the ring is prefixed by this record. Records are padded to
+ * 8 bytes, so there is always room for a record at the end of the ring to mark
+ * that the next packet starts at offset 0 again.
+ */
+struct ocShmRingRecord
+{
+    ocMessageId message_id;
+    ocMemberId  sender_id;
+    uint32_t    length;
+};
+
+static_assert(sizeof(ocShmRingRecord) == 8);
+
+/**
+ * Lock-free single-producer single-consumer ring of packets in shared memory.
+ * Packets are never split at the end of the ring, so a consumer can always
+ * look at a packet in place without copying it out first.
+ */
+class ocShmRing final
+{
+private:
+    ocShmRingHeader *_header   = nullptr;
+    std::byte       *_data     = nullptr;
+    uint32_t         _capacity = 0;
+
+    // size of the record handed out by the last peek, consumed by pop
+    uint32_t         _peeked_size = 0;
+
+    [[nodiscard]] bool _fits(size_t length) const;
+
+public:
+    /**
+     * Returns how many bytes of memory a ring with the given capacity needs.
+     * The capacity has to be a power of two.
+     */
+    [[nodiscard]] static size_t memory_size(uint32_t capacity);
+
+    /**
+     * Formats the given memory as an empty ring. Only one of the two processes
+     * does this, the other one just attaches.
+     */
+    void init(void *memory, uint32_t capacity);
+    void attach(void *memory);
+
+    [[nodiscard]] bool is_attached() const;
+    [[nodiscard]] uint32_t get_capacity() const;
+
+    /**
+     * Returns true if a packet with the given payload length can fit into the
+     * ring at all, regardless of how full it currently is.
+     */
+    [[nodiscard]] bool can_ever_fit(size_t length) const;
+
+    /**
+     * Producer side. Copies the packet into the ring and returns true, or
+     * returns false if there currently isn't enough space.
+     */
+    bool write(ocMessageId message_id, ocMemberId sender_id, const void *data, size_t length);
+
+    /**
+     * Producer side. Returns true if all the given packets, written one after
+     * the other, fit into the ring right now.
+     */
+    [[nodiscard]] bool can_write(const ocPacket *const *packets, size_t count) const;
+
+    /**
+     * Producer side. Has to be called after writing, returns true if the
+     * consumer is asleep and needs to be woken up.
+     */
+    [[nodiscard]] bool take_wakeup();
+
+    /**
+     * Producer side. Sleeps until the consumer made room for a packet with
+     * the given payload length or the timeout passed, whichever comes first.
+     * The consumer only makes room while it's awake, so it has to be woken up
+     * first if take_wakeup says so.
+     */
+    void wait_for_space(size_t length, ocTime timeout);
+
+    /**
+     * Consumer side. Points the view at the oldest packet in the ring and
+     * returns true, or returns false if the ring is empty. The view stays valid
+     * until pop is called.
+     */
+    [[nodiscard]] bool peek(ocPacketView &view);
+    // also wakes up a producer that waits for space
+    void pop();
+
+    /**
+     * Consumer side. Tells the producer that we want a wakeup for the next
+     * packet. Returns false if a packet arrived in the meantime, in that case
+     * the caller shouldn't go to sleep.
+     */
+    [[nodiscard]] bool prepare_wait();
+};
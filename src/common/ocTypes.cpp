@@ -57,11 +57,14 @@ const char *to_string(ocMessageId message_id)
   case ocMessageId::Mute_Member:              return "ocMessageId::Mute_Member";
   case ocMessageId::Ipc_Stats:                return "ocMessageId::Ipc_Stats";
   case ocMessageId::Disconnect_Me:            return "ocMessageId::Disconnect_Me";
+  case ocMessageId::Ring_Doorbell:            return "ocMessageId::Ring_Doorbell";
+  case ocMessageId::Subscribe_With_Policy:    return "ocMessageId::Subscribe_With_Policy";
   case ocMessageId::Camera_Image_Available:   return "ocMessageId::Camera_Image_Available";
   case ocMessageId::Binary_Image_Available:   return "ocMessageId::Binary_Image_Available";
   case ocMessageId::Birdseye_Image_Available: return "ocMessageId::Birdseye_Image_Available";
   case ocMessageId::Lane_Found:               return "ocMessageId::Lane_Found";
   case ocMessageId::Lines_Available:          return "ocMessageId::Lines_Available";
+  case ocMessageId::Bev_Region_Request:       return "ocMessageId::Bev_Region_Request";
   case ocMessageId::Set_Lights:               return "ocMessageId::Set_Lights";
   case ocMessageId::Start_Driving_Task:       return "ocMessageId::Start_Driving_Task";
   case ocMessageId::Ai_Switched_State:        return "ocMessageId::Ai_Switched_State";
@@ -153,6 +156,17 @@ const char *to_string(ocObjectType object_type)
   return "<unknown>";
 }
 
+const char *to_string(ocQueuePolicy policy)
+{
+  switch (policy)
+  {
+  case ocQueuePolicy::Fifo:           return "ocQueuePolicy::Fifo";
+  case ocQueuePolicy::Keep_Latest:    return "ocQueuePolicy::Keep_Latest";
+  case ocQueuePolicy::Block_Producer: return "ocQueuePolicy::Block_Producer";
+  }
+  return "<unknown>";
+}
+
 const char *to_string(ocImageType image_type)
 {
   switch (image_type)
@@ -63,6 +63,8 @@ enum class ocMessageId: uint16_t
     Mute_Member              = 0x08,
     Ipc_Stats                = 0x09,
     Disconnect_Me            = 0x0A,
+    Ring_Doorbell            = 0x0B,
+    Subscribe_With_Policy    = 0x0C,
 
     Camera_Image_Available   = 0x11,
     Binary_Image_Available   = 0x12,
@@ -71,6 +73,7 @@ enum class ocMessageId: uint16_t
     Lane_Found               = 0x22,
     Lines_Available          = 0x23,
     Intersection_Detected    = 0x24,
+    Bev_Region_Request       = 0x25,
 
     Set_Lights               = 0x48,
     Start_Driving_Task       = 0x49,
@@ -106,6 +109,23 @@ enum class ocMessageId: uint16_t
 
 const char *to_string(ocMessageId message_id);
 
+// What the IPC hub does with packets for a subscriber that can't keep up.
+// Members pick one per message with Subscribe_With_Policy, which carries
+// (ocMessageId, ocQueuePolicy, uint16_t queue limit) entries.
+enum class ocQueuePolicy : uint8_t
+{
+    // queue packets up to the limit and drop new ones after that
+    Fifo           = 0,
+    // only the newest packets are queued, older ones are replaced
+    Keep_Latest    = 1,
+    // Stop reading from the sender until the queue has space. Packets are only
+    // dropped once the whole queue of the receiver is at its limit, or if the
+    // sender can't be held back.
+    Block_Producer = 2
+};
+
+const char *to_string(ocQueuePolicy policy);
+
 enum class ocObjectType : uint32_t
 {
     None                        = 0x0000,
@@ -171,8 +191,11 @@ enum class ocObjectType : uint32_t
 
 const char *to_string(ocObjectType object_type);
 
+// Payload of Object_Found, registered in ocMessages.h.
 struct ocDetectedObject final
 {
+    static constexpr ocMessageId message_id = ocMessageId::Object_Found;
+
     // Type of the detected object. See enum above for all options.
     ocObjectType object_type;
 
@@ -258,25 +281,18 @@ struct ocLaneData final
 {
     ocTime   frame_time;
     uint32_t frame_number; // the camera frame this data was computed with
-    float    curve_center_x; // positive = left, negative = right
-    float    curve_center_y; // positive = forward, negative = backwards
+    // in cm, relative to the car, with the axes of ocCarState. lane_detection
+    // converts from its BEV pixels in circle_to_car().
+    float    curve_center_x; // positive = forward, negative = backwards
+    float    curve_center_y; // positive = right, negative = left
     float    curve_radius;
 
     bool is_valid() const { return 0.0f != curve_radius; }
 };
 
-struct ocCamData final
-{
-    ocTime   frame_time;
-    uint32_t frame_number;
-    uint32_t width;
-    uint32_t height;
-    ocPixelFormat pixel_format;
-    uint8_t  img_buffer[OC_CAM_BUFFER_SIZE];
-};
-
 struct ocBinData final
 {
+    uint32_t sequence; // odd while the slot is written, see ocFrameSlot.h
     ocTime   frame_time;
     uint32_t frame_number;
     uint32_t width;
@@ -286,6 +302,7 @@ struct ocBinData final
 
 struct ocBevData final
 {
+    uint32_t sequence; // odd while the slot is written, see ocFrameSlot.h
     ocTime   frame_time;
     uint32_t frame_number;
     int32_t  min_map_x, max_map_x;
@@ -299,39 +316,55 @@ struct ocBevData final
     uint8_t read_at(int32_t x, int32_t y) const;
 };
 
+// The birds eye views that Image_Processing renders.
+enum class ocBevViewId : uint8_t
+{
+    Lane         = 0,
+    Intersection = 1
+};
+
+// A row of pixels from x_begin up to x_end, in BEV image coordinates.
+// Bev_Region_Request carries (ocBevViewId, uint32_t span count, spans).
+// Image_Processing then only renders the requested pixels of that view,
+// together with the requests of the other members. Zero spans take the
+// request back. Members that read the whole image send OC_BEV_WHOLE_VIEW as
+// the span count instead, without spans, and the view is rendered completely
+// as long as such a request is there.
+struct ocBevSpan final
+{
+    uint16_t y;
+    uint16_t x_begin;
+    uint16_t x_end;
+};
+
 // Shared Memory
+// The image slots and the last_written_*_index fields are only accessed through
+// the functions in ocFrameSlot.h, so readers never see half written frames.
+// Camera frames are in the separate frame pool, see ocFramePool.h.
 struct ocSharedMemory final
 {
     uint64_t _canary0;
 
-    ocCamData cam_data[OC_NUM_CAM_BUFFERS];
-
-    uint64_t _canary1;
-
-    uint32_t last_written_cam_data_index;
-
-    uint64_t _canary2;
-
     ocBinData bin_data[OC_NUM_BIN_BUFFERS];
 
-    uint64_t _canary3;
+    uint64_t _canary1;
 
     uint32_t last_written_bin_data_index;
 
-    uint64_t _canary4;
+    uint64_t _canary2;
 
     ocBevData bev_data[OC_NUM_BEV_BUFFERS];
 
-    uint64_t _canary5;
+    uint64_t _canary3;
 
     uint32_t last_written_bev_data_index;
 
-    uint64_t _canary6;
+    uint64_t _canary4;
 
     // bit mask of the processes that are currently running
     uint16_t online_members;
 
-    uint64_t _canary7;
+    uint64_t _canary5;
 };
 
 static_assert(std::is_trivial_v<ocSharedMemory>);
@@ -0,0 +1,75 @@
+#include "ocWorkerPool.h"
+
+ocWorkerPool::ocWorkerPool(uint32_t thread_count)
+{
+    _threads.reserve(thread_count);
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        _threads.emplace_back(&ocWorkerPool::_work, this);
+    }
+}
+
+ocWorkerPool::~ocWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _batch_started.notify_all();
+    for (std::thread &thread : _threads) thread.join();
+}
+
+void ocWorkerPool::_run_tasks()
+{
+    uint32_t index;
+    while ((index = _next_task.fetch_add(1, std::memory_order_relaxed)) < _task_count)
+    {
+        (*_task)(index);
+    }
+}
+
+void ocWorkerPool::_work()
+{
+    uint64_t last_batch = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _batch_started.wait(lock, [&]{ return !_running || last_batch != _batch; });
+        if (!_running) return;
+        last_batch = _batch;
+
+        lock.unlock();
+        _run_tasks();
+        lock.lock();
+
+        if (0 == --_busy_threads) _batch_finished.notify_one();
+    }
+}
+
+void ocWorkerPool::run(uint32_t task_count, const std::function<void(uint32_t)> &task)
+{
+    if (_threads.empty() || task_count <= 1)
+    {
+        for (uint32_t i = 0; i < task_count; ++i) task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _task_count = task_count;
+        _next_task = 0;
+        _busy_threads = (uint32_t)_threads.size();
+        ++_batch;
+    }
+    _batch_started.notify_all();
+
+    _run_tasks();
+
+    // Every thread has to check in, even if there was nothing left for it.
+    // Otherwise a late thread could still look at the task of this batch.
+    std::unique_lock<std::mutex> lock(_mutex);
+    _batch_finished.wait(lock, [&]{ return 0 == _busy_threads; });
+    _task = nullptr;
+    _task_count = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint> // _t types
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of threads that work through a batch of numbered tasks. The
+ * thread that calls run() works on the tasks too and only returns once all of
+ * them are done, so the tasks may reference its local variables. The threads
+ * sleep between batches.
+ *
+ * A pool with zero threads runs all tasks on the calling thread.
+ */
+class ocWorkerPool final
+{
+private:
+    std::vector<std::thread> _threads;
+    std::mutex               _mutex;
+    std::condition_variable  _batch_started;
+    std::condition_variable  _batch_finished;
+    const std::function<void(uint32_t)> *_task = nullptr;
+    uint32_t                 _task_count = 0;
+    std::atomic<uint32_t>    _next_task = 0;
+    // threads that haven't finished the current batch yet
+    uint32_t                 _busy_threads = 0;
+    uint64_t                 _batch = 0;
+    bool                     _running = true;
+
+    void _work();
+    void _run_tasks();
+
+public:
+    explicit ocWorkerPool(uint32_t thread_count);
+    ~ocWorkerPool();
+
+    ocWorkerPool(const ocWorkerPool&) = delete;
+    void operator=(const ocWorkerPool&) = delete;
+
+    // Number of threads working on a batch, including the caller of run().
+    [[nodiscard]] uint32_t get_concurrency() const { return (uint32_t)_threads.size() + 1; }
+
+    /**
+     * Calls task(i) for every i from 0 to task_count - 1, spread over all
+     * threads. Must not be called from inside a task.
+     */
+    void run(uint32_t task_count, const std::function<void(uint32_t)> &task);
+};
@@ -0,0 +1,140 @@
+#include "../ocAssert.h"
+#include "../ocBevEngine.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+  const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+  std::vector<uint8_t> gray(64 * 48);
+  for (size_t i = 0; i < gray.size(); ++i) gray[i] = (uint8_t)(i * 7);
+
+  {
+    std::cout << "Test ocBevEngine identity view copies the image\n";
+    ocBevEngine bev(64.0f, 48.0f);
+    bev.add_view(identity, 64, 48);
+    std::vector<uint8_t> output(64 * 48);
+    uint8_t *const outputs[] = {output.data()};
+    oc_assert(bev.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, outputs));
+    oc_assert(gray == output);
+  }
+
+  {
+    std::cout << "Test ocBevEngine scales from the reference size\n";
+    // The view is measured in a 32x24 image but the camera sends 64x48, so
+    // every output pixel lands on every second camera pixel.
+    ocBevEngine bev(32.0f, 24.0f);
+    bev.add_view(identity, 32, 24);
+    std::vector<uint8_t> output(32 * 24);
+    uint8_t *const outputs[] = {output.data()};
+    oc_assert(bev.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, outputs));
+    for (size_t y = 0; y < 24; ++y)
+    {
+      for (size_t x = 0; x < 32; ++x)
+      {
+        oc_assert(gray[y * 2 * 64 + x * 2] == output[y * 32 + x], x, y);
+      }
+    }
+  }
+
+  {
+    std::cout << "Test ocBevEngine converts color while sampling\n";
+    std::vector<uint8_t> bgra(16 * 16 * 4);
+    for (size_t i = 0; i < bgra.size(); ++i) bgra[i] = (uint8_t)(i * 13 + 5);
+    ocBevEngine bev(16.0f, 16.0f);
+    bev.add_view(identity, 16, 16);
+    std::vector<uint8_t> output(16 * 16);
+    uint8_t *const outputs[] = {output.data()};
+    oc_assert(bev.render(ocPixelFormat::Bgra_U8, bgra.data(), 16, 16, outputs));
+    for (size_t i = 0; i < output.size(); ++i)
+    {
+      const uint8_t *p = &bgra[i * 4];
+      oc_assert(gray_from_bgr(p[0], p[1], p[2]) == output[i], i);
+    }
+  }
+
+  {
+    std::cout << "Test ocBevEngine marks pixels outside the camera image black\n";
+    const double shifted[9] = {1, 0, 8, 0, 1, 0, 0, 0, 1};
+    std::vector<uint8_t> white(16 * 16, 255);
+    ocBevEngine bev(16.0f, 16.0f);
+    bev.add_view(shifted, 16, 16);
+    std::vector<uint8_t> output(16 * 16);
+    uint8_t *const outputs[] = {output.data()};
+    oc_assert(bev.render(ocPixelFormat::Gray_U8, white.data(), 16, 16, outputs));
+    oc_assert(255 == output[7] && 0 == output[8], output[7], output[8]);
+  }
+
+  {
+    std::cout << "Test ocBevEngine blur keeps flat areas and spreads edges\n";
+    std::vector<uint8_t> step(32 * 32);
+    for (size_t i = 0; i < step.size(); ++i) step[i] = (i % 32 < 16) ? 0 : 200;
+    ocBevEngine bev(32.0f, 32.0f);
+    bev.add_view(identity, 32, 32, 7);
+    std::vector<uint8_t> output(32 * 32);
+    uint8_t *const outputs[] = {output.data()};
+    oc_assert(bev.render(ocPixelFormat::Gray_U8, step.data(), 32, 32, outputs));
+    oc_assert(0 == output[5 * 32 + 2] && 200 == output[5 * 32 + 29], output[5 * 32 + 2], output[5 * 32 + 29]);
+    oc_assert(0 < output[5 * 32 + 15] && output[5 * 32 + 16] < 200, output[5 * 32 + 15], output[5 * 32 + 16]);
+  }
+
+  {
+    std::cout << "Test ocBevEngine with a worker pool matches a single thread\n";
+    const double tilted[9] = {0.5, 0.1, 3, -0.05, 0.4, 2, 0, 0.001, 1};
+    ocBevEngine single(64.0f, 48.0f);
+    ocBevEngine threaded(64.0f, 48.0f);
+    for (ocBevEngine *bev : {&single, &threaded})
+    {
+      bev->add_view(tilted, 100, 70, 7);
+      bev->add_view(identity, 64, 48, 0);
+    }
+    std::vector<uint8_t> expected[2] = {std::vector<uint8_t>(100 * 70), std::vector<uint8_t>(64 * 48)};
+    std::vector<uint8_t> result[2] = {std::vector<uint8_t>(100 * 70), std::vector<uint8_t>(64 * 48)};
+    uint8_t *const expected_outputs[] = {expected[0].data(), expected[1].data()};
+    uint8_t *const result_outputs[] = {result[0].data(), result[1].data()};
+    ocWorkerPool pool(3);
+    oc_assert(single.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, expected_outputs));
+    for (int i = 0; i < 10; ++i)
+    {
+      oc_assert(threaded.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, result_outputs, &pool));
+      oc_assert(expected[0] == result[0] && expected[1] == result[1], i);
+    }
+  }
+
+  {
+    std::cout << "Test ocBevEngine region matches the full view inside of it\n";
+    const double tilted[9] = {0.5, 0.1, 3, -0.05, 0.4, 2, 0, 0.001, 1};
+    ocBevEngine full(64.0f, 48.0f);
+    ocBevEngine region(64.0f, 48.0f);
+    full.add_view(tilted, 100, 70, 7);
+    region.add_view(tilted, 100, 70, 7);
+    const ocBevSpan spans[] = {{0, 0, 10}, {30, 40, 60}, {31, 50, 70}, {31, 55, 65}, {69, 90, 200}, {500, 0, 10}};
+    region.set_region(0, spans, sizeof(spans) / sizeof(spans[0]));
+    oc_assert(region.get_rendered_pixel_count(0) < full.get_rendered_pixel_count(0));
+
+    std::vector<uint8_t> expected(100 * 70);
+    std::vector<uint8_t> result(100 * 70);
+    uint8_t *const expected_outputs[] = {expected.data()};
+    uint8_t *const result_outputs[] = {result.data()};
+    ocWorkerPool pool(2);
+    oc_assert(full.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, expected_outputs));
+    oc_assert(region.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, result_outputs, &pool));
+    for (const ocBevSpan &span : spans)
+    {
+      for (uint32_t x = span.x_begin; x < span.x_end && x < 100 && span.y < 70; ++x)
+      {
+        size_t i = (size_t)span.y * 100 + x;
+        oc_assert(expected[i] == result[i], span.y, x);
+      }
+    }
+
+    region.set_region(0, nullptr, 0);
+    oc_assert(region.get_rendered_pixel_count(0) == full.get_rendered_pixel_count(0));
+    oc_assert(region.render(ocPixelFormat::Gray_U8, gray.data(), 64, 48, result_outputs));
+    oc_assert(expected == result);
+  }
+}
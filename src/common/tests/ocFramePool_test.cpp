@@ -0,0 +1,141 @@
+#include "../ocAssert.h"
+#include "../ocFrameNotifier.h"
+#include "../ocFramePool.h"
+#include "../ocPollEngine.h"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+  const uint32_t slot_count = 4;
+  const size_t   data_size  = 4 * 1024;
+  std::vector<std::byte> memory(ocFramePool::memory_size(slot_count, data_size) + 64);
+  void *aligned = (void *)(((uintptr_t)memory.data() + 63) & ~(uintptr_t)63);
+
+  {
+    std::cout << "Test ocFramePool publish and acquire\n";
+    ocFramePool producer;
+    ocFramePool consumer;
+    producer.init(aligned, slot_count, data_size);
+    consumer.attach(aligned);
+
+    oc_assert(!consumer.acquire_latest(ocImageType::Cam));
+
+    ocFrame *frame = producer.acquire_for_write(1000);
+    oc_assert(frame);
+    oc_assert(1000 <= frame->capacity, frame->capacity);
+    frame->frame_number = 7;
+    producer.get_data(frame)[999] = 42;
+    producer.publish(frame, ocImageType::Cam);
+    ocFrameHandle handle = producer.get_handle(frame);
+    producer.release(frame);
+
+    ocFrame *latest = consumer.acquire_latest(ocImageType::Cam);
+    oc_assert(latest);
+    oc_assert(7 == latest->frame_number, latest->frame_number);
+    oc_assert(42 == consumer.get_data(latest)[999]);
+    oc_assert(!consumer.acquire_latest(ocImageType::Bev));
+
+    // The channel and we hold a reference, so the slot can't be written.
+    for (int i = 0; i < 3; ++i)
+    {
+      ocFrame *other = producer.acquire_for_write(1000);
+      oc_assert(other && other != latest, i);
+      producer.publish(other, ocImageType::Cam);
+      producer.release(other);
+    }
+    oc_assert(2 == producer.get_free_slot_count(), producer.get_free_slot_count());
+    consumer.release(latest);
+
+    // Nobody holds the old frame anymore, but it's still there until a
+    // producer needs the slot.
+    ocFrame *old = consumer.acquire(handle);
+    oc_assert(old == latest);
+    consumer.release(old);
+    ocFrame *reused = producer.acquire_for_write(1000);
+    oc_assert(reused == latest);
+    oc_assert(!consumer.acquire(handle));
+    producer.release(reused);
+  }
+
+  {
+    std::cout << "Test ocFramePool out of memory and recycle\n";
+    ocFramePool pool;
+    pool.init(aligned, slot_count, data_size);
+
+    ocFrame *big = pool.acquire_for_write(3000);
+    oc_assert(big);
+    // only 1024 bytes left
+    oc_assert(!pool.acquire_for_write(2000));
+    ocFrame *small = pool.acquire_for_write(1000);
+    oc_assert(small);
+    pool.release(small);
+    // the small slot is reused, no new buffer needed
+    oc_assert(small == pool.acquire_for_write(512));
+
+    pool.publish(big, ocImageType::Cam);
+    oc_assert(!pool.recycle(big));
+    pool.publish(small, ocImageType::Cam);
+    ocFrameHandle handle = pool.get_handle(big);
+    oc_assert(pool.recycle(big));
+    oc_assert(!pool.acquire(handle));
+  }
+
+  {
+    std::cout << "Test ocFramePool leases\n";
+    ocFramePool pool;
+    pool.init(aligned, slot_count, data_size);
+
+    ocFrame *frame = pool.acquire_for_write(1000);
+    ocFrameHandle handle = pool.get_handle(frame);
+    pool.publish(frame, ocImageType::Cam);
+    pool.release(frame);
+    {
+      ocFrameLease lease = pool.lease(handle);
+      oc_assert(lease);
+      // Only the newest frame is referenced by its channel, that is no lease.
+      oc_assert(0 == pool.collect_lease_stats().skipped_slots);
+
+      ocFrame *next = pool.acquire_for_write(1000);
+      pool.publish(next, ocImageType::Cam);
+      pool.release(next);
+      oc_assert(1 == pool.collect_lease_stats().skipped_slots);
+      for (uint32_t i = 0; i < 2 * slot_count; ++i)
+      {
+        ocFrame *other = pool.acquire_for_write(1000);
+        oc_assert(other && other != frame, i);
+        pool.release(other);
+      }
+      oc_assert(2 * slot_count == pool.collect_lease_stats().skipped_slots);
+    }
+    ocFrameLeaseStats stats = pool.collect_lease_stats();
+    oc_assert(1 == stats.leases, stats.leases);
+    oc_assert(stats.held_time_total_us == stats.held_time_max_us);
+    oc_assert(frame == pool.acquire_for_write(1000));
+    oc_assert(!pool.lease(handle));
+    pool.release(frame);
+  }
+
+  {
+    std::cout << "Test ocFrameNotifier\n";
+    ocFramePool pool;
+    pool.init(aligned, slot_count, data_size);
+    ocFrameNotifier notifier(&pool, ocImageType::Cam);
+    ocPollEngine pe(1);
+    pe.add_fd(notifier.get_fd());
+
+    ocFrame *frame = pool.acquire_for_write(1000);
+    pool.publish(frame, ocImageType::Cam);
+    pool.release(frame);
+    pe.await(ocTime::seconds(1));
+    oc_assert(pe.was_triggered(notifier.get_fd()));
+    {
+      ocFrameLease lease = notifier.next_frame();
+      oc_assert(&*lease == frame);
+    }
+    // The same frame is not handed out twice.
+    oc_assert(!notifier.next_frame());
+  }
+}
@@ -0,0 +1,68 @@
+#include "../ocAssert.h"
+#include "../ocFrameSlot.h"
+#include "../ocTypes.h"
+
+#include <cstdint>
+#include <iostream>
+
+int main()
+{
+  static ocSharedMemory memory = {};
+
+  {
+    std::cout << "Test ocFrameSlot sequence detects writes\n";
+    ocBevData &slot = memory.bev_data[0];
+
+    uint32_t sequence = begin_frame_read(slot.sequence);
+    oc_assert(end_frame_read(slot.sequence, sequence));
+
+    begin_frame_write(slot.sequence);
+    // a reader that started before the write sees that it changed
+    oc_assert(!end_frame_read(slot.sequence, sequence));
+    // a reader that starts during the write gets an odd sequence
+    uint32_t during_write = begin_frame_read(slot.sequence);
+    oc_assert(during_write & 1, during_write);
+    slot.frame_number = 42;
+    end_frame_write(slot.sequence);
+    oc_assert(!end_frame_read(slot.sequence, during_write));
+
+    sequence = begin_frame_read(slot.sequence);
+    oc_assert(0 == (sequence & 1), sequence);
+    oc_assert(end_frame_read(slot.sequence, sequence));
+  }
+
+  {
+    std::cout << "Test ocFrameSlot read_newest_frame\n";
+    for (uint32_t i = 0; i < OC_NUM_BEV_BUFFERS; ++i)
+    {
+      begin_frame_write(memory.bev_data[i].sequence);
+      memory.bev_data[i].frame_number = i + 1;
+      end_frame_write(memory.bev_data[i].sequence);
+    }
+    publish_frame_index(memory.last_written_bev_data_index, 1);
+
+    uint32_t frame_number = 0;
+    oc_assert(read_newest_frame(memory.bev_data, memory.last_written_bev_data_index, [&](const ocBevData &bev_data)
+    {
+      frame_number = bev_data.frame_number;
+    }));
+    oc_assert(2 == frame_number, frame_number);
+
+    // A slot that is still being written is never handed out. The callback
+    // overwrites the slot itself, so the first attempt is always torn.
+    int calls = 0;
+    oc_assert(read_frame(memory.bev_data[2], [&](const ocBevData &)
+    {
+      if (0 == calls++)
+      {
+        begin_frame_write(memory.bev_data[2].sequence);
+        end_frame_write(memory.bev_data[2].sequence);
+      }
+    }));
+    oc_assert(2 == calls, calls);
+
+    begin_frame_write(memory.bev_data[1].sequence);
+    oc_assert(!read_newest_frame(memory.bev_data, memory.last_written_bev_data_index, [&](const ocBevData &) {}));
+    end_frame_write(memory.bev_data[1].sequence);
+  }
+}
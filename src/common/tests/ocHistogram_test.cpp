@@ -0,0 +1,52 @@
+#include "../ocAssert.h"
+#include "../ocHistogram.h"
+
+#include <cmath>
+#include <iostream>
+
+static bool near(float a, float b, float tolerance)
+{
+  return std::abs(a - b) <= tolerance;
+}
+
+int main()
+{
+  {
+    std::cout << "Test ocHistogram without values\n";
+    ocHistogram histogram(1.0f, 10);
+    oc_assert(0 == histogram.get_count());
+    oc_assert(0.0f == histogram.get_mean());
+    oc_assert(0.0f == histogram.get_percentile(0.5f));
+  }
+
+  {
+    std::cout << "Test ocHistogram percentiles\n";
+    ocHistogram histogram(1.0f, 200);
+    for (int i = 0; i < 100; ++i)
+    {
+      histogram.add((float)i + 0.5f);
+    }
+    oc_assert(100 == histogram.get_count());
+    oc_assert(near(histogram.get_mean(), 50.0f, 0.001f), histogram.get_mean());
+    oc_assert(near(histogram.get_max(), 99.5f, 0.001f), histogram.get_max());
+    oc_assert(near(histogram.get_percentile(0.5f), 50.0f, 0.001f), histogram.get_percentile(0.5f));
+    oc_assert(near(histogram.get_percentile(0.99f), 99.0f, 0.001f), histogram.get_percentile(0.99f));
+    oc_assert(near(histogram.get_percentile(1.0f), 100.0f, 0.001f), histogram.get_percentile(1.0f));
+    oc_assert(near(histogram.get_percentile(0.0f), 1.0f, 0.001f), histogram.get_percentile(0.0f));
+  }
+
+  {
+    std::cout << "Test ocHistogram keeps values out of range in the outer bins\n";
+    ocHistogram histogram(2.0f, 10);
+    histogram.add(-5.0f);
+    histogram.add(1000.0f);
+    oc_assert(near(histogram.get_percentile(0.5f), 2.0f, 0.001f), histogram.get_percentile(0.5f));
+    oc_assert(near(histogram.get_percentile(1.0f), 20.0f, 0.001f), histogram.get_percentile(1.0f));
+    oc_assert(near(histogram.get_max(), 1000.0f, 0.001f), histogram.get_max());
+    histogram.clear();
+    oc_assert(0 == histogram.get_count());
+    oc_assert(0.0f == histogram.get_percentile(1.0f));
+  }
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "../ocAssert.h"
+#include "../ocImageOps.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace PixelFormat;
+
+// Compares a conversion against the per pixel reference implementation.
+template<typename SrcFormat, typename DstFormat, typename Convert>
+static void check_conversion(const std::vector<uint8_t> &source, Convert convert)
+{
+  const size_t sizes[][4] = {
+    // src width, src height, dst width, dst height
+    {64, 48, 64, 48},
+    {640, 480, 400, 400},
+    {37, 5, 13, 3},
+  };
+  for (const auto &size : sizes)
+  {
+    std::vector<DstFormat> expected(size[2] * size[3]);
+    std::vector<DstFormat> result(size[2] * size[3]);
+    convert_and_downscale<SrcFormat, DstFormat>(
+      (const SrcFormat *)source.data(), size[0], size[1],
+      expected.data(), size[2], size[3]);
+    convert(source.data(), size[0], size[1], result.data(), size[2], size[3]);
+    oc_assert(0 == memcmp(expected.data(), result.data(), expected.size() * sizeof(DstFormat)), size[0], size[2]);
+  }
+}
+
+int main()
+{
+  std::vector<uint8_t> source(640 * 480 * 4);
+  uint32_t state = 12345;
+  for (uint8_t &byte : source)
+  {
+    state = state * 1664525 + 1013904223;
+    byte = (uint8_t)(state >> 24);
+  }
+
+  {
+    std::cout << "Test ocImageOps conversions match the reference\n";
+    check_conversion<GrayU8, GrayU8>(source, [](const uint8_t *s, size_t sw, size_t sh, GrayU8 *d, size_t dw, size_t dh)
+      { convert_gray_u8_to_gray_u8(s, sw, sh, (uint8_t *)d, dw, dh); });
+    check_conversion<GrayU8, BgrU8>(source, [](const uint8_t *s, size_t sw, size_t sh, BgrU8 *d, size_t dw, size_t dh)
+      { convert_gray_u8_to_bgr_u8(s, sw, sh, (uint8_t *)d, dw, dh); });
+    check_conversion<GrayU8, RgbF32>(source, [](const uint8_t *s, size_t sw, size_t sh, RgbF32 *d, size_t dw, size_t dh)
+      { convert_gray_u8_to_rgb_f32(s, sw, sh, (float *)d, dw, dh); });
+    check_conversion<BgrU8, GrayU8>(source, [](const uint8_t *s, size_t sw, size_t sh, GrayU8 *d, size_t dw, size_t dh)
+      { convert_bgr_u8_to_gray_u8(s, sw, sh, (uint8_t *)d, dw, dh); });
+    check_conversion<BgrU8, BgrU8>(source, [](const uint8_t *s, size_t sw, size_t sh, BgrU8 *d, size_t dw, size_t dh)
+      { convert_bgr_u8_to_bgr_u8(s, sw, sh, (uint8_t *)d, dw, dh); });
+    check_conversion<BgrU8, RgbF32>(source, [](const uint8_t *s, size_t sw, size_t sh, RgbF32 *d, size_t dw, size_t dh)
+      { convert_bgr_u8_to_rgb_f32(s, sw, sh, (float *)d, dw, dh); });
+    check_conversion<BgrxU8, GrayU8>(source, [](const uint8_t *s, size_t sw, size_t sh, GrayU8 *d, size_t dw, size_t dh)
+      { convert_bgra_u8_to_gray_u8(s, sw, sh, (uint8_t *)d, dw, dh); });
+    check_conversion<BgrxU8, BgrU8>(source, [](const uint8_t *s, size_t sw, size_t sh, BgrU8 *d, size_t dw, size_t dh)
+      { convert_bgra_u8_to_bgr_u8(s, sw, sh, (uint8_t *)d, dw, dh); });
+    check_conversion<BgrxU8, RgbF32>(source, [](const uint8_t *s, size_t sw, size_t sh, RgbF32 *d, size_t dw, size_t dh)
+      { convert_bgra_u8_to_rgb_f32(s, sw, sh, (float *)d, dw, dh); });
+  }
+
+  {
+    std::cout << "Test ocImageOps gray keeps black and white\n";
+    const uint8_t pixels[] = {0, 0, 0, 0, 255, 255, 255, 255};
+    uint8_t gray[2];
+    oc_assert(convert_to_gray_u8(ocPixelFormat::Bgra_U8, pixels, 2, 1, gray, 2, 1));
+    oc_assert(0 == gray[0] && 255 == gray[1], gray[0], gray[1]);
+  }
+}
@@ -0,0 +1,202 @@
+#include "../ocAssert.h"
+#include "../ocIpcFrame.h"
+#include "../ocIpcSocket.h"
+#include "../ocPacket.h"
+#include "../ocShmRing.h"
+
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <cstring> // memset
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main()
+{
+  int fds[2];
+  oc_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ocIpcSocket sender;
+  ocIpcSocket receiver;
+  sender.set_fd(fds[0]);
+  receiver.set_fd(fds[1]);
+
+  {
+    std::cout << "Test ocIpcSocket many packets in one read\n";
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+      oc_assert(0 < sender.send(ocMessageId::Can_Frame_Received, i));
+    }
+    ocPacket packet;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+      oc_assert(0 < receiver.read_packet(packet, false), i);
+      oc_assert(packet.get_message_id() == ocMessageId::Can_Frame_Received);
+      uint32_t value = packet.read_from_start().read<uint32_t>();
+      oc_assert(value == i, value, i);
+    }
+    oc_assert(0 == receiver.read_packet(packet, false));
+  }
+
+  {
+    std::cout << "Test ocIpcSocket send_batch and peek_packet\n";
+    ocPacket a(ocMessageId::Lines_Available, ocMemberId::Image_Processing);
+    ocPacket b(ocMessageId::Shapes, ocMemberId::Lane_Detection);
+    ocPacket c(ocMessageId::Member_List, ocMemberId::Ipc_Hub);
+    a.clear();
+    b.clear_and_edit().write<uint64_t>(42).write<uint8_t>(7);
+    c.clear_and_edit().write<uint16_t>(3);
+    const ocPacket *batch[] = {&a, &b, &c};
+    oc_assert(0 < sender.send_batch(batch, 3));
+
+    ocPacketView view;
+    oc_assert(0 < receiver.peek_packet(view, false));
+    oc_assert(view.get_message_id() == ocMessageId::Lines_Available);
+    oc_assert(view.get_length() == 0, view.get_length());
+    receiver.release_packet();
+    oc_assert(0 < receiver.peek_packet(view, false));
+    oc_assert(view.get_message_id() == ocMessageId::Shapes);
+    oc_assert(view.get_sender() == ocMemberId::Lane_Detection);
+    oc_assert(view.get_length() == 9, view.get_length());
+    receiver.release_packet();
+    oc_assert(0 < receiver.peek_packet(view, false));
+    oc_assert(view.get_message_id() == ocMessageId::Member_List);
+    receiver.release_packet();
+    oc_assert(0 == receiver.peek_packet(view, false));
+  }
+
+  {
+    std::cout << "Test ocIpcSocket packets larger than the read chunk\n";
+    ocPacket big(ocMessageId::Timing_Events, ocMemberId::Ipc_Hub);
+    auto writer = big.clear_and_edit();
+    for (uint32_t i = 0; i < 100000; ++i) writer.write<uint32_t>(i);
+    // This doesn't fit into the socket buffer, so someone has to read while
+    // we send.
+    std::thread writer_thread([&]()
+    {
+      oc_assert(0 < sender.send(ocMessageId::Ipc_Stats, (uint32_t)1));
+      const ocPacket *batch[] = {&big, &big};
+      oc_assert(0 < sender.send_batch(batch, 2));
+    });
+
+    ocPacket packet;
+    oc_assert(0 < receiver.read_packet(packet));
+    oc_assert(packet.get_message_id() == ocMessageId::Ipc_Stats);
+    for (int n = 0; n < 2; ++n)
+    {
+      oc_assert(0 < receiver.read_packet(packet));
+      oc_assert(packet.get_length() == 400000, packet.get_length());
+      auto reader = packet.read_from_start();
+      for (uint32_t i = 0; i < 100000; ++i) oc_assert(reader.read<uint32_t>() == i, i);
+    }
+    writer_thread.join();
+  }
+
+  {
+    std::cout << "Test ocIpcSocket registered messages\n";
+    oc_assert(0 < sender.send(ocLaneDetectionValues{.speed = 60, .steering_front = -20, .steering_rear = 20}));
+    oc_assert(0 < sender.send(ocMessageId::Lane_Detection_Values, (uint16_t)60));
+
+    ocPacket packet;
+    ocLaneDetectionValues values = {};
+    ocTrafficSignDetected sign = {};
+    oc_assert(0 < receiver.read_packet(packet, false));
+    oc_assert(!packet.read(&sign));
+    oc_assert(packet.read(&values));
+    oc_assert(60 == values.speed && -20 == values.steering_front && 20 == values.steering_rear);
+    // right id, but too short
+    oc_assert(0 < receiver.read_packet(packet, false));
+    oc_assert(!packet.read(&values));
+
+    static_assert(16 == ocRegisteredMessages::payload_size(ocMessageId::Lane_Detection_Values));
+    static_assert(24 == ocRegisteredMessages::payload_size(ocMessageId::Object_Found));
+    static_assert(-1 == ocRegisteredMessages::payload_size(ocMessageId::Shapes));
+  }
+
+  {
+    std::cout << "Test ocIpcSocket urgent frames overtake the queue\n";
+    ocPacket big(ocMessageId::Timing_Events, ocMemberId::Ipc_Hub);
+    memset(big.get_payload()->make_space(1 << 20), 0, 1 << 20);
+    ocPacket stop(ocMessageId::Start_Driving_Task, ocMemberId::Driver);
+    stop.write(ocStartDrivingTask{.speed = 0, .steering_front = 0, .steering_rear = 0, .id = 1, .steps_ab = 0});
+
+    ocIpcFrame *big_frame = ocIpcFrame::create(ocPacketView(big));
+    ocIpcFrame *stop_frame = ocIpcFrame::create(ocPacketView(stop));
+    for (int i = 0; i < 4; ++i) oc_assert(0 < sender.queue_frame(big_frame));
+    size_t waiting = sender.get_queue_length();
+    oc_assert(2 <= waiting, waiting);
+    oc_assert(0 < sender.queue_frame(stop_frame, true));
+    big_frame->release();
+    stop_frame->release();
+
+    // Only the partially sent frame may still come before the urgent one.
+    // The packet counters are checked by read_packet.
+    ocPacket packet;
+    size_t stop_index = 0;
+    for (size_t i = 0; i < 5; ++i)
+    {
+      while (0 == receiver.read_packet(packet, false)) oc_assert(0 <= sender.flush_queue());
+      if (ocMessageId::Start_Driving_Task == packet.get_message_id()) stop_index = i;
+    }
+    oc_assert(stop_index <= 5 - waiting, stop_index, waiting);
+  }
+
+  {
+    std::cout << "Test ocIpcSocket send_batch into a full ring\n";
+    int ring_fds[2];
+    oc_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, ring_fds));
+    // every packet is 8 + 100 bytes, padded to 112, so the ring holds two
+    const uint32_t capacity = 256;
+    size_t ring_size = ocShmRing::memory_size(capacity);
+    std::vector<std::byte> memory(2 * ring_size + 64);
+    // The header wants cache line alignment.
+    std::byte *to_receiver = (std::byte *)(((uintptr_t)memory.data() + 63) & ~(uintptr_t)63);
+    std::byte *to_sender = to_receiver + ring_size;
+    ocShmRing().init(to_receiver, capacity);
+    ocShmRing().init(to_sender, capacity);
+    ocIpcSocket ring_sender;
+    ocIpcSocket ring_receiver;
+    ring_sender.set_fd(ring_fds[0]);
+    ring_receiver.set_fd(ring_fds[1]);
+    ring_sender.attach_rings(to_receiver, to_sender);
+    ring_receiver.attach_rings(to_sender, to_receiver);
+
+    ocPacket packets[5];
+    const ocPacket *batch[5];
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+      packets[i].set_message_id(ocMessageId::Can_Frame_Received);
+      auto writer = packets[i].clear_and_edit();
+      for (uint32_t k = 0; k < 25; ++k) writer.write<uint32_t>(i);
+      batch[i] = &packets[i];
+    }
+
+    // Without blocking, a batch only goes in as a whole.
+    ocPacketView view;
+    oc_assert(0 == ring_sender.send_batch(batch, 5, false));
+    oc_assert(0 == ring_receiver.peek_packet(view, false));
+    oc_assert(0 < ring_sender.send_batch(batch, 2, false));
+    oc_assert(0 == ring_sender.send_batch(batch, 1, false));
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+      oc_assert(0 < ring_receiver.peek_packet(view, false));
+      ring_receiver.release_packet();
+    }
+
+    // The receiver is asleep now, so the sender has to wake it up whenever
+    // the ring is full.
+    oc_assert(0 == ring_receiver.peek_packet(view, false));
+    std::thread reader_thread([&]()
+    {
+      ocPacket packet;
+      for (uint32_t i = 0; i < 5; ++i)
+      {
+        oc_assert(0 < ring_receiver.read_packet(packet));
+        uint32_t value = packet.read_from_start().read<uint32_t>();
+        oc_assert(value == i, value, i);
+      }
+    });
+    oc_assert(0 < ring_sender.send_batch(batch, 5));
+    reader_thread.join();
+  }
+}
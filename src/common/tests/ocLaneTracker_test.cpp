@@ -0,0 +1,121 @@
+#include "../ocAssert.h"
+#include "../ocLaneTracker.h"
+
+#include <cmath>
+#include <iostream>
+
+static bool near(float a, float b, float tolerance)
+{
+  return std::abs(a - b) <= tolerance;
+}
+
+int main()
+{
+  {
+    std::cout << "Test ocLaneTracker gives back the first circle\n";
+    const float circles[][3] = {
+      {  0.0f,  200.0f, 200.0f}, // right curve right in front
+      { 30.0f, -150.0f, 140.0f}, // left curve, the car is right of the lane
+      {-20.0f,  500.0f, 520.0f}, // the car is right of the lane
+    };
+    for (const auto &circle : circles)
+    {
+      ocLaneTracker tracker;
+      oc_assert(!tracker.is_valid());
+      oc_assert(tracker.update(circle[0], circle[1], circle[2], 1.0f));
+      ocLaneData lane = {};
+      oc_assert(tracker.get_lane(&lane));
+      oc_assert(near(lane.curve_center_x, circle[0], 0.01f), lane.curve_center_x, circle[0]);
+      oc_assert(near(lane.curve_center_y, circle[1], 0.01f), lane.curve_center_y, circle[1]);
+      oc_assert(near(lane.curve_radius,   circle[2], 0.01f), lane.curve_radius, circle[2]);
+    }
+  }
+
+  {
+    std::cout << "Test ocLaneTracker ignores measurements without confidence\n";
+    ocLaneTracker tracker;
+    oc_assert(!tracker.update(0.0f, 200.0f, 200.0f, 0.0f));
+    oc_assert(!tracker.is_valid());
+  }
+
+  {
+    std::cout << "Test ocLaneTracker moves the lane with the car\n";
+    // The car drives along a right curve, so the curve center stays where it
+    // is relative to the car.
+    ocLaneTracker tracker;
+    oc_assert(tracker.update(0.0f, 200.0f, 200.0f, 1.0f));
+    for (int i = 0; i < 10; ++i)
+    {
+      float angle = 10.0f / 200.0f;
+      ocPose motion(200.0f * std::sin(angle), 200.0f * (1.0f - std::cos(angle)), 0.0f, angle, 0.0f, 0.0f);
+      tracker.predict(motion, 10.0f);
+    }
+    ocLaneData lane = {};
+    oc_assert(tracker.get_lane(&lane));
+    oc_assert(near(lane.curve_center_x, 0.0f, 0.1f), lane.curve_center_x);
+    oc_assert(near(lane.curve_center_y, 200.0f, 0.1f), lane.curve_center_y);
+  }
+
+  {
+    std::cout << "Test ocLaneTracker moves straight lanes with the car\n";
+    ocLaneTracker tracker;
+    oc_assert(tracker.update(0.0f, 20.0f + ocLaneTracker::MAX_RADIUS, ocLaneTracker::MAX_RADIUS, 1.0f));
+    // drive 50 cm and turn left by 0.1 rad on the spot
+    tracker.predict(ocPose(50.0f, 0.0f, 0.0f, -0.1f, 0.0f, 0.0f), 50.0f);
+    ocLaneData lane = {};
+    oc_assert(tracker.get_lane(&lane));
+    // the lane is still about 20 cm away and now runs to the right
+    float dist = std::hypot(lane.curve_center_x, lane.curve_center_y) - lane.curve_radius;
+    oc_assert(near(dist, 20.0f * std::cos(0.1f), 0.5f), dist);
+    oc_assert(lane.curve_center_x < 0.0f && 0.0f < lane.curve_center_y, lane.curve_center_x, lane.curve_center_y);
+  }
+
+  {
+    std::cout << "Test ocLaneTracker gets more certain with measurements\n";
+    ocLaneTracker tracker;
+    oc_assert(tracker.update(0.0f, 300.0f, 300.0f, 1.0f));
+    float first = tracker.get_offset_deviation();
+    for (int i = 0; i < 10; ++i)
+    {
+      float noise = (i % 2) ? 2.0f : -2.0f;
+      tracker.predict(ocPose(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f), 0.0f);
+      oc_assert(tracker.update(0.0f, 300.0f + noise, 300.0f, 1.0f), i);
+    }
+    oc_assert(tracker.get_offset_deviation() < first, tracker.get_offset_deviation(), first);
+    ocLaneData lane = {};
+    oc_assert(tracker.get_lane(&lane));
+    oc_assert(near(lane.curve_center_y, 300.0f, 1.0f), lane.curve_center_y);
+  }
+
+  {
+    std::cout << "Test ocLaneTracker ignores outliers until they persist\n";
+    ocLaneTracker tracker;
+    oc_assert(tracker.update(0.0f, 300.0f, 300.0f, 1.0f));
+    for (int i = 0; i < 4; ++i)
+    {
+      oc_assert(!tracker.update(0.0f, 380.0f, 300.0f, 1.0f), i);
+    }
+    ocLaneData lane = {};
+    oc_assert(tracker.get_lane(&lane));
+    oc_assert(near(lane.curve_center_y, 300.0f, 0.01f), lane.curve_center_y);
+    oc_assert(tracker.update(0.0f, 380.0f, 300.0f, 1.0f));
+    oc_assert(tracker.get_lane(&lane));
+    oc_assert(near(lane.curve_center_y, 380.0f, 0.01f), lane.curve_center_y);
+  }
+
+  {
+    std::cout << "Test ocLaneTracker loses the lane without measurements\n";
+    ocLaneTracker tracker;
+    oc_assert(tracker.update(0.0f, 300.0f, 300.0f, 1.0f));
+    float angle = 10.0f / 300.0f;
+    ocPose motion(300.0f * std::sin(angle), 300.0f * (1.0f - std::cos(angle)), 0.0f, angle, 0.0f, 0.0f);
+    int frames = 0;
+    while (tracker.is_valid() && frames < 10000)
+    {
+      tracker.predict(motion, 10.0f);
+      ++frames;
+    }
+    oc_assert(!tracker.is_valid());
+    oc_assert(10 < frames, frames);
+  }
+}
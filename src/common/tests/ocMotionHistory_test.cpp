@@ -0,0 +1,115 @@
+#include "../ocAssert.h"
+#include "../ocMotionHistory.h"
+
+#include <cmath>
+#include <iostream>
+
+static bool near(float a, float b, float tolerance)
+{
+  return std::abs(a - b) <= tolerance;
+}
+
+// 100 steps are 1 cm, steering bytes of 90 are 0.5 radians
+static ocCarProperties make_properties()
+{
+  ocCarProperties properties = {};
+  properties.wheel_base = 21.3f;
+  properties.wheel.circumference = 1.0f;
+  properties.odo_ticks_number = 100;
+  properties.odo_gear_ratio = 1.0f;
+  properties.min_steering_angle_front = -0.5f;
+  properties.max_steering_angle_front =  0.5f;
+  properties.min_steering_angle_rear  = -0.5f;
+  properties.max_steering_angle_rear  =  0.5f;
+  return properties;
+}
+
+int main()
+{
+  ocCarProperties properties = make_properties();
+  ocTime start = ocTime::seconds(100);
+
+  {
+    std::cout << "Test ocMotionHistory without samples\n";
+    ocMotionHistory history(&properties);
+    float distance = -1.0f;
+    ocPose motion = history.get_motion(start, start + ocTime::seconds(1), &distance);
+    oc_assert(0.0f == distance, distance);
+    oc_assert(0.0f == motion.pos.x && 0.0f == motion.pos.y, motion.pos.x, motion.pos.y);
+  }
+
+  {
+    std::cout << "Test ocMotionHistory integrates the commanded speed\n";
+    ocMotionHistory history(&properties);
+    history.add_command(start, 100, 0, 0);
+    history.add_command(start + ocTime::seconds(1), 50, 0, 0);
+    oc_assert(near(history.get_distance(start, start + ocTime::seconds(2)), 150.0f, 0.01f));
+    oc_assert(near(history.get_distance(start - ocTime::seconds(1), start + ocTime::milliseconds(500)), 50.0f, 0.01f));
+    ocPose motion = history.get_motion(start, start + ocTime::seconds(2));
+    oc_assert(near(motion.pos.x, 150.0f, 0.01f), motion.pos.x);
+    oc_assert(near(motion.pos.y, 0.0f, 0.01f), motion.pos.y);
+    oc_assert(0.0f == history.get_distance(start + ocTime::seconds(2), start));
+  }
+
+  {
+    std::cout << "Test ocMotionHistory interpolates the odometry\n";
+    ocMotionHistory history(&properties);
+    // the commands are much faster, they only count outside the odometry
+    history.add_command(start, 1000, 0, 0);
+    history.add_odometry(start + ocTime::seconds(1), 0);
+    history.add_odometry(start + ocTime::seconds(2), 2000);
+    history.add_odometry(start + ocTime::seconds(3), 2000);
+    oc_assert(near(history.get_distance(start + ocTime::milliseconds(1500), start + ocTime::seconds(3)), 10.0f, 0.01f));
+    float distance = history.get_distance(start + ocTime::milliseconds(500), start + ocTime::milliseconds(3500));
+    oc_assert(near(distance, 500.0f + 20.0f + 500.0f, 0.01f), distance);
+    // older samples than the last one are dropped
+    history.add_odometry(start, 5000);
+    oc_assert(near(history.get_distance(start + ocTime::seconds(1), start + ocTime::seconds(3)), 20.0f, 0.01f));
+  }
+
+  {
+    std::cout << "Test ocMotionHistory follows the steering of each command\n";
+    ocMotionHistory history(&properties);
+    history.add_command(start, 100, 0, 0);
+    history.add_command(start + ocTime::seconds(1), 20, 90, -90);
+    float distance;
+    ocPose motion = history.get_motion(start, start + ocTime::seconds(2), &distance);
+    oc_assert(near(distance, 120.0f, 0.01f), distance);
+
+    ocCarState car = {};
+    car.properties = &properties;
+    car.pose = ocPose(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    car.pose = drive_car(car, 100.0f);
+    car.steering_front =  0.5f;
+    car.steering_rear  = -0.5f;
+    car.pose = drive_car(car, 20.0f);
+    oc_assert(near(motion.pos.x, car.pose.pos.x, 0.01f), motion.pos.x, car.pose.pos.x);
+    oc_assert(near(motion.pos.y, car.pose.pos.y, 0.01f), motion.pos.y, car.pose.pos.y);
+    oc_assert(near(motion.heading, car.pose.heading, 0.001f), motion.heading, car.pose.heading);
+    // positive angles steer to the right
+    oc_assert(0.0f < motion.heading, motion.heading);
+
+    // from within the turn, the steering of the command before counts
+    ocPose turn = history.get_motion(start + ocTime::milliseconds(1500), start + ocTime::seconds(2));
+    oc_assert(0.0f < turn.heading, turn.heading);
+  }
+
+  {
+    std::cout << "Test ocMotionHistory keeps the newest samples\n";
+    ocMotionHistory history(&properties);
+    for (size_t i = 0; i < 2 * ocMotionHistory::capacity; ++i)
+    {
+      history.add_odometry(start + ocTime::milliseconds((int64_t)i * 10), (int32_t)i * 100);
+    }
+    ocTime last = start + ocTime::milliseconds((int64_t)(2 * ocMotionHistory::capacity - 1) * 10);
+    float distance = history.get_distance(last - ocTime::milliseconds(100), last);
+    oc_assert(near(distance, 10.0f, 0.01f), distance);
+    // without commands, the car didn't move before the oldest sample
+    distance = history.get_distance(start, last);
+    oc_assert(near(distance, (float)(ocMotionHistory::capacity - 1), 0.01f), distance);
+    history.clear();
+    oc_assert(0.0f == history.get_distance(start, last));
+  }
+
+  return 0;
+}
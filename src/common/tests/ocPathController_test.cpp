@@ -0,0 +1,133 @@
+#include "../ocAssert.h"
+#include "../ocPathController.h"
+
+#include <cmath>
+#include <iostream>
+
+static bool near(float a, float b, float tolerance)
+{
+  return std::abs(a - b) <= tolerance;
+}
+
+static ocCarProperties make_properties()
+{
+  ocCarProperties properties = {};
+  properties.wheel_base = 21.3f;
+  properties.min_steering_angle_front = -0.785f;
+  properties.max_steering_angle_front =  0.785f;
+  properties.min_steering_angle_rear  = -0.785f;
+  properties.max_steering_angle_rear  =  0.785f;
+  return properties;
+}
+
+static ocLaneData make_lane(float center_x, float center_y, float radius)
+{
+  ocLaneData lane = {};
+  lane.curve_center_x = center_x;
+  lane.curve_center_y = center_y;
+  lane.curve_radius   = radius;
+  return lane;
+}
+
+static ocCarState make_car(ocCarProperties *properties)
+{
+  ocCarState car = {};
+  car.properties = properties;
+  car.pose = ocPose(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+  return car;
+}
+
+// Drives the car with the controller for the given time, at 50 Hz.
+static void drive(ocPathController &controller, ocCarState &car, float seconds)
+{
+  const float period = 0.02f;
+  for (float time = 0.0f; time < seconds; time += period)
+  {
+    ocPathController::Command command;
+    oc_assert(controller.update(car, period, &command));
+    car.steering_front = command.steering_front;
+    car.steering_rear  = command.steering_rear;
+    car.pose = drive_car(car, command.speed * period);
+  }
+}
+
+int main()
+{
+  ocCarProperties properties = make_properties();
+
+  {
+    std::cout << "Test ocPathController needs a lane\n";
+    ocPathController controller;
+    ocCarState car = make_car(&properties);
+    ocPathController::Command command;
+    oc_assert(!controller.has_lane());
+    oc_assert(!controller.update(car, 0.02f, &command));
+  }
+
+  {
+    std::cout << "Test ocPathController steers towards the lane\n";
+    // a straight lane 20 cm to the left, positive angles steer right
+    ocPathController controller;
+    controller.set_lane(make_lane(0.0f, -10020.0f, 10000.0f));
+    ocCarState car = make_car(&properties);
+    ocPathController::Command command;
+    oc_assert(controller.update(car, 0.02f, &command));
+    oc_assert(command.steering_front < 0.0f, command.steering_front);
+
+    controller.set_lane(make_lane(0.0f, 10020.0f, 10000.0f));
+    oc_assert(controller.update(car, 0.02f, &command));
+    oc_assert(0.0f < command.steering_front, command.steering_front);
+  }
+
+  {
+    std::cout << "Test ocPathController follows a curve with the axles opposed\n";
+    ocPathController controller;
+    controller.set_lane(make_lane(0.0f, -150.0f, 150.0f));
+    ocCarState car = make_car(&properties);
+    ocPathController::Command command;
+    oc_assert(controller.update(car, 0.02f, &command));
+    oc_assert(command.steering_front < 0.0f && 0.0f < command.steering_rear, command.steering_front, command.steering_rear);
+  }
+
+  {
+    std::cout << "Test ocPathController brings the car onto a straight lane\n";
+    // The lane is as straight as ocLaneTracker reports them, 20 cm to the left.
+    ocPathController controller;
+    controller.set_lane(make_lane(0.0f, -10020.0f, 10000.0f));
+    ocCarState car = make_car(&properties);
+    drive(controller, car, 3.0f);
+    float offset = std::hypot(car.pose.pos.x, car.pose.pos.y + 10020.0f) - 10000.0f;
+    oc_assert(near(offset, 0.0f, 1.0f), offset);
+    oc_assert(near(controller.get_speed(), 60.0f, 0.01f), controller.get_speed());
+  }
+
+  {
+    std::cout << "Test ocPathController slows down in curves\n";
+    ocPathController::Settings settings;
+    settings.max_speed = 120.0f;
+    ocPathController controller(settings);
+    controller.set_lane(make_lane(0.0f, -150.0f, 150.0f));
+    ocCarState car = make_car(&properties);
+    drive(controller, car, 2.0f);
+    float dist = std::hypot(car.pose.pos.x - 0.0f, car.pose.pos.y + 150.0f);
+    oc_assert(near(dist, 150.0f, 2.0f), dist);
+    oc_assert(near(controller.get_speed(), std::sqrt(60.0f * 150.0f), 0.01f), controller.get_speed());
+  }
+
+  {
+    std::cout << "Test ocPathController limits the acceleration\n";
+    ocPathController::Settings settings;
+    settings.max_acceleration = 50.0f;
+    ocPathController controller(settings);
+    controller.set_lane(make_lane(0.0f, 10000.0f, 10000.0f));
+    ocCarState car = make_car(&properties);
+    ocPathController::Command command;
+    oc_assert(controller.update(car, 0.1f, &command));
+    oc_assert(near(command.speed, 5.0f, 0.001f), command.speed);
+    controller.set_lane(ocLaneData{});
+    oc_assert(!controller.update(car, 0.1f, &command));
+    oc_assert(0.0f == controller.get_speed());
+  }
+
+  return 0;
+}
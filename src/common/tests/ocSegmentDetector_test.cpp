@@ -0,0 +1,106 @@
+#include "../ocAssert.h"
+#include "../ocSegmentDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+static constexpr uint32_t SIZE = 200;
+
+static float angle_difference(float a, float b)
+{
+  float difference = std::abs(a - b);
+  return std::min(difference, 180.0f - difference);
+}
+
+int main()
+{
+  {
+    std::cout << "Test ocSegmentDetector finds nothing in an empty image\n";
+    std::vector<uint8_t> image(SIZE * SIZE, 0);
+    ocSegmentDetector detector(SIZE, SIZE);
+    oc_assert(0 == detector.detect(image.data()));
+    for (uint32_t i = 0; i < SIZE * SIZE; ++i)
+    {
+      oc_assert(0 == detector.get_edges()[i], i);
+    }
+  }
+
+  {
+    std::cout << "Test ocSegmentDetector finds both sides of a horizontal line\n";
+    std::vector<uint8_t> image(SIZE * SIZE, 0);
+    for (uint32_t y = 100; y < 106; ++y)
+    {
+      for (uint32_t x = 50; x < 150; ++x) image[y * SIZE + x] = 255;
+    }
+    ocSegmentDetector detector(SIZE, SIZE);
+    // the short ends of the line don't make segments
+    oc_assert(2 == detector.detect(image.data()), detector.get_segment_count());
+    for (uint32_t i = 0; i < detector.get_segment_count(); ++i)
+    {
+      const ocLineSegment &segment = detector.get_segments()[i];
+      oc_assert(angle_difference(segment.angle, 0.0f) < 1.0f, segment.angle);
+      oc_assert(95.0f < segment.length && segment.length < 105.0f, segment.length);
+      float y = 0.5f * (segment.y1 + segment.y2);
+      oc_assert(std::abs(y - 99.5f) < 1.0f || std::abs(y - 105.5f) < 1.0f, y);
+      oc_assert(std::abs(0.5f * (segment.x1 + segment.x2) - 99.5f) < 2.0f, segment.x1, segment.x2);
+    }
+    oc_assert(0 < detector.get_edges()[99 * SIZE + 100]);
+    oc_assert(0 < detector.get_edges()[106 * SIZE + 100]);
+    oc_assert(0 == detector.get_edges()[102 * SIZE + 100]);
+    oc_assert(0 == detector.get_edges()[50 * SIZE + 100]);
+
+    std::cout << "Test ocSegmentDetector forgets the last image\n";
+    std::vector<uint8_t> empty(SIZE * SIZE, 0);
+    oc_assert(0 == detector.detect(empty.data()));
+    oc_assert(0 == detector.get_edges()[99 * SIZE + 100]);
+  }
+
+  {
+    std::cout << "Test ocSegmentDetector measures the angle like the image axes\n";
+    // x goes right and y goes down, a line from the top left to the bottom
+    // right has 45 degrees
+    const float angles[] = {10.0f, 30.0f, 45.0f, 90.0f, 135.0f, 160.0f, 178.0f};
+    for (float angle : angles)
+    {
+      float radians = angle * (float)M_PI / 180.0f;
+      std::vector<uint8_t> image(SIZE * SIZE, 0);
+      for (uint32_t y = 0; y < SIZE; ++y)
+      {
+        for (uint32_t x = 0; x < SIZE; ++x)
+        {
+          float dx = (float)x - 100.0f;
+          float dy = (float)y - 100.0f;
+          float across = -dx * std::sin(radians) + dy * std::cos(radians);
+          float along = dx * std::cos(radians) + dy * std::sin(radians);
+          // soft edges like in a blurred image, hard steps don't have a
+          // clear direction along a slanted line
+          float inside = std::min(4.0f - std::abs(across), 60.0f - std::abs(along));
+          image[y * SIZE + x] = (uint8_t)(255.0f * std::clamp(0.5f + inside / 3.0f, 0.0f, 1.0f));
+        }
+      }
+      ocSegmentDetector detector(SIZE, SIZE);
+      oc_assert(2 == detector.detect(image.data()), angle, detector.get_segment_count());
+      for (uint32_t i = 0; i < 2; ++i)
+      {
+        const ocLineSegment &segment = detector.get_segments()[i];
+        oc_assert(angle_difference(segment.angle, angle) < 1.0f, angle, segment.angle);
+        oc_assert(100.0f < segment.length, angle, segment.length);
+      }
+    }
+  }
+
+  {
+    std::cout << "Test ocSegmentDetector stops when the segments are full\n";
+    std::vector<uint8_t> image(SIZE * SIZE, 0);
+    for (uint32_t y = 20; y < SIZE - 20; y += 20)
+    {
+      for (uint32_t x = 50; x < 150; ++x) image[y * SIZE + x] = 255;
+    }
+    ocSegmentDetector detector(SIZE, SIZE, 4);
+    oc_assert(4 == detector.detect(image.data()), detector.get_segment_count());
+    // the edges of the lines without segments are still there
+    oc_assert(0 < detector.get_edges()[(SIZE - 41) * SIZE + 100]);
+  }
+}
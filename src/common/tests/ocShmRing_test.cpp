@@ -0,0 +1,148 @@
+#include "../ocAssert.h"
+#include "../ocShmRing.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main()
+{
+  const uint32_t capacity = 256;
+  std::vector<std::byte> memory(ocShmRing::memory_size(capacity) + 64);
+  // The header wants cache line alignment.
+  void *aligned = (void *)(((uintptr_t)memory.data() + 63) & ~(uintptr_t)63);
+
+  {
+    std::cout << "Test ocShmRing write, peek and pop\n";
+    ocShmRing producer;
+    ocShmRing consumer;
+    producer.init(aligned, capacity);
+    consumer.attach(aligned);
+
+    ocPacketView view;
+    oc_assert(!consumer.peek(view));
+
+    uint32_t value = 0xCAFE;
+    oc_assert(producer.write(ocMessageId::Lane_Detection_Values, ocMemberId::Lane_Detection_Values, &value, sizeof(value)));
+    // The ring starts out with a waiting consumer.
+    oc_assert(producer.take_wakeup());
+    oc_assert(!producer.take_wakeup());
+
+    oc_assert(consumer.peek(view));
+    oc_assert(view.get_message_id() == ocMessageId::Lane_Detection_Values);
+    oc_assert(view.get_sender() == ocMemberId::Lane_Detection_Values);
+    oc_assert(view.get_length() == sizeof(value), view.get_length());
+    uint32_t read_value;
+    memcpy(&read_value, view.get_data(), sizeof(read_value));
+    oc_assert(read_value == value, read_value);
+    consumer.pop();
+    oc_assert(!consumer.peek(view));
+  }
+
+  {
+    std::cout << "Test ocShmRing wrap around and full ring\n";
+    ocShmRing producer;
+    ocShmRing consumer;
+    producer.init(aligned, capacity);
+    consumer.attach(aligned);
+
+    uint8_t payload[100];
+    ocPacketView view;
+    for (uint8_t i = 0; i < 50; ++i)
+    {
+      memset(payload, i, sizeof(payload));
+      oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)), i);
+      // every packet is 8 + 100 bytes, padded to 112, so the third one doesn't fit
+      if (0 == i % 2)
+      {
+        oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)), i);
+        oc_assert(!producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)), i);
+        oc_assert(consumer.peek(view));
+        consumer.pop();
+      }
+      oc_assert(consumer.peek(view));
+      oc_assert(view.get_length() == sizeof(payload), view.get_length());
+      oc_assert(view.get_data()[99] == (std::byte)i, i);
+      consumer.pop();
+    }
+    oc_assert(!consumer.peek(view));
+    oc_assert(!producer.can_ever_fit(capacity));
+  }
+
+  {
+    std::cout << "Test ocShmRing prepare_wait\n";
+    ocShmRing producer;
+    ocShmRing consumer;
+    producer.init(aligned, capacity);
+    consumer.attach(aligned);
+    (void)producer.take_wakeup();
+
+    oc_assert(consumer.prepare_wait());
+    oc_assert(producer.write(ocMessageId::Lines_Available, ocMemberId::None, nullptr, 0));
+    oc_assert(!consumer.prepare_wait());
+    oc_assert(producer.take_wakeup());
+  }
+
+  {
+    std::cout << "Test ocShmRing can_write\n";
+    ocShmRing producer;
+    ocShmRing consumer;
+    producer.init(aligned, capacity);
+    consumer.attach(aligned);
+
+    ocPacket packet(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway);
+    uint8_t payload[100] = {};
+    packet.clear_and_edit().write(payload, sizeof(payload));
+    const ocPacket *batch[] = {&packet, &packet, &packet};
+    // 112 bytes each, the third one doesn't fit
+    oc_assert(producer.can_write(batch, 2));
+    oc_assert(!producer.can_write(batch, 3));
+
+    // After the first one was read, the second one has to wrap around and
+    // leaves 32 bytes of padding at the end.
+    oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)));
+    oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)));
+    ocPacketView view;
+    oc_assert(consumer.peek(view));
+    consumer.pop();
+    oc_assert(!producer.can_write(batch, 2));
+    oc_assert(producer.can_write(batch, 1));
+    oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)));
+    oc_assert(!producer.can_write(batch, 1));
+  }
+
+  {
+    std::cout << "Test ocShmRing wait_for_space\n";
+    ocShmRing producer;
+    ocShmRing consumer;
+    producer.init(aligned, capacity);
+    consumer.attach(aligned);
+
+    uint8_t payload[100] = {};
+    oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)));
+    oc_assert(producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)));
+
+    // With room in the ring it returns right away, without the timeout.
+    ocTime begin = ocTime::now();
+    producer.wait_for_space(8, ocTime::seconds(10));
+    oc_assert(ocTime::now() - begin < ocTime::seconds(1));
+
+    // The pop wakes up the producer long before the timeout.
+    std::thread consumer_thread([&]()
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      ocPacketView view;
+      oc_assert(consumer.peek(view));
+      consumer.pop();
+    });
+    begin = ocTime::now();
+    while (!producer.write(ocMessageId::Can_Frame_Received, ocMemberId::Can_Gateway, payload, sizeof(payload)))
+    {
+      producer.wait_for_space(sizeof(payload), ocTime::seconds(10));
+    }
+    oc_assert(ocTime::now() - begin < ocTime::seconds(5));
+    consumer_thread.join();
+  }
+}
@@ -0,0 +1,32 @@
+#include "../ocAssert.h"
+#include "../ocWorkerPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+  {
+    std::cout << "Test ocWorkerPool runs every task once\n";
+    ocWorkerPool pool(3);
+    oc_assert(4 == pool.get_concurrency(), pool.get_concurrency());
+    for (uint32_t round = 0; round < 200; ++round)
+    {
+      uint32_t task_count = round % 37;
+      std::vector<std::atomic<uint32_t>> calls(task_count);
+      pool.run(task_count, [&](uint32_t i){ calls[i]++; });
+      for (uint32_t i = 0; i < task_count; ++i) oc_assert(1 == calls[i], round, i);
+    }
+  }
+
+  {
+    std::cout << "Test ocWorkerPool without threads runs on the caller\n";
+    ocWorkerPool pool(0);
+    std::vector<uint32_t> order;
+    pool.run(5, [&](uint32_t i){ order.push_back(i); });
+    oc_assert(5 == order.size());
+    for (uint32_t i = 0; i < 5; ++i) oc_assert(i == order[i], i);
+  }
+}
@@ -1,31 +1,30 @@
+#include <cmath>
 #include <cstdint>
-#include <chrono>
+#include <cstdlib>
+#include <iterator>
 #include "Driver.h"
 #include "../common/ocCar.h"
+#include "../common/ocCarConfig.h"
+
+#define CAR_CONFIG_FILE "../car_properties.conf"
+
+// A step that drives gives up, when the odometry didn't see it through after this many times the time it should
+// take at its speed.
+static constexpr float ODOMETRY_TIMEOUT_FACTOR = 3.0f;
+static constexpr float QUARTER_TURN = 1.5707963f;
 
 
 
 /**
- * This method is used to initialize the Driver, mainly the communication with the IPC-Hub.
+ * This method is used to initialize the Driver. It has no connection of its own, it sends on the one of the Statemachine.
+ * @param socket ocIpcSocket*: The socket of the Statemachine
+ * @param logger ocLogger*: The logger of the Statemachine
 */
-void Driver::initialize(){
+void Driver::initialize(ocIpcSocket *socket, ocLogger *logger){
     if(!is_initialized){
-        member.attach();
-        socket = member.get_socket();
-        logger = member.get_logger();
-        ocPacket sup = ocPacket(ocMessageId::Subscribe_To_Messages);
-        sup.set_sender(ocMemberId::Driver);
-        sup.clear_and_edit()
-            .write(ocMessageId::Lane_Detection_Values);
-        socket->send_packet(sup);
-
-        ocPacket deafen = ocPacket(ocMessageId::Deafen_Member);
-        deafen.set_sender(ocMemberId::Driver);
-        deafen.clear_and_edit()
-            .write(ocMemberId::Driver)
-            .write(true);
-        socket->send_packet(deafen);
-
+        Driver::socket = socket;
+        Driver::logger = logger;
+        read_config_file(CAR_CONFIG_FILE, car_properties, *logger);
         is_initialized = true;
     }
 }
@@ -34,85 +33,31 @@ void Driver::initialize(){
 
 /**
  * This method is used to perform a right-turn.
+ * It returns right away, the Statemachine runs the maneuver.
 */
 void Driver::turn_right(){
+    static const Maneuver_Step steps[] = {
+        {25, 100, -50, 0.0f, QUARTER_TURN, 0.0f},
+        { 0,   0,   0, 0.0f,         0.0f, 0.0f},
+    };
     logger->log("Decider: Driver: Turning right");
-    drive_both_steering_values(25, 100, -50);
-    wait(1.8);
-    stop();
+    start_maneuver(steps, std::size(steps));
 }
 
 
 
 /**
  * This method is used to perform a left-turn.
+ * It returns right away, the Statemachine runs the maneuver.
 */
 void Driver::turn_left(){
+    static const Maneuver_Step steps[] = {
+        {25,   0, 0, 17.5f,         0.0f, 0.0f}, //drive forward a little bit
+        {25, -70, 0,  0.0f, QUARTER_TURN, 0.0f}, //turn left
+        { 0,   0, 0,  0.0f,         0.0f, 0.0f},
+    };
     logger->log("Decider: Driver: Turning left");
-    //drive forward a little bit
-    drive(25, 0);
-    wait(0.7);
-
-    //turn left
-    drive(25, -70);
-    wait(3.825);
-    stop();
-}
-
-
-
-/**
- * This method is called to drive forward.
- * The speed and steering values are received from the lane-detection using the IPC-Hub.
-*/
-void Driver::drive_forward(){
-    ocPacket deafen = ocPacket(ocMessageId::Deafen_Member);
-    deafen.set_sender(ocMemberId::Driver);
-    deafen.clear_and_edit()
-        .write(ocMemberId::Driver)
-        .write(false);
-    socket->send_packet(deafen);
-
-    ocPacket recv_packet;
-
-    int result = socket->read_packet(recv_packet);
-
-    if (result < 0){
-      logger->error("Decider: Driver: Error reading the IPC socket: (%i) %s", errno, strerror(errno));
-    } else {
-        switch (recv_packet.get_message_id()){
-            case ocMessageId::Lane_Detection_Values:{
-                auto reader = recv_packet.read_from_start();
-
-                int16_t speed = reader.read<int16_t>();
-                int8_t steering_front = reader.read<int8_t>();
-                int8_t steering_back = reader.read<int8_t>();
-                
-
-                struct start_driving_task_t start_driving_task = {
-                    .speed          = speed,
-                    .steering_front = steering_front,
-                    .steering_rear  = steering_back,
-                    .id             = 1,
-                    .steps_ab       = 10
-                };
-
-                int32_t send_result = socket->send(ocMessageId::Start_Driving_Task, start_driving_task);
-                //logger->log("Result of sending driving task: %d", send_result);
-            } break;
-
-            default:{
-                ocMessageId msg_id = recv_packet.get_message_id();
-                ocMemberId  mbr_id = recv_packet.get_sender();
-                logger->warn("Decider: Driver: Unhandled message_id: %s (0x%x) from sender: %s (%i)", to_string(msg_id), msg_id, to_string(mbr_id), mbr_id);
-            } break;
-        }
-    }
-
-    deafen.clear_and_edit()
-        .write(ocMemberId::Driver)
-        .write(true);
-    socket->send_packet(deafen);
+    start_maneuver(steps, std::size(steps));
 }
 
 
@@ -123,9 +68,7 @@ void Driver::drive_forward(){
  * @param steering int8_t: The steering value with which to drive
 */
 void Driver::drive(int16_t speed, int8_t steering){
-    ocCarProperties ocCarProperties;
-
-    struct start_driving_task_t start_driving_task = {
+    ocStartDrivingTask start_driving_task = {
         .speed          = speed,
         .steering_front = steering,
         .steering_rear  = 0,
@@ -133,8 +76,7 @@ void Driver::drive(int16_t speed, int8_t steering){
         .steps_ab       = 0
     };
 
-    int32_t send_result = socket->send(ocMessageId::Start_Driving_Task, start_driving_task);
-    //logger->log("Result of sending driving task: %d", send_result);
+    socket->send(start_driving_task);
 }
 
 
@@ -144,34 +86,43 @@ void Driver::drive(int16_t speed, int8_t steering){
  * @param speed int16_t: The speed with which to drive
  * @param steering_front int8_t: The front-steering value with which to drive
  * @param steering_back int8_t: The back-steering value with which to drive
+ * @param frame_time ocTime: Exposure of the camera frame the values come from, passed on to measure the latency
 */
-void Driver::drive_both_steering_values(int16_t speed, int8_t steering_front, int8_t steering_back){
-    ocCarProperties ocCarProperties;
-
-    struct start_driving_task_t start_driving_task = {
+void Driver::drive_both_steering_values(int16_t speed, int8_t steering_front, int8_t steering_back, ocTime frame_time){
+    ocStartDrivingTask start_driving_task = {
         .speed          = speed,
         .steering_front = steering_front,
         .steering_rear  = steering_back,
         .id             = 1,
-        .steps_ab       = 0
+        .steps_ab       = 0,
+        .frame_time     = frame_time
     };
 
-    int32_t send_result = socket->send(ocMessageId::Start_Driving_Task, start_driving_task);
-    //logger->log("Result of sending driving task: %d", send_result);
+    socket->send(start_driving_task);
 }
 
 
 
 /**
  * This method is used to stop the car for the given duration.
- * This method is blocking!
+ * With a duration it starts a maneuver that stands still and returns right away, the Statemachine runs the maneuver.
  * @param duration float: The duration for which to stop
 */
 void Driver::stop(float duration){
-    
+    static Maneuver_Step standing_still[] = {
+        {0, 0, 0, 0.0f, 0.0f, 0.0f},
+    };
+
+    if (0 < duration){
+        standing_still[0].duration = duration;
+        logger->log("Decider: Driver: Stopping for %.2fs", duration);
+        start_maneuver(standing_still, std::size(standing_still));
+        return;
+    }
+
     logger->log("Decider: Driver: Stopping");
 
-    struct start_driving_task_t start_driving_task = {
+    ocStartDrivingTask start_driving_task = {
         .speed          = 0,
         .steering_front = 0,
         .steering_rear  = 0,
@@ -179,10 +130,7 @@ void Driver::stop(float duration){
         .steps_ab       = 0
     };
 
-    int32_t send_result = socket->send(ocMessageId::Start_Driving_Task, start_driving_task);
-    //logger->log("Result of sending stop task: %d", send_result);
-
-    wait(duration);
+    socket->send(start_driving_task);
 }
 
 
@@ -190,67 +138,189 @@ void Driver::stop(float duration){
 /**
  * This method is used to park the car. It is assumed that the method is called, when the car is located closely infront of a parking sign.
  * The car will proceed to first drive forward some distance and then reverse-park in an area to the right of the street.
+ * It returns right away, the Statemachine runs the maneuver.
 */
 void Driver::park(){
-    /*Drive forward a little bit*/
-    drive(25, 0);
-    wait(6.5);
-    stop();
+    static const Maneuver_Step steps[] = {
+        /*Drive forward a little bit*/
+        { 25,    0, 0, 162.5f, 0.0f, 0.0f},
+        {  0,    0, 0,   0.0f, 0.0f, 0.0f},
 
-    /*Drive backward to the right*/
-    drive(-20, -100);
-    wait(2);
-    drive(-20, 0);
-    wait(1.25);
+        /*Drive backward to the right*/
+        {-20, -100, 0,  40.0f, 0.0f, 0.0f},
+        {-20,    0, 0,  25.0f, 0.0f, 0.0f},
 
-    /*Drive backward to the left*/
-    drive(-20, 100);
-    wait(1);
-    stop();
+        /*Drive backward to the left*/
+        {-20,  100, 0,  20.0f, 0.0f, 0.0f},
+        {  0,    0, 0,   0.0f, 0.0f, 0.0f},
 
-    /*Drive forward to the right*/
-    drive(20, 100);
-    wait(1);
-    drive(20, 0);
-    wait(0.9);
+        /*Drive forward to the right*/
+        { 20,  100, 0,  20.0f, 0.0f, 0.0f},
+        { 20,    0, 0,  18.0f, 0.0f, 0.0f},
 
-    stop();
+        {  0,    0, 0,   0.0f, 0.0f, 0.0f},
+    };
+    start_maneuver(steps, std::size(steps));
 }
 
 
 
 /**
  * This method is used to park out, after using the park()-method.
+ * It returns right away, the Statemachine runs the maneuver.
 */
 void Driver::park_out(){
-    /*Drive forward to the left*/
-    drive(25, -100);
-    wait(1.5);
-
-    /*Drive foward a little bit*/
-    drive(25, 0);
-    wait(1);
-    
-    /*Drive forward to the right*/
-    drive(25, 100);
-    wait(1.15);
+    static const Maneuver_Step steps[] = {
+        /*Drive forward to the left*/
+        {25, -100, 0, 37.5f,  0.0f, 0.0f},
 
-    stop();
+        /*Drive foward a little bit*/
+        {25,    0, 0, 25.0f,  0.0f, 0.0f},
+
+        /*Drive forward to the right*/
+        {25,  100, 0, 28.75f, 0.0f, 0.0f},
+
+        { 0,    0, 0,  0.0f,  0.0f, 0.0f},
+    };
+    start_maneuver(steps, std::size(steps));
 }
 
 
 
 /**
- * This method is used to wait for a given duration.
- * This method is blocking!
- * @param duration float: The duration for which to wait
+ * This method is used to start a maneuver, a sequence of steps that each drive with fixed values for some distance.
+ * It returns right away. update_odometry() moves on to the next step once the car drove far enough, update_maneuver()
+ * once the fd from get_maneuver_fd() is readable.
+ * A running maneuver is aborted first.
+ * @param steps const Maneuver_Step*: The steps, they have to stay valid until the maneuver is done
+ * @param count size_t: The number of steps
 */
-void Driver::wait(float duration){
-    auto start = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed_seconds;
-
-    do {
-        auto now = std::chrono::system_clock::now();
-        elapsed_seconds = now - start;
-    } while (elapsed_seconds.count() < duration);
+void Driver::start_maneuver(const Maneuver_Step *steps, size_t count){
+    if (is_maneuvering()){
+        abort_maneuver();
+    }
+    maneuver = steps;
+    maneuver_length = count;
+    maneuver_step = 0;
+    begin_step();
+}
+
+
+
+/**
+ * This method is used to get how far a step drives. Steps with a heading drive along the arc of their steering.
+ * @return float: The length of the step in cm, 0 if it doesn't end on the odometry
+*/
+float Driver::get_step_length(const Maneuver_Step &step){
+    if (0 == step.speed) return 0.0f;
+    if (0 != step.heading){
+        ocCarState car = {};
+        car.properties = &car_properties;
+        float radius = car.steering_to_radius(car_properties.byte_to_front_steering_angle(step.steering_front),
+                                              car_properties.byte_to_rear_steering_angle(step.steering_rear));
+        if (std::isfinite(radius)){
+            return std::fabs(radius * step.heading);
+        }
+        logger->warn("Decider: Driver: A maneuver step turns with straight steering, using its distance");
+    }
+    return step.distance;
+}
+
+
+
+/**
+ * This method is used to send the values of the current step and to set up its end.
+ * Steps that drive end on the odometry, steps that stand still end on the alarm. Steps without either are done right
+ * away. After the last step the maneuver is over.
+*/
+void Driver::begin_step(){
+    for (; maneuver_step < maneuver_length; ++maneuver_step){
+        const Maneuver_Step &step = maneuver[maneuver_step];
+        float length = get_step_length(step);
+        step_length_steps = (int32_t)std::lround(car_properties.cm_to_steps(length));
+        step_start_steps = odo_steps;
+
+        if (0 < step_length_steps){
+            // The car is told where the step ends as well
+            ocStartDrivingTask start_driving_task = {
+                .speed          = step.speed,
+                .steering_front = step.steering_front,
+                .steering_rear  = step.steering_rear,
+                .id             = 1,
+                .steps_ab       = odo_steps + (0 < step.speed ? step_length_steps : -step_length_steps)
+            };
+            socket->send(start_driving_task);
+
+            // The speed is in cm/s, see Maneuver_Step, so this is in seconds.
+            float expected = length / (float)std::abs(step.speed);
+            step_alarm.set_period(ocTime::seconds_float(expected * ODOMETRY_TIMEOUT_FACTOR));
+            step_alarm.start(ocAlarmType::Once);
+            return;
+        }
+
+        drive_both_steering_values(step.speed, step.steering_front, step.steering_rear);
+        if (0 < step.duration){
+            step_alarm.set_period(ocTime::seconds_float(step.duration));
+            step_alarm.start(ocAlarmType::Once);
+            return;
+        }
+    }
+    maneuver = nullptr;
+    step_length_steps = 0;
+}
+
+
+
+/**
+ * This method is used to move on to the next step of the maneuver, if the alarm of the current one expired.
+ * If a step that drives runs out of time, the odometry is missing and the maneuver is aborted.
+ * @return bool: true if the maneuver is done now
+*/
+bool Driver::update_maneuver(){
+    if (!is_maneuvering() || !step_alarm.is_expired()) return false;
+    if (0 < step_length_steps){
+        logger->error("Decider: Driver: The odometry didn't see the maneuver step through, aborting the maneuver");
+        abort_maneuver();
+        return true;
+    }
+    ++maneuver_step;
+    begin_step();
+    return !is_maneuvering();
+}
+
+
+
+/**
+ * This method is used to move on to the next step of the maneuver, once the car drove far enough.
+ * @param steps int32_t: The odometry steps from Received_Odo_Steps
+ * @return bool: true if the maneuver is done now
+*/
+bool Driver::update_odometry(int32_t steps){
+    if (!has_odo_steps){
+        // the first count may be anywhere, steps started before it start here
+        step_start_steps = steps;
+        has_odo_steps = true;
+    }
+    odo_steps = steps;
+
+    if (!is_maneuvering() || 0 == step_length_steps) return false;
+    if (std::abs(odo_steps - step_start_steps) < step_length_steps) return false;
+
+    step_alarm.stop();
+    ++maneuver_step;
+    begin_step();
+    return !is_maneuvering();
+}
+
+
+
+/**
+ * This method is used to stop the car in the middle of a maneuver.
+*/
+void Driver::abort_maneuver(){
+    if (!is_maneuvering()) return;
+    step_alarm.stop();
+    maneuver = nullptr;
+    step_length_steps = 0;
+    stop();
 }
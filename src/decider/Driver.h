@@ -1,52 +1,83 @@
 #pragma once
 
-#include "../common/ocMember.h"
+#include "../common/ocIpcSocket.h"
+#include "../common/ocLogger.h"
 #include "../common/ocPacket.h"
 #include "../common/ocCar.h"
+#include "../common/ocAlarm.h"
+#include <cstddef>
 #include <cstdint>
 
 
 
+class ocPacket;
+class ocIpcSocket;
+
+
+
 /**
- * A sctruct which implements the data-structure for a start-driving-task-message.
+ * One step of a maneuver: the car drives with these values until the odometry
+ * says it drove the distance in cm, or until its heading changed by the angle
+ * in radians with this steering. Steps that stand still wait for the duration
+ * in seconds instead. Steps without any of them only send their values.
+ * The speed is in cm/s like every Start_Driving_Task speed, that is how
+ * virtual_car drives them. The car itself gets speed / 4 on the CAN bus.
 */
-struct start_driving_task_t{
+struct Maneuver_Step {
     int16_t speed;
-    int8_t 	steering_front;
-    int8_t 	steering_rear;
-    int8_t 	id;
-    int32_t steps_ab;
+    int8_t  steering_front;
+    int8_t  steering_rear;
+    float   distance;
+    float   heading;
+    float   duration;
 };
 
 
 
-class ocMember;
-class ocPacket;
-class ocIpcSocket;
-
-
-
 class Driver {
     private:
         static inline bool is_initialized = false;
 
-        static inline ocMember member = ocMember(ocMemberId::Driver, "Driver");
+        // The Driver sends on the connection of the Statemachine
         static inline ocIpcSocket *socket;
+
+        // The running maneuver, nullptr if there is none
+        static inline const Maneuver_Step *maneuver = nullptr;
+        static inline size_t maneuver_length = 0;
+        static inline size_t maneuver_step = 0;
+        // Ends steps that stand still. Steps that drive end on the odometry, the alarm only gives up on them when
+        // no odometry arrives.
+        static inline ocAlarm step_alarm;
+
+        static inline ocCarProperties car_properties;
+        static inline int32_t odo_steps = 0;
+        static inline bool has_odo_steps = false;
+        // Odometry of the start of the current step and how far it goes, 0 if it doesn't end on the odometry
+        static inline int32_t step_start_steps = 0;
+        static inline int32_t step_length_steps = 0;
+
+        static float get_step_length(const Maneuver_Step &step);
+        static void begin_step();
     
 
     public:
         static inline ocLogger    *logger;
-        static void initialize();
+        static void initialize(ocIpcSocket *socket, ocLogger *logger);
 
         static void turn_right();
         static void turn_left();
-        static void drive_forward();
         static void drive(int16_t speed, int8_t steering=0);
-        static void drive_both_steering_values(int16_t speed, int8_t steering_front, int8_t steering_back);
+        static void drive_both_steering_values(int16_t speed, int8_t steering_front, int8_t steering_back, ocTime frame_time=ocTime::null());
         static void stop(float duration=0);
         static void park();
         static void park_out();
-        static void wait(float duration=0);
+
+        static void start_maneuver(const Maneuver_Step *steps, size_t count);
+        static bool is_maneuvering() { return nullptr != maneuver; }
+        static int get_maneuver_fd() { return step_alarm.get_fd(); }
+        static bool update_maneuver();
+        static bool update_odometry(int32_t steps);
+        static void abort_maneuver();
 };
 
 
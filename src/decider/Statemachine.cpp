@@ -1,4 +1,5 @@
 #include "Statemachine.h"
+#include "Driver.h"
 #include "States/Crossing_3_Way_Right.h"
 #include "States/Crossing_3_Way_Left.h"
 #include "States/Crossing_3_Way_T.h"
@@ -6,25 +7,224 @@
 #include "States/Is_At_Crossing.h"
 #include "States/Approaching_Crossing.h"
 #include "States/Normal_Drive.h"
+#include "States/Obstacle_State.h"
+#include "States/Parking.h"
+#include "../common/ocPollEngine.h"
 
+#include <array>
+#include <cerrno>
+#include <cstring>
 
 
+
+// An event that doesn't lead anywhere from a state leaves the state as it is.
+static constexpr State_Id STAY = State_Id::Count;
+
+struct Transition {
+    State_Id from;
+    Decider_Event event;
+    State_Id to;
+};
+
+static constexpr Transition TRANSITION_LIST[] = {
+    {State_Id::Normal_Drive,         Decider_Event::Intersection_Ahead, State_Id::Approaching_Crossing},
+    {State_Id::Normal_Drive,         Decider_Event::At_Intersection,    State_Id::Is_At_Crossing},
+    {State_Id::Normal_Drive,         Decider_Event::Obstacle,           State_Id::Obstacle_State},
+    {State_Id::Approaching_Crossing, Decider_Event::At_Intersection,    State_Id::Is_At_Crossing},
+    {State_Id::Approaching_Crossing, Decider_Event::Obstacle,           State_Id::Obstacle_State},
+    {State_Id::Is_At_Crossing,       Decider_Event::Left_Crossing,      State_Id::Crossing_3_Way_Left},
+    {State_Id::Is_At_Crossing,       Decider_Event::Right_Crossing,     State_Id::Crossing_3_Way_Right},
+    {State_Id::Is_At_Crossing,       Decider_Event::T_Crossing,         State_Id::Crossing_3_Way_T},
+    {State_Id::Crossing_3_Way_Left,  Decider_Event::Crossing_Passed,    State_Id::Normal_Drive},
+    {State_Id::Crossing_3_Way_Left,  Decider_Event::Obstacle,           State_Id::Obstacle_State},
+    {State_Id::Crossing_3_Way_Right, Decider_Event::Crossing_Passed,    State_Id::Normal_Drive},
+    {State_Id::Crossing_3_Way_Right, Decider_Event::Obstacle,           State_Id::Obstacle_State},
+    {State_Id::Crossing_3_Way_T,     Decider_Event::Crossing_Passed,    State_Id::Normal_Drive},
+    {State_Id::Crossing_3_Way_T,     Decider_Event::Obstacle,           State_Id::Obstacle_State},
+    {State_Id::Obstacle_State,       Decider_Event::Obstacle_Gone,      State_Id::Normal_Drive},
+};
+
+using Transition_Table = std::array<std::array<State_Id, (size_t)Decider_Event::Count>, (size_t)State_Id::Count>;
+
+static constexpr Transition_Table make_transition_table(){
+    Transition_Table table = {};
+    for (auto& row : table){
+        row.fill(STAY);
+    }
+    for (const Transition& transition : TRANSITION_LIST){
+        table[(size_t)transition.from][(size_t)transition.event] = transition.to;
+    }
+    return table;
+}
+
+// TRANSITIONS[state][event] is the state that comes next
+static constexpr Transition_Table TRANSITIONS = make_transition_table();
+
+
+
+static const char* to_string(Decider_Event event){
+    switch (event){
+        case Decider_Event::None:               return "None";
+        case Decider_Event::Intersection_Ahead: return "Intersection_Ahead";
+        case Decider_Event::At_Intersection:    return "At_Intersection";
+        case Decider_Event::Left_Crossing:      return "Left_Crossing";
+        case Decider_Event::Right_Crossing:     return "Right_Crossing";
+        case Decider_Event::T_Crossing:         return "T_Crossing";
+        case Decider_Event::Crossing_Passed:    return "Crossing_Passed";
+        case Decider_Event::Obstacle:           return "Obstacle";
+        case Decider_Event::Obstacle_Gone:      return "Obstacle_Gone";
+        case Decider_Event::Count:              break;
+    }
+    return "Unknown";
+}
+
+
+
+/**
+ * This method is used to connect to the IPC-Hub. All states share this one connection, it subscribes to everything
+ * any of them needs once, so changing the state needs no packets to the IPC-Hub.
+*/
 Statemachine::Statemachine(){
-    this->current_state = nullptr;//&Normal_Drive::get_instance();
+    member.attach();
+    socket = member.get_socket();
+    logger = member.get_logger();
+    State::logger = logger;
+    Driver::initialize(socket, logger);
+
+    ocPacket sup = ocPacket(ocMessageId::Subscribe_To_Messages);
+    sup.set_sender(ocMemberId::Driver);
+    sup.clear_and_edit()
+        .write(ocMessageId::Intersection_Detected)
+        .write(ocMessageId::Object_Found)
+        .write(ocMessageId::Lane_Detection_Values)
+        .write(ocMessageId::Traffic_Sign_Detected)
+        .write(ocMessageId::Received_Odo_Steps);
+    socket->send_packet(sup);
+
+    states[(size_t)State_Id::Normal_Drive]         = &Normal_Drive::get_instance();
+    states[(size_t)State_Id::Approaching_Crossing] = &Approaching_Crossing::get_instance();
+    states[(size_t)State_Id::Is_At_Crossing]       = &Is_At_Crossing::get_instance();
+    states[(size_t)State_Id::Crossing_3_Way_Left]  = &Crossing_3_Way_Left::get_instance();
+    states[(size_t)State_Id::Crossing_3_Way_Right] = &Crossing_3_Way_Right::get_instance();
+    states[(size_t)State_Id::Crossing_3_Way_T]     = &Crossing_3_Way_T::get_instance();
+    states[(size_t)State_Id::Crossing_4_Way]       = &Crossing_4_Way::get_instance();
+    states[(size_t)State_Id::Obstacle_State]       = &Obstacle_State::get_instance();
+    states[(size_t)State_Id::Parking]              = &Parking::get_instance();
+}
+
+
+
+/**
+ * This method is used to leave the current state and enter the given one.
+ * @return Decider_Event: What the new state returned from on_entry()
+*/
+Decider_Event Statemachine::enter_state(State_Id state){
+    State* previous = get_current_state();
+    if (previous != nullptr){
+        previous->on_exit(this);
+        logger->log("Decider: Changing state from %s to %s", previous->get_name(), states[(size_t)state]->get_name());
+    }
+    clear_timeout();
+    current_state = state;
+    return states[(size_t)state]->on_entry(this);
 }
 
 
-void Statemachine::change_state(State& state){
-    if(current_state != nullptr){
-        current_state->on_exit(this);
+
+/**
+ * This method is used to change the state right away, no matter what the transition table says.
+*/
+void Statemachine::change_state(State_Id state){
+    dispatch(enter_state(state));
+}
+
+
+
+/**
+ * This method is used to follow the transition table for an event of the current state.
+ * States can return another event from on_entry(), those are followed too.
+*/
+void Statemachine::dispatch(Decider_Event event){
+    while (Decider_Event::None != event){
+        State_Id next = TRANSITIONS[(size_t)current_state][(size_t)event];
+        if (STAY == next){
+            logger->warn("Decider: %s has no transition for %s", get_current_state()->get_name(), to_string(event));
+            return;
+        }
+        event = enter_state(next);
+    }
+}
+
+
+
+/**
+ * This method is used to hand a packet to the current state. Traffic signs are remembered for all states, the odometry
+ * goes to the Driver.
+*/
+void Statemachine::handle_packet(ocPacket& packet){
+    if (ocMessageId::Received_Odo_Steps == packet.get_message_id()){
+        int32_t steps = packet.read_from_start().read<int32_t>();
+        if (Driver::update_odometry(steps)){
+            dispatch(get_current_state()->on_maneuver_done(this));
+        }
+        return;
+    }
+    if (ocMessageId::Traffic_Sign_Detected == packet.get_message_id()){
+        ocTrafficSignDetected sign;
+        if (!packet.read(&sign)) return;
+        State::trafficSign = static_cast<TrafficSignType>(sign.sign_type);
+        State::distance = sign.distance;
+        return;
     }
-    current_state = &state;
-    current_state->on_entry(this);
+    dispatch(get_current_state()->on_packet(this, packet));
 }
 
 
-void Statemachine::run(void *data){
-    if(current_state != nullptr){
-        current_state->run(this, data);
+
+/**
+ * This method is used to run the decider. It sleeps until a packet arrives, the alarm of the Driver's maneuver expires
+ * or the timeout of the current state expires, and hands that to the current state.
+*/
+void Statemachine::run(){
+    ocPollEngine pe(3);
+    pe.add_fd(socket->get_fd());
+    pe.add_fd(Driver::get_maneuver_fd());
+    pe.add_fd(state_alarm.get_fd());
+
+    ocPacket recv_packet;
+    while (running && get_current_state() != nullptr){
+        pe.await();
+
+        if (pe.was_triggered(socket->get_fd())){
+            int32_t result;
+            while (0 < (result = socket->read_packet(recv_packet, false))){
+                handle_packet(recv_packet);
+            }
+            if (result < 0){
+                logger->error("Decider: Error reading the IPC socket: (%i) %s", errno, strerror(errno));
+                running = false;
+            }
+        }
+
+        if (pe.was_triggered(Driver::get_maneuver_fd()) && Driver::update_maneuver()){
+            dispatch(get_current_state()->on_maneuver_done(this));
+        }
+
+        if (pe.was_triggered(state_alarm.get_fd()) && state_alarm.is_expired()){
+            dispatch(get_current_state()->on_timeout(this));
+        }
     }
 }
+
+
+
+void Statemachine::set_timeout(ocTime timeout){
+    state_alarm.set_period(timeout);
+    state_alarm.start(ocAlarmType::Once);
+}
+
+
+
+void Statemachine::clear_timeout(){
+    state_alarm.stop();
+}
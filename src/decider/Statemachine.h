@@ -1,18 +1,51 @@
 #pragma once
+#include "../common/ocAlarm.h"
+#include "../common/ocMember.h"
 #include "States/State.h"
 
 
-class State;
+enum class State_Id : uint8_t {
+    Normal_Drive,
+    Approaching_Crossing,
+    Is_At_Crossing,
+    Crossing_3_Way_Left,
+    Crossing_3_Way_Right,
+    Crossing_3_Way_T,
+    Crossing_4_Way,
+    Obstacle_State,
+    Parking,
+    Count
+};
+
 
+/**
+ * Runs the decider in one event loop on one IPC connection. Packets, the end of maneuvers and state timeouts are
+ * handed to the current state, the events it returns select the next state from a fixed transition table.
+*/
 class Statemachine {
     private:
-        State* current_state;
-    
+        ocMember member = ocMember(ocMemberId::Driver, "Decider");
+        ocIpcSocket* socket;
+        ocLogger* logger;
+        ocAlarm state_alarm;
+
+        State* states[(size_t)State_Id::Count];
+        State_Id current_state = State_Id::Count;
+        bool running = true;
+
+        void handle_packet(ocPacket& packet);
+        Decider_Event enter_state(State_Id state);
+        void dispatch(Decider_Event event);
+
     public:
         Statemachine();
-        inline State* get_current_state() const { return current_state; }
-        void change_state(State& state);
-        void run(void *data);
-};
+        inline State* get_current_state() const { return State_Id::Count == current_state ? nullptr : states[(size_t)current_state]; }
+        void change_state(State_Id state);
+        void run();
+        void stop() { running = false; }
 
+        // Calls on_timeout() of the current state after the given time, changing the state cancels it.
+        void set_timeout(ocTime timeout);
+        void clear_timeout();
+};
 
@@ -1,7 +1,6 @@
 #include "Crossing_3_Way_Left.h"
-#include "Normal_Drive.h"
-#include "../../traffic_sign_detection/TrafficSign.h"
 #include "../Driver.h"
+#include "../../traffic_sign_detection/TrafficSign.h"
 
 
 State& Crossing_3_Way_Left::get_instance(){
@@ -9,84 +8,23 @@ State& Crossing_3_Way_Left::get_instance(){
     return singleton;
 }
 
-void Crossing_3_Way_Left::initialize(){
-    if(!is_initialized){
-        member.attach();
-        socket = member.get_socket();
-        logger = member.get_logger();
-        ocPacket sup = ocPacket(ocMessageId::Subscribe_To_Messages);
-        sup.set_sender(ocMemberId::Crossing_3_Way_Left);
-        sup.clear_and_edit()
-            .write(ocMessageId::Traffic_Sign_Detected);
-            //.write(ocMessageId::Object_Found);
-        socket->send_packet(sup);
-
-        is_initialized = true;
-    }
-}
 
 
+/**
+ * This method is used to decide how to pass the crossing from the last traffic sign.
+ * The traffic signs are received by the Statemachine in every state.
+*/
+Decider_Event Crossing_3_Way_Left::on_entry(Statemachine*){
 
-void Crossing_3_Way_Left::on_entry(Statemachine* statemachine){
-    /*
-    Get IPC-hub messages regarding traffic signs;
-    Create array of traffic-signs (types and distances);
-    Array an statemachine->run übergeben;
-    */
-    initialize();
-    ocPacket recv_packet;
-
-    ocPacket deafen = ocPacket(ocMessageId::Deafen_Member);
-    deafen.set_sender(ocMemberId::Crossing_3_Way_Left);
-    deafen.clear_and_edit()
-        .write(ocMemberId::Crossing_3_Way_Left)
-        .write(false);
-    socket->send_packet(deafen);
-
-    bool received_sign_package = false;
-
-    
-    for(int i = 0; i < 10 && !received_sign_package; i++){
-       
-        int result = socket->read_packet(recv_packet, false);
-        ocTime now = ocTime::now();
-
-        if (result < 0) {
-            logger->error("Decider: Crossing_3_Way_Left: Error reading the IPC socket: (%i) %s", errno, strerror(errno));
-        } else {
-            switch (recv_packet.get_message_id()){
-                case ocMessageId::Traffic_Sign_Detected:{
-                    auto reader = recv_packet.read_from_start();
-                    uint16_t rawValue = reader.read<uint16_t>();
-                    distance = reader.read<uint64_t>();
-                    trafficSign = static_cast<TrafficSignType>(rawValue);
-                    received_sign_package = true;
-                } break;
-                
-                default:{
-                    ocMessageId msg_id = recv_packet.get_message_id();
-                    ocMemberId mbr_id = recv_packet.get_sender();
-                    logger->warn("Decider: Crossing_3_Way_Left: Unhandled message_id: %s (0x%x) from sender: %s (%i)", to_string(msg_id), msg_id, to_string(mbr_id), mbr_id);
-                } break;
-            }
-        }
-
-    }
-
-    statemachine->run(nullptr);
-}
-
-
-void Crossing_3_Way_Left::run(Statemachine* statemachine, void* data){
-
-    bool drive_left = false;
+    drive_left = false;
     bool drive_forward = false;
+    bool stop_sign = false;
+
 
-    
     if (distance < 50){ //50cm == width of crossing; If distance larger, than sign is irrelevant for crossing
         switch(trafficSign){
             case TrafficSignType::Stop:
-                Driver::stop(2); //stop for 2s
+                stop_sign = true;
                 break;
             case TrafficSignType::PriorityRoad:
                 drive_forward = true;
@@ -103,55 +41,58 @@ void Crossing_3_Way_Left::run(Statemachine* statemachine, void* data){
         }
         logger->error("Decider: TrafficSign: %s", TrafficSignTypeToString(trafficSign).c_str());
     }
-    
+
 
     if(drive_left && drive_forward){
         drive_left = false;
     }
 
-    /*
-    bool object_found = true;
-    while(object_found){
-        ocPacket recv_packet;
-        int result = socket->read_packet(recv_packet);
-        if (result >= 0) {
-            switch (recv_packet.get_message_id()){
-                case ocMessageId::Object_Found:{
-                    object_found = true;
-                } break;
-                
-                default:{
-                    object_found = false;
-                } break;
-            }
-        }
+    is_stopping = stop_sign;
+    if (is_stopping){
+        Driver::stop(2); //stop for 2s
+        return Decider_Event::None;
     }
-    */
+    return start_driving();
+}
+
 
+
+/**
+ * This method is used to turn left or to leave driving forward to Normal_Drive.
+*/
+Decider_Event Crossing_3_Way_Left::start_driving(){
     if(drive_left){
         Driver::turn_left();
-    } else if (drive_forward){
-        Driver::drive_forward();
-    } else{
-        Driver::drive_forward();
+        return Decider_Event::None;
     }
+    return Decider_Event::Crossing_Passed;
+}
+
 
-    logger->log("Decider: Crossing_3_Way_Left: Changing state from Crossing_3_Way_Left to Normal_Drive");
-    statemachine->change_state(Normal_Drive::get_instance());
+
+Decider_Event Crossing_3_Way_Left::on_packet(Statemachine*, ocPacket& packet){
+    if (is_obstacle(packet)){
+        Driver::abort_maneuver();
+        return Decider_Event::Obstacle;
+    }
+    return Decider_Event::None;
 }
 
 
 
-void Crossing_3_Way_Left::on_exit(Statemachine* statemachine){
-    ocPacket deafen = ocPacket(ocMessageId::Deafen_Member);
-    deafen.set_sender(ocMemberId::Crossing_3_Way_Left);
-    deafen.clear_and_edit()
-        .write(ocMemberId::Crossing_3_Way_Left)
-        .write(true);
-    socket->send_packet(deafen);
+Decider_Event Crossing_3_Way_Left::on_maneuver_done(Statemachine*){
+    if (is_stopping){
+        is_stopping = false;
+        return start_driving();
+    }
+    return Decider_Event::Crossing_Passed;
+}
+
+
 
+void Crossing_3_Way_Left::on_exit(Statemachine*){
     State::distance = 0;
-    State::trafficSign = TrafficSignType::None;    
+    State::trafficSign = TrafficSignType::None;
     logger->error("RESET TrafficSign: %s", TrafficSignTypeToString(trafficSign).c_str());
 
 }
@@ -1,32 +1,24 @@
 #pragma once
-#include "../../common/ocMember.h"
-#include "../../common/ocCar.h"
 #include "State.h"
-#include "../Statemachine.h"
-#include "../Driver.h"
-#include "../../traffic_sign_detection/TrafficSign.h"
 
-class ocMember;
-class ocIpcSocket;
 
-class Crossing_3_Way_Right: State {
+class Crossing_3_Way_Right: public State {
     public:
-        static inline bool is_initialized = false;
-
-        static inline ocMember member = ocMember(ocMemberId::Crossing_3_Way_Right, "Crossing_3_Way_Right");
-        static inline ocIpcSocket *socket;
-
-        void run(Statemachine* statemachine, void* data);
-        void on_entry(Statemachine* statemachine);
-        void on_exit(Statemachine* statemachine);
+        const char* get_name() const override { return "Crossing_3_Way_Right"; }
+        Decider_Event on_entry(Statemachine* statemachine) override;
+        Decider_Event on_packet(Statemachine* statemachine, ocPacket& packet) override;
+        Decider_Event on_maneuver_done(Statemachine* statemachine) override;
+        void on_exit(Statemachine* statemachine) override;
         static State& get_instance();
 
 
     private:
-        static inline ocLogger    *logger;
-        static void initialize();
+        bool drive_right = false;
+        // the car waits at a stop sign before it turns
+        bool is_stopping = false;
+
+        Decider_Event start_driving();
         Crossing_3_Way_Right(){}
         Crossing_3_Way_Right(const Crossing_3_Way_Right& other);
         Crossing_3_Way_Right& operator=(const Crossing_3_Way_Right& other);
 };
-
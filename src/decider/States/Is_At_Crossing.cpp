@@ -1,7 +1,4 @@
 #include "Is_At_Crossing.h"
-#include "Crossing_3_Way_Left.h"
-#include "Crossing_3_Way_Right.h"
-#include "Crossing_3_Way_T.h"
 #include "../Driver.h"
 
 
@@ -10,39 +7,12 @@ State& Is_At_Crossing::get_instance(){
     return singleton;
 }
 
-void Is_At_Crossing::initialize(){
-    if(!is_initialized){
-        member.attach();
-        socket = member.get_socket();
-        logger = member.get_logger();
-        //ocPacket sup = ocPacket(ocMessageId::Subscribe_To_Messages);
-        //sup.clear_and_edit()
-        //    .write(ocMessageId::Intersection_Detected);
-        //socket->send_packet(sup);
 
-        is_initialized = true;
-    }
-}
-
-
-
-void Is_At_Crossing::on_entry(Statemachine* statemachine){
-    /*
-    Code
-    */
-   initialize();
 
-   statemachine->run(nullptr);
-}
-
-
-void Is_At_Crossing::run(Statemachine* statemachine, void* data){
-    
-    ocPacket recv_packet;
-    bool crossing_type_received = false; 
-
-    uint8_t crossing_type;
-    State& crossing_state = Crossing_3_Way_Right::get_instance();
+/**
+ * This method is used to stop at the crossing and to pick the crossing state from the type of the crossing.
+*/
+Decider_Event Is_At_Crossing::on_entry(Statemachine*){
 
     Driver::stop();
 
@@ -51,28 +21,13 @@ void Is_At_Crossing::run(Statemachine* statemachine, void* data){
    //4 == front free
     
    
-    if(this->crossing_type & 0b101) {
-        logger->log("Decider: Is_At_Crossing: Changing state from Is_At_Crossing to Crossing_3_Way_Left");
-        statemachine->change_state(Crossing_3_Way_Left::get_instance());
-    } else if(this->crossing_type & 0b110) {
-        logger->log("Decider: Is_At_Crossing: Changing state from Is_At_Crossing to Crossing_3_Way_Right");
-        statemachine->change_state(Crossing_3_Way_Right::get_instance());
-    } else if(this->crossing_type & 0b011) {
-        logger->log("Decider: Is_At_Crossing: Changing state from Is_At_Crossing to Crossing_3_Way_T");
-        statemachine->change_state(Crossing_3_Way_T::get_instance());
-    } else{
-        logger->log("Decider: Is_At_Crossing: No correct crossing detected");
-        statemachine->change_state(crossing_state);
+    if(crossing_type & 0b101) {
+        return Decider_Event::Left_Crossing;
+    } else if(crossing_type & 0b110) {
+        return Decider_Event::Right_Crossing;
+    } else if(crossing_type & 0b011) {
+        return Decider_Event::T_Crossing;
     }
-    
-    
-    
-}
-
-
-
-void Is_At_Crossing::on_exit(Statemachine* statemachine){
-    /*
-    Code
-    */
+    logger->log("Decider: Is_At_Crossing: No correct crossing detected");
+    return Decider_Event::Right_Crossing;
 }
@@ -1,31 +1,16 @@
 #pragma once
-#include "../../common/ocMember.h"
-#include "../../common/ocCar.h"
 #include "State.h"
-#include "../Statemachine.h"
 
-class ocMember;
-class ocIpcSocket;
 
-
-class Is_At_Crossing: State {
+class Is_At_Crossing: public State {
     public:
-        static inline bool is_initialized = false;
-
-        static inline ocMember member = ocMember(ocMemberId::Is_At_Crossing, "Is_At_Crossing");
-        static inline ocIpcSocket *socket;
-
-        void run(Statemachine* statemachine, void* data);
-        void on_entry(Statemachine* statemachine);
-        void on_exit(Statemachine* statemachine);
+        const char* get_name() const override { return "Is_At_Crossing"; }
+        Decider_Event on_entry(Statemachine* statemachine) override;
         static State& get_instance();
 
 
     private:
-        static inline ocLogger    *logger;
-        static void initialize();
         Is_At_Crossing(){}
         Is_At_Crossing(const Is_At_Crossing& other);
         Is_At_Crossing& operator=(const Is_At_Crossing& other);
 };
-
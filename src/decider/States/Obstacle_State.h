@@ -1,31 +1,19 @@
 #pragma once
-#include "../../common/ocMember.h"
-#include "../../common/ocCar.h"
 #include "State.h"
-#include "../Statemachine.h"
 
-class ocMember;
-class ocIpcSocket;
 
-
-class Obstacle_State: State {
+class Obstacle_State: public State {
     public:
-        static inline bool is_initialized = false;
-
-        static inline ocMember member = ocMember(ocMemberId::Obstacle_State, "Obstacle_State");
-        static inline ocIpcSocket *socket;
-        
-        void run(Statemachine* statemachine, void* data);
-        void on_entry(Statemachine* statemachine);
-        void on_exit(Statemachine* statemachine);
+        const char* get_name() const override { return "Obstacle_State"; }
+        Decider_Event on_entry(Statemachine* statemachine) override;
+        Decider_Event on_packet(Statemachine* statemachine, ocPacket& packet) override;
+        Decider_Event on_timeout(Statemachine* statemachine) override;
         static State& get_instance();
 
 
     private:
-        static inline ocLogger    *logger;
-        static void initialize();
         Obstacle_State(){}
         Obstacle_State(const Obstacle_State& other);
         Obstacle_State& operator=(const Obstacle_State& other);
 
-};
\ No newline at end of file
+};
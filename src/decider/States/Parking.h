@@ -1,31 +1,15 @@
 #pragma once
-#include "../../common/ocMember.h"
-#include "../../common/ocCar.h"
 #include "State.h"
-#include "../Statemachine.h"
 
-class ocMember;
-class ocIpcSocket;
 
-
-class Parking: State {
+class Parking: public State {
     public:
-        static inline bool is_initialized = false;
-
-        static inline ocMember member = ocMember(ocMemberId::Parking, "Parking");
-        static inline ocIpcSocket *socket;
-
-        void run(Statemachine* statemachine, void* data);
-        void on_entry(Statemachine* statemachine);
-        void on_exit(Statemachine* statemachine);
+        const char* get_name() const override { return "Parking"; }
         static State& get_instance();
 
 
     private:
-        static inline ocLogger    *logger;
-        static void initialize();
         Parking(){}
         Parking(const Parking& other);
         Parking& operator=(const Parking& other);
 };
-
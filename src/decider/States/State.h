@@ -1,22 +1,57 @@
 #pragma once
-#include "../Statemachine.h"
+#include "../../common/ocLogger.h"
+#include "../../common/ocPacket.h"
 #include <stdint.h>
 #include "../../traffic_sign_detection/TrafficSign.h"
 
 
 class Statemachine;
 
+
+/**
+ * What happened in a state. The Statemachine looks up which state comes next in its transition table.
+*/
+enum class Decider_Event : uint8_t {
+    None,
+    Intersection_Ahead,
+    At_Intersection,
+    Left_Crossing,
+    Right_Crossing,
+    T_Crossing,
+    Crossing_Passed,
+    Obstacle,
+    Obstacle_Gone,
+    Count
+};
+
+
+/**
+ * A state reacts to packets, to the end of a maneuver of the Driver and to its timeout in the Statemachine.
+ * Each of them can return an event to leave the state, Decider_Event::None stays.
+*/
 class State{
     public:
-        virtual void on_entry(Statemachine* statemachine) = 0;
-        virtual void run(Statemachine* statemachine, void *data) = 0;
-        virtual void on_exit(Statemachine* statemachine) = 0;
+        virtual const char* get_name() const = 0;
+        virtual Decider_Event on_entry(Statemachine* statemachine) { (void)statemachine; return Decider_Event::None; }
+        virtual Decider_Event on_packet(Statemachine* statemachine, ocPacket& packet) { (void)statemachine; (void)packet; return Decider_Event::None; }
+        virtual Decider_Event on_maneuver_done(Statemachine* statemachine) { (void)statemachine; return Decider_Event::None; }
+        virtual Decider_Event on_timeout(Statemachine* statemachine) { (void)statemachine; return Decider_Event::None; }
+        virtual void on_exit(Statemachine* statemachine) { (void)statemachine; }
         virtual ~State(){}
-        
+
+        // True for an Object_Found packet with something in the way of the car, the
+        // simulation also reports signs, road markings and parking spaces with it.
+        static bool is_obstacle(const ocPacket& packet) {
+            ocDetectedObject object;
+            if (!packet.read(&object)) return false;
+            return ocObjectType::Pedestrian <= object.object_type && object.object_type <= ocObjectType::Obstacle_Right;
+        }
+
         inline static TrafficSignType trafficSign = TrafficSignType::None;
         inline static uint64_t distance = 0;
+        // what the last intersection looked like, see Is_At_Crossing
+        inline static uint8_t crossing_type = 0;
 
-        
-        uint8_t crossing_type;
+        inline static ocLogger* logger = nullptr;
 };
 
@@ -1,5 +1,7 @@
 #include "../common/ocAlarm.h"
 #include "../common/ocAssert.h"
+#include "../common/ocFramePool.h"
+#include "../common/ocFrameSlot.h"
 #include "../common/ocMember.h"
 #include "../common/ocTime.h"
 #include "../common/ocTypes.h"
@@ -13,6 +15,21 @@
 #include <net/if.h> // IFF_LOOPBACK, IFF_BROADCAST
 #include <netinet/in.h> // sockaddr_storage
 
+// Image_Processing may have been restarted, so the request for the whole
+// BEV is sent again after this many frames.
+#define BEV_REGION_RESEND_FRAMES 100
+
+// Image_Processing only renders the parts of a BEV that others ask for, but
+// the debugger gets to see all of it.
+static void request_whole_bev(ocIpcSocket *ipc_socket, ocBevViewId view)
+{
+    ocPacket packet(ocMessageId::Bev_Region_Request, ocMemberId::Eth_Gateway);
+    packet.clear_and_edit()
+        .write(view)
+        .write<uint32_t>(OC_BEV_WHOLE_VIEW);
+    ipc_socket->send_packet(packet);
+}
+
 static bool get_lan_addr(sockaddr_storage *lan_addr)
 {
     // TODO: we could have multiple LAN IPs and should launch broadcast and debugger servers for all of them
@@ -74,6 +91,8 @@ int main()
     }
 
     ocPacket ipc_packet(ocMessageId::None);
+    ocPacket timing_request_packet(ocMessageId::Request_Timing_Sites, ocMemberId::Eth_Gateway);
+    ocPacket timing_events_packet(ocMessageId::Timing_Events, ocMemberId::Eth_Gateway);
 
     ocDebuggerServer  _dbs((sockaddr *)&lan_addr, ipc_socket);
     ocBroadcastServer _bcs((sockaddr *)&lan_addr);
@@ -132,16 +151,18 @@ int main()
                 {
                     case ocMessageId::Camera_Image_Available:
                     {
-                        const ocCamData *cam_data = &shared_memory->cam_data[shared_memory->last_written_cam_data_index];
-                        uint32_t current_number = cam_data->frame_number;
+                        ocFrameHandle frame_handle = reader.skip<ocTime>().skip<uint32_t>().read<ocFrameHandle>();
+                        // The image is compressed straight out of the frame
+                        // pool, the lease keeps it from being reused.
+                        ocFrameLease cam_frame = member.lease_frame(frame_handle);
+                        if (!cam_frame) break;
                         _dbs.log_image(
                             ocImageType::Cam,
-                            cam_data->img_buffer,
-                            cam_data->width,
-                            cam_data->height,
-                            cam_data->pixel_format,
-                            cam_data->frame_number);
-                        oc_assert(current_number == cam_data->frame_number);
+                            cam_frame.get_data(),
+                            cam_frame->width,
+                            cam_frame->height,
+                            cam_frame->pixel_format,
+                            cam_frame->frame_number);
                     } break;
                     case ocMessageId::Can_Frame_Transmitted:
                     {
@@ -171,7 +192,18 @@ int main()
                     } break;
                     case ocMessageId::Birdseye_Image_Available:
                     {
-                        const ocBevData *bev_data = &shared_memory->bev_data[shared_memory->last_written_bev_data_index];
+                        // Slots 0 and 1 are the lane view, 2 and 3 the
+                        // intersection view.
+                        uint32_t index = get_published_frame_index(shared_memory->last_written_bev_data_index);
+                        static uint32_t frames_since_request = BEV_REGION_RESEND_FRAMES;
+                        if (BEV_REGION_RESEND_FRAMES <= frames_since_request++)
+                        {
+                            request_whole_bev(ipc_socket, index < 2 ? ocBevViewId::Lane : ocBevViewId::Intersection);
+                            frames_since_request = 1;
+                        }
+                        const ocBevData *bev_data = &shared_memory->bev_data[index];
+                        uint32_t sequence = begin_frame_read(bev_data->sequence);
+                        if (sequence & 1) break;
                         _dbs.log_image(
                             ocImageType::Bev,
                             bev_data->img_buffer,
@@ -179,6 +211,10 @@ int main()
                             (uint32_t)(bev_data->max_map_y - bev_data->min_map_y),
                             ocPixelFormat::Gray_U8,
                             bev_data->frame_number);
+                        if (!end_frame_read(bev_data->sequence, sequence))
+                        {
+                            logger->warn("BEV frame %u was overwritten while sending it.", bev_data->frame_number);
+                        }
                     } break;
                     case ocMessageId::Member_List:
                     {
@@ -252,7 +288,8 @@ int main()
                     } break;
                     case ocMessageId::Object_Found:
                     {
-                        ocDetectedObject detected_obj = reader.read<ocDetectedObject>();
+                        ocDetectedObject detected_obj;
+                        if (!ipc_packet.read(&detected_obj)) break;
                         _dbs.log_detected_object(detected_obj.object_type);
                     } break;
                     case ocMessageId::Imu_Rotation_Quaternion:
@@ -284,24 +321,29 @@ int main()
 
         NEXT_TIMED_BLOCK("handle timing data");
 
+        // both packets go out together with a single syscall
+        const ocPacket *outgoing[2];
+        size_t outgoing_count = 0;
+
         // once every 3 seconds send out a request for timing sites
         if (timing_sites_timer.is_expired())
         {
-            ipc_packet.set_message_id(ocMessageId::Request_Timing_Sites);
-            ipc_packet.set_sender(ocMemberId::Eth_Gateway);
-            ipc_packet.clear();
-            ipc_socket->send_packet(ipc_packet);
+            timing_request_packet.clear();
+            outgoing[outgoing_count++] = &timing_request_packet;
         }
 
         if (40 < timing_event_count())
         {
           TIMED_BLOCK("Send timing data");
-          ipc_packet.set_message_id(ocMessageId::Timing_Events);
-          ipc_packet.set_sender(ocMemberId::Eth_Gateway);
-          if (write_timing_events_to_buffer(ipc_packet.get_payload()))
+          if (write_timing_events_to_buffer(timing_events_packet.get_payload()))
           {
-              ipc_socket->send_packet(ipc_packet);
+              outgoing[outgoing_count++] = &timing_events_packet;
           }
         }
+
+        if (0 < outgoing_count)
+        {
+            ipc_socket->send_batch(outgoing, outgoing_count);
+        }
     }
 }
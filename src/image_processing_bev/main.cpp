@@ -1,9 +1,21 @@
 #include "../common/ocTypes.h"
+#include "../common/ocArgumentParser.h"
+#include "../common/ocBevEngine.h"
+#include "../common/ocFramePool.h"
+#include "../common/ocFrameSlot.h"
+#include "../common/ocHistogram.h"
 #include "../common/ocMember.h"
+#include "../common/ocPollEngine.h"
+#include "../common/ocProfiler.h"
+#include "../common/ocWorkerPool.h"
 #include <signal.h>
 #include <csignal>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/types.hpp>
+#include <thread>
 
 // uncomment to use on systems that have no CUDA
 // #define FORBID_CUDA
@@ -28,8 +40,6 @@ using cv::Point2f;
 using cv::Mat;
 using cv::Point;
 
-using cv::Size_;
-
 static bool running = true;
 ocLogger *logger;
 
@@ -40,7 +50,32 @@ Mat M_lane_detection;
 Mat M_intersection_detection;
 
 static constexpr auto BLUR_SIZE = 7;
-static constexpr auto POST_CANNY_BLUE_SIZE = 9;
+// frames between two log lines with the stage latencies
+static constexpr uint32_t LATENCY_REPORT_FRAMES = 100;
+
+// Latencies of the stages a camera frame goes through here, in ms. Waiting
+// is from the exposure until the frame is picked up, publishing is from the
+// end of rendering until the other members were told.
+struct ocStageLatencies final
+{
+    ocHistogram wait{0.1f, 1000};
+    ocHistogram render{0.1f, 1000};
+    ocHistogram publish{0.1f, 1000};
+    ocHistogram since_capture{0.1f, 1000};
+
+    void log_and_clear() {
+        auto log_stage = [](const char *name, ocHistogram &stage) {
+            logger->log("%s latency of %llu frames: mean %.1f ms, p50 %.1f ms, p99 %.1f ms, max %.1f ms",
+                name, (unsigned long long)stage.get_count(), stage.get_mean(),
+                stage.get_percentile(0.5f), stage.get_percentile(0.99f), stage.get_max());
+            stage.clear();
+        };
+        log_stage("Wait", wait);
+        log_stage("Render", render);
+        log_stage("Publish", publish);
+        log_stage("Capture to publish", since_capture);
+    }
+};
 
 static void signal_handler(int)
 {
@@ -68,16 +103,53 @@ void initializeTransformParams() {
     M_intersection_detection = getPerspectiveTransform(src_vertices_intersection_detection, dst_vertices);
 }
 
-void toBirdsEyeView(Mat &src, Mat &dst, Mat &transofmation) {
-    warpPerspective(src, dst, transofmation, dst.size());
+static void set_bev_info(ocBevData *bev_data, ocTime frame_time, uint32_t frame_number) {
+    bev_data->frame_time   = frame_time;
+    bev_data->frame_number = frame_number;
+    bev_data->min_map_x    = 0;
+    bev_data->max_map_x    = 400;
+    bev_data->min_map_y    = 0;
+    bev_data->max_map_y    = 400;
+}
+
+// Region of a view one member asked for with Bev_Region_Request.
+struct ocRegionRequest final
+{
+    ocMemberId             member;
+    bool                   whole_view;
+    std::vector<ocBevSpan> spans;
+};
+
+// Restricts the view to what the members asked for together. A request
+// without spans is removed. Members that read the whole image, like the
+// video recorder and the Ethernet gateway, ask for the whole view, which then
+// isn't restricted at all. So is a view nobody asked for anything of.
+static void update_region(ocBevEngine &bev, ocBevViewId view, std::vector<ocRegionRequest> &requests, ocMemberId member, bool whole_view, std::vector<ocBevSpan> spans) {
+    auto request = std::find_if(requests.begin(), requests.end(), [&](const ocRegionRequest &r) { return r.member == member; });
+    if (request != requests.end() && request->whole_view == whole_view && request->spans.size() == spans.size() &&
+        0 == memcmp(request->spans.data(), spans.data(), spans.size() * sizeof(ocBevSpan))) {
+        return;
+    }
+    if (request != requests.end()) requests.erase(request);
+    if (whole_view || !spans.empty()) requests.push_back({member, whole_view, std::move(spans)});
+
+    bool restricted = !requests.empty();
+    std::vector<ocBevSpan> region;
+    for (const ocRegionRequest &r : requests) {
+        if (r.whole_view) restricted = false;
+        region.insert(region.end(), r.spans.begin(), r.spans.end());
+    }
+    if (!restricted) region.clear();
+    bev.set_region((uint32_t)view, region.data(), region.size());
+    logger->log("The %s view is restricted to %zu spans, %zu pixels are rendered.",
+        ocBevViewId::Lane == view ? "lane" : "intersection", region.size(), bev.get_rendered_pixel_count((uint32_t)view));
 }
 
-int main() {
+int main(int argc, const char** argv) {
     // Catch some signals to allow us to gracefully shut down the process
     signal(SIGINT, signal_handler);
     signal(SIGQUIT, signal_handler);
     signal(SIGTERM, signal_handler);
-    
 
     ocMember member(ocMemberId::Image_Processing, "Image_Processing");
     member.attach();
@@ -85,18 +157,49 @@ int main() {
     ocIpcSocket *socket = member.get_socket();
     logger = member.get_logger();
     ocSharedMemory *shared_memory = member.get_shared_memory();
+    if (!member.get_frame_pool()) return -1;
 
     ocPacket ipc_packet;
     ipc_packet.set_message_id(ocMessageId::Subscribe_To_Messages);
     ipc_packet.clear_and_edit()
-        .write(ocMessageId::Camera_Image_Available);
+        .write(ocMessageId::Camera_Image_Available)
+        .write(ocMessageId::Bev_Region_Request)
+        .write(ocMessageId::Request_Timing_Sites);
     socket->send_packet(ipc_packet);
 
     initializeTransformParams();
 
+    // The sign detection runs next to us on the car. One core is left for the
+    // other processes and the rest is split between the two of us, we get the
+    // rounded up half. --threads N overrides that, N counts this thread too.
+    uint32_t thread_count = 0;
+    ocArgumentParser arg_parser(argc, argv);
+    if (!arg_parser.get_uint32("--threads", &thread_count) || !thread_count) {
+        uint32_t core_count = std::max(1u, std::thread::hardware_concurrency());
+        thread_count = std::max(1u, core_count / 2);
+    }
+    ocWorkerPool workers(thread_count - 1);
+    logger->log("Rendering images on %u threads.", workers.get_concurrency());
+
+    // The perspective points are measured in a 400x400 camera image. Both
+    // views are sampled straight from the full camera frame instead.
+    ocBevEngine bev(400.0f, 400.0f);
+    Mat lane_inverse = M_lane_detection.inv();
+    Mat intersection_inverse = M_intersection_detection.inv();
+    bev.add_view(lane_inverse.ptr<double>(), 400, 400, BLUR_SIZE);
+    bev.add_view(intersection_inverse.ptr<double>(), 400, 400, BLUR_SIZE);
+    std::vector<ocRegionRequest> region_requests[2];
+
+    ocStageLatencies latencies;
+
+    ocPollEngine pe(1);
+    pe.add_fd(socket->get_fd());
+
     // Listen for Camera Image Available Message on IPC
 
     while(running) {
+        pe.await(ocTime::milliseconds(100));
+
         int32_t socket_status;
         while (0 < (socket_status = socket->read_packet(ipc_packet, false)))
         {
@@ -104,82 +207,63 @@ int main() {
                 {
                     case ocMessageId::Camera_Image_Available:
                     {
-                        static uint8_t write_bit = 1;
-                        write_bit ^= 1;
-
-                        // Move to shared memory
-
+                        TIMED_BLOCK("Camera Image Available");
                         ocTime frameTime;
                         uint32_t frameNumber;
-                        ptrdiff_t memoryAdressOffset;
-                        size_t dataSize;
+                        ocFrameHandle frameHandle;
 
                         ipc_packet.read_from_start()
                             .read<ocTime>(&frameTime)
                             .read<uint32_t>(&frameNumber)
-                            .read<ptrdiff_t>(&memoryAdressOffset)
-                            .read<size_t>(&dataSize);
-
-                        ocCamData *tempCamData = &shared_memory->cam_data[shared_memory->last_written_cam_data_index];
-
-                        shared_memory->bev_data[0] = (ocBevData) {
-                            tempCamData->frame_time,
-                            tempCamData->frame_number,
-                            0,(int32_t) 400,
-                            0,(int32_t) 400,
-                            {}
-                        };
-
-                        shared_memory->bev_data[2 | write_bit] = (ocBevData) {
-                            tempCamData->frame_time,
-                            tempCamData->frame_number,
-                            0,(int32_t) 400,
-                            0,(int32_t) 400,
-                            {}
-                        };
-
-                        // TODO: Consider changing the internal implementation to use
-                        // OpenCV. Currently it's a single threaded loop! Convert img
-                        // Convert img from color to bw
-                        convert_to_gray_u8(tempCamData->pixel_format, tempCamData->img_buffer, tempCamData->width, tempCamData->height, shared_memory->bev_data[0].img_buffer, 400, 400);
-
-                        shared_memory->last_written_bev_data_index = VIDEO_OUTPUT;
+                            .read<ocFrameHandle>(&frameHandle);
+
+                        // If we fell behind, the announced frame may already
+                        // be gone, the newest one is just as good then.
+                        ocFrameLease cam_frame = member.lease_frame(frameHandle);
+                        if (!cam_frame) cam_frame = member.lease_latest_frame(ocImageType::Cam);
+                        if (!cam_frame)
+                        {
+                            logger->warn("Camera frame %u is not in the frame pool anymore, skipping it.", frameNumber);
+                            break;
+                        }
+                        ocTime frame_time = cam_frame->frame_time;
+                        uint32_t frame_number = cam_frame->frame_number;
+                        ocTime render_begin = ocTime::now();
 
-                        // Apply birds eye view
-
-                        Mat src(400, 400, CV_8UC1, shared_memory->bev_data[0].img_buffer);
-
-                        if(std::getenv("CAR_ENV") != NULL) {
-                            cv::imwrite("cam_image.jpg", src);
-                        } 
-
-                        Mat dst_lane(400, 400, CV_8UC1, shared_memory->bev_data[0].img_buffer);
-                        Mat dst_intersection(400, 400, CV_8UC1, shared_memory->bev_data[2 | write_bit].img_buffer);
-
-                        //cv::Mat camera_matrix = (cv::Mat_<double>(3, 3) << 300, 0, src.cols / 2,
-                          //                             0, 300, src.rows / 2,
-                           //                            0, 0, 1);
-
-                        // Anpassung der Verzerrungskoeffizienten für mehr zentrale Verzerrung
-                        //cv::Mat dist_coeffs = (cv::Mat_<double>(1, 5) << 1.0, -0.5, 0.0, 0.0, 0.0); // Erhöhte Werte für stärkere Verzerrung
-
-                        //cv::Mat new_camera_matrix = getOptimalNewCameraMatrix(camera_matrix, dist_coeffs, cv::Size(400, 400), 1, cv::Size(400, 400));
-
-                        //cv::undistort(src, dst_intersection, camera_matrix, dist_coeffs, new_camera_matrix);
-
-                        // intersection needs to be calculated first since lane writes to itself!
-                        toBirdsEyeView(src, dst_intersection, M_intersection_detection);
-                        toBirdsEyeView(src, dst_lane, M_lane_detection);
+                        static uint8_t write_bit = 1;
+                        write_bit ^= 1;
+                        ocBevData *lane_bev_data = &shared_memory->bev_data[0];
+                        ocBevData *intersection_bev_data = &shared_memory->bev_data[2 | write_bit];
+                        begin_frame_write(lane_bev_data->sequence);
+                        begin_frame_write(intersection_bev_data->sequence);
+                        set_bev_info(lane_bev_data, frame_time, frame_number);
+                        set_bev_info(intersection_bev_data, frame_time, frame_number);
+
+                        // Convert to gray, apply birds eye view and blur in one go.
+                        // Both views are rendered concurrently in bands of rows.
+                        // The edges of the intersection view are found by
+                        // intersection_detection itself.
+                        BEGIN_TIMED_BLOCK("Render BEV");
+                        uint8_t *const outputs[] = {lane_bev_data->img_buffer, intersection_bev_data->img_buffer};
+                        ocPixelFormat pixel_format = cam_frame->pixel_format;
+                        bool rendered = bev.render(pixel_format, cam_frame.get_data(), cam_frame->width, cam_frame->height, outputs, &workers);
+                        cam_frame.release();
+                        END_TIMED_BLOCK();
+                        ocTime render_end = ocTime::now();
+
+                        end_frame_write(lane_bev_data->sequence);
+                        end_frame_write(intersection_bev_data->sequence);
+                        if (!rendered)
+                        {
+                            logger->warn("Unsupported camera pixel format %i, skipping the frame.", (int)pixel_format);
+                            break;
+                        }
+                        publish_frame_index(shared_memory->last_written_bev_data_index, VIDEO_OUTPUT);
 
-                        GaussianBlur(dst_lane, dst_lane, Size_(BLUR_SIZE, BLUR_SIZE), 0);
                         if(std::getenv("CAR_ENV") != NULL) {
-                            cv::imwrite("cam_image_gaussian.jpg", dst_lane);
+                            cv::imwrite("cam_image_gaussian.jpg", Mat(400, 400, CV_8UC1, lane_bev_data->img_buffer));
                         } 
 
-                        GaussianBlur(dst_intersection, dst_intersection, Size_(BLUR_SIZE, BLUR_SIZE), 0);
-                        Canny(dst_intersection, dst_intersection, 40, 170, 3, true);
-                        GaussianBlur(dst_intersection, dst_intersection, Size_(POST_CANNY_BLUE_SIZE, POST_CANNY_BLUE_SIZE), 0);
-
                         // notify others about available picture
                         ipc_packet.set_sender(ocMemberId::Image_Processing);
                         ipc_packet.set_message_id(ocMessageId::Birdseye_Image_Available);
@@ -197,6 +281,39 @@ int main() {
 
 
 #endif
+                        ocTime published = ocTime::now();
+                        latencies.wait.add((render_begin - frame_time).get_float_milliseconds());
+                        latencies.render.add((render_end - render_begin).get_float_milliseconds());
+                        latencies.publish.add((published - render_end).get_float_milliseconds());
+                        latencies.since_capture.add((published - frame_time).get_float_milliseconds());
+                        if (LATENCY_REPORT_FRAMES <= latencies.since_capture.get_count()) latencies.log_and_clear();
+                    } break;
+                    case ocMessageId::Bev_Region_Request:
+                    {
+                        ocBufferReader reader = ipc_packet.read_from_start();
+                        ocBevViewId view;
+                        uint32_t span_count;
+                        if (!reader.can_read<ocBevViewId, uint32_t>()) break;
+                        reader.read(&view).read(&span_count);
+                        bool whole_view = OC_BEV_WHOLE_VIEW == span_count;
+                        if (whole_view) span_count = 0;
+                        if (ocBevViewId::Intersection < view || reader.available_read_space() != span_count * sizeof(ocBevSpan))
+                        {
+                            logger->warn("Invalid region request from %s, ignoring it.", to_string(ipc_packet.get_sender()));
+                            break;
+                        }
+                        std::vector<ocBevSpan> spans(span_count);
+                        if (0 < span_count) reader.read(spans.data(), span_count * sizeof(ocBevSpan));
+                        update_region(bev, view, region_requests[(size_t)view], ipc_packet.get_sender(), whole_view, std::move(spans));
+                    } break;
+                    case ocMessageId::Request_Timing_Sites:
+                    {
+                        ipc_packet.set_sender(ocMemberId::Image_Processing);
+                        ipc_packet.set_message_id(ocMessageId::Timing_Sites);
+                        if (write_timing_sites_to_buffer(ipc_packet.get_payload()))
+                        {
+                            socket->send_packet(ipc_packet);
+                        }
                     } break;
                     default:
                     {
@@ -206,6 +323,22 @@ int main() {
                     } break;
                 }
         }
+        if (socket_status < 0)
+        {
+            logger->error("Error while reading the IPC socket: (%i) %s", errno, strerror(errno));
+            running = false;
+        }
+
+        // The workers are idle here, so no thread is logging events.
+        if (40 < timing_event_count())
+        {
+            ipc_packet.set_sender(ocMemberId::Image_Processing);
+            ipc_packet.set_message_id(ocMessageId::Timing_Events);
+            while (write_timing_events_to_buffer(ipc_packet.get_payload()))
+            {
+                socket->send_packet(ipc_packet);
+            }
+        }
     }
 
     return 0;
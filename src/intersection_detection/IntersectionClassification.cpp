@@ -63,7 +63,7 @@ bool IntersectionPostprocessing::calculate_result() {
     possibilities |= this->test_left();
     possibilities |= this->test_right();
 
-    // if all directions are free it's most likely that canny didn't output the line furthest away
+    // if all directions are free it's most likely that the edge detection missed the line furthest away
     if (std::popcount(possibilities) == 3) {
         possibilities &= ~(0b100);
     } else if (std::popcount(possibilities) == 1) {
@@ -1,22 +1,19 @@
 #include "../common/ocTypes.h"
+#include "../common/ocFrameSlot.h"
 #include "../common/ocMember.h"
+#include "../common/ocSegmentDetector.h"
 #include "Histogram.h"
 #include "IntersectionConstants.h"
 #include "IntersectionClassification.h"
 #include <signal.h>
 #include <csignal>
+#include <algorithm>
 #include <bit>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/types.hpp>
 
-using cv::Point2f;
-using cv::Rect;
-using cv::Point;
 using cv::Mat;
 
-using cv::RETR_LIST;
-using cv::CHAIN_APPROX_NONE;
-
 using std::vector;
 
 //#define LOG_NEGATIVE_RESULTS
@@ -33,68 +30,30 @@ static void signal_handler(int)
     std::cout << "Links: " << (directions & 1 ? "true" : "false") << "; Rechts: " << (directions & 2 ? "true" : "false") << "; Geradeaus: " << (directions & 4 ? "true" : "false") << std::endl;
 }
 
-static uint32_t distance_between_points_indexed(const vector<Point> &points, size_t &start_index) {
-    assert(start_index < points.size() - 1);
-    const Point &p1 = points.at(start_index);
-    const Point &p2 = points.at(start_index + 1);
-    return (uint32_t) cv::norm(p1 - p2);
+// 0° means horizontal, 90° vertical
+static size_t angle_index(const ocLineSegment &segment) {
+    return std::min((size_t) segment.angle, INTERSECTION_DEGREE_SIZE - 1);
 }
 
-static uint32_t calculate_angle_indexed(const vector<Point> &points, size_t &start_index) {
-    assert(start_index < points.size() - 1);
-    const Point &p1 = points.at(start_index);
-    const Point &p2 = points.at(start_index + 1);
-    Point pos = p2 - p1;
-    double rad = atan2(pos.y, pos.x) - 0.5 * CV_PI;
-    if (rad < 0) {
-        rad += 2 * CV_PI;
+static void generate_angle_length_histogram(Histogram<INTERSECTION_DEGREE_SIZE> &histogram, const ocSegmentDetector &detector) {
+    const ocLineSegment *segments = detector.get_segments();
+    for (uint32_t i = 0; i < detector.get_segment_count(); ++i) {
+        histogram.add_to_index(angle_index(segments[i]), (uint32_t) segments[i].length);
     }
-    double degree = rad * (180 / CV_PI);
-    // 0° means pointing left, 90° means upward and 180° means pointing right
-    return (uint32_t)(((int) degree + 90) % 180);
 }
 
-static void generate_angle_length_histogram(Histogram<INTERSECTION_DEGREE_SIZE> &histogram, const vector<vector<Point>> &input_data) {
-    for (const vector<Point> &points : input_data) {
-        for (size_t i = 0; i < points.size() - 1; ++i) {
-            uint32_t degree_adjusted = calculate_angle_indexed(points, i);
-            uint32_t distance = distance_between_points_indexed(points, i);
-            histogram.add_to_index(degree_adjusted, distance);
+static void generate_filtered_histogram(Histogram<INTERSECTION_Y_LENGTH_SIZE> &histogram, const ocSegmentDetector &detector) {
+    const ocLineSegment *segments = detector.get_segments();
+    for (uint32_t i = 0; i < detector.get_segment_count(); ++i) {
+        const ocLineSegment &segment = segments[i];
+        size_t degree = angle_index(segment);
+        if (degree < ALLOWED_DEGREE_RANGE || degree > 180 - ALLOWED_DEGREE_RANGE) {
+            size_t mid = std::min((size_t) (0.5f * (segment.y1 + segment.y2)), INTERSECTION_Y_LENGTH_SIZE - 1);
+            histogram.add_to_index(mid, (uint32_t) segment.length);
         }
     }
 }
 
-static void generate_filtered_histogram(Histogram<INTERSECTION_Y_LENGTH_SIZE> &histogram, const vector<vector<Point>> &input_data) {
-    for (auto &points : input_data) {
-        for (size_t i = 0; i < points.size() - 1; ++i) {
-            uint32_t degree_adjusted = calculate_angle_indexed(points, i);
-            if (degree_adjusted < ALLOWED_DEGREE_RANGE || degree_adjusted > 180 - ALLOWED_DEGREE_RANGE) {
-                uint32_t distance = distance_between_points_indexed(points, i);
-                size_t mid = ((size_t)points.at(i).y + (size_t) points.at(i + 1).y) / 2;
-                histogram.add_to_index(mid, distance);
-            }
-        }
-    }
-}
-
-static vector<vector<Point>> detect_lines_in_image(Mat &image) {
-    vector<vector<Point>> contours;
-    findContours(image, contours, RETR_LIST, CHAIN_APPROX_NONE);
-
-    vector<vector<Point>> cleaned_data;
-    for (auto &contour : contours) {
-        double len = cv::arcLength(contour, false);
-        if (len < 30) {
-            continue;
-        }
-        vector<Point> reduced_contour;
-        double epsilon = 0.007 * arcLength(contour, false);
-        approxPolyDP(contour, reduced_contour, epsilon, false);
-        cleaned_data.push_back(reduced_contour);
-    }
-    return cleaned_data;
-}
-
 int main() {
     // Catch some signals to allow us to gracefully shut down the process
     signal(SIGINT, signal_handler);
@@ -115,6 +74,11 @@ int main() {
         .write(ocMessageId::Birdseye_Image_Available);
     socket->send_packet(ipc_packet);
 
+    // The segments and edges of the last image, all of them live as long as
+    // the process.
+    ocSegmentDetector detector(400, 400);
+    Mat image(400, 400, CV_8UC1);
+
     // Listen for detected Lines
     int32_t socket_status;
     while (running && 0 < (socket_status = socket->read_packet(ipc_packet, true)))
@@ -128,11 +92,17 @@ int main() {
                     reader.read(&bit);
                     static uint32_t distance;
                     distance = 0;
-                    Mat image(400, 400, CV_8UC1, shared_memory->bev_data[2 | bit].img_buffer);
-                    vector<vector<Point>> lines = detect_lines_in_image(image);
+                    // The segment detection works on the image for a while, so
+                    // it gets a copy that can't be overwritten.
+                    bool got_frame = read_frame(shared_memory->bev_data[2 | bit], [&](const ocBevData &bev_data)
+                    {
+                        Mat(400, 400, CV_8UC1, (void *)bev_data.img_buffer).copyTo(image);
+                    });
+                    if (!got_frame) break;
+                    detector.detect(image.data);
                     static Histogram<INTERSECTION_DEGREE_SIZE> angle_length_hist;
                     angle_length_hist.clear();
-                    generate_angle_length_histogram(angle_length_hist, lines);
+                    generate_angle_length_histogram(angle_length_hist, detector);
                     angle_length_hist.blur();
                     static uint8_t last_found = 0;
                     last_found <<= 1;
@@ -150,7 +120,7 @@ int main() {
 
                     static Histogram<INTERSECTION_Y_LENGTH_SIZE> histogram_filtered;
                     histogram_filtered.clear();
-                    generate_filtered_histogram(histogram_filtered, lines);
+                    generate_filtered_histogram(histogram_filtered, detector);
                     histogram_filtered.blur();
 
                     // y in bev
@@ -166,7 +136,9 @@ int main() {
                         continue;
                     }
 
-                    IntersectionPostprocessing proc(image, found_line_y);
+                    // the postprocessing looks for lines in the edges
+                    Mat edges(400, 400, CV_8UC1, (void *)detector.get_edges());
+                    IntersectionPostprocessing proc(edges, found_line_y);
                     if (!proc.calculate_result()) {
 #ifdef LOG_NEGATIVE_RESULTS
                         logger->warn("Skipping frame since calculating the result didn't yield the required result");
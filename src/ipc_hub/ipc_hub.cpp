@@ -1,6 +1,7 @@
 #include "ipc_hub.h"
 #include "../common/ocAssert.h"
 #include "../common/ocCommon.h"
+#include "../common/ocMessages.h"
 #include "../common/ocProfiler.h"
 #include "../common/ocTypes.h"
 
@@ -103,8 +104,6 @@ int32_t IpcHub::create_shared_memory()
     _canaries[3].init(&_shared_memory->_canary3, random_uint64());
     _canaries[4].init(&_shared_memory->_canary4, random_uint64());
     _canaries[5].init(&_shared_memory->_canary5, random_uint64());
-    _canaries[6].init(&_shared_memory->_canary6, random_uint64());
-    _canaries[7].init(&_shared_memory->_canary7, random_uint64());
 
     _shared_memory->online_members = (uint16_t) ocMemberId::Ipc_Hub;
 
@@ -112,9 +111,39 @@ int32_t IpcHub::create_shared_memory()
     return EXIT_SUCCESS;
 }
 
+int32_t IpcHub::create_frame_pool(uint32_t slot_count, size_t size)
+{
+    if (0 == slot_count || 0 == size)
+    {
+        _logger.error("The frame pool needs at least one slot and some memory.");
+        return EXIT_FAILURE;
+    }
+
+    size_t memory_size = ocFramePool::memory_size(slot_count, size);
+    _frame_pool_id = shmget(IPC_PRIVATE, memory_size, IPC_CREAT | 0666);
+    if (_frame_pool_id < 0)
+    {
+        _logger.error("Frame pool init failed: (%i) %s", errno, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    void *memory = shmat(_frame_pool_id, nullptr, 0);
+    // Like the rings, the segment goes away once the last process detached.
+    shmctl(_frame_pool_id, IPC_RMID, nullptr);
+    if (((void *)-1) == memory)
+    {
+        _logger.error("Could not attach the frame pool: (%i) %s", errno, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    _frame_pool.init(memory, slot_count, size);
+
+    _logger.log("Created frame pool. Slots: %u Size: %zubytes ID: 0x%x", slot_count, memory_size, _frame_pool_id);
+    return EXIT_SUCCESS;
+}
+
 void IpcHub::check_shared_memory()
 {
-    for (int i = 0; i < 8; ++i)
+    for (int i = 0; i < 6; ++i)
     {
         oc_assert(_canaries[i].check(), i);
     }
@@ -123,8 +152,13 @@ void IpcHub::check_shared_memory()
 /* the main function to process all clients. will listen for incoming packets and forward them to the other clients */
 void IpcHub::process_clients()
 {
-    // block until activity on any socket is detected.
-    _pe.await();
+    // Block until activity on any socket is detected. Full rings don't wake
+    // us up when they have space again, so we have to check back on them.
+    // Producers that were unblocked last cycle need to be read right away.
+    ocTime timeout = ocTime::forever();
+    if (_has_blocked_rings) timeout = ocTime::milliseconds(1);
+    if (_has_pending_reads) timeout = ocTime::null();
+    _pe.await(timeout);
 
     TIMED_BLOCK();
     // check if there was activity on the listen socket which accepts new connections
@@ -142,107 +176,205 @@ void IpcHub::process_clients()
             _handle_auth(new_socket);
     }
 
-    // loop over all connected clients and check if there was activity on their sockets
-    for (auto it = _members_by_id.begin(); it != _members_by_id.end();)
+    // Loop over all connected clients and check if there was activity on their
+    // sockets. Members never get removed while we're in here, broken ones are
+    // collected and disconnected afterwards.
+    for (auto &[member_id, member] : _members_by_id)
     {
-        ocMemberId member_id = it->first;
-        IpcMember* member = it->second;
+        if (member->broken) continue;
+
+        if (0 < member->socket.get_queue_length() &&
+            (member->socket.uses_rings() || _pe.was_triggered(member->socket.get_fd(), ocPollDirection::Write)))
+        {
+            TIMED_BLOCK("flush send queue");
+            if (member->socket.flush_queue() < 0)
+            {
+                _logger.error("Error while sending to member %s (%i): (%i) %s", to_string(member_id), member_id, errno, strerror(errno));
+                _disconnect_later(member);
+                continue;
+            }
+            _update_poll(member);
+        }
+
+        // epoll reports hangups even while we don't read from a blocked
+        // member, which would wake us up on every cycle until it's unblocked.
+        if (ocMemberId::None != member->blocked_by && _pe.was_hung_up(member->socket.get_fd()))
+        {
+            _logger.warn("Member %s (%i) hung up while it was blocked by %s (%i)",
+                to_string(member_id), member_id,
+                to_string(member->blocked_by), member->blocked_by);
+            _disconnect_later(member);
+            continue;
+        }
+
+        bool readable = member->pending_read || _pe.was_triggered(member->socket.get_fd(), ocPollDirection::Read);
+        if (!readable || ocMemberId::None != member->blocked_by) continue;
+        member->pending_read = false;
+
         int32_t status = 0;
-        if (_pe.was_triggered(member->socket.get_fd()))
+        uint32_t packets = 0;
+        uint32_t bytes = 0;
+        member->packets_sent++;
+        // Packets are only looked at in place. With the ring transport that
+        // means they go from one ring into the next without any syscalls.
+        // Reading stops early if a receiver with the Block_Producer policy
+        // can't take any more packets from this member.
+        ocPacketView view;
+        while (!member->broken &&
+               ocMemberId::None == member->blocked_by &&
+               0 < (status = member->socket.peek_packet(view, false))) // read non-blockingly
         {
-            bool disconnect = false;
-            uint32_t packets = 0;
-            uint32_t bytes = 0;
-            member->packets_sent++;
-            while (!disconnect && 0 < (status = member->socket.read_packet(_packet, false))) // read non-blockingly
+            member->last_active_time = ocTime::now();
+            packets += 1;
+            bytes += (uint32_t)status;
+            if (view.get_sender() != member_id)
             {
-                member->last_active_time = ocTime::now();
-                packets += 1;
-                bytes += (uint32_t)status;
-                if (_packet.get_sender() != member_id)
+                if (ocMemberId::None == view.get_sender())
                 {
-                    if (ocMemberId::None == _packet.get_sender())
-                    {
-                        _packet.set_sender(member_id);
-                    }
-                    else
-                    {
-                        _logger.warn("Member %s (%i) sent a packet with different sender id: %s (%i)",
-                            to_string(member_id),
-                            member_id,
-                            to_string(_packet.get_sender()),
-                            _packet.get_sender());
-                    }
+                    view.set_sender(member_id);
+                }
+                else
+                {
+                    _logger.warn("Member %s (%i) sent a packet with different sender id: %s (%i)",
+                        to_string(member_id),
+                        member_id,
+                        to_string(view.get_sender()),
+                        view.get_sender());
                 }
-                switch (_packet.get_message_id())
+            }
+            switch (view.get_message_id())
+            {
+            case ocMessageId::Subscribe_To_Messages:
+            {
+                view.copy_to(_packet);
+                auto reader = _packet.read_from_start();
+                while (reader.can_read<ocMessageId>())
                 {
-                case ocMessageId::Subscribe_To_Messages:
+                    ocMessageId message_id = reader.read<ocMessageId>();
+                    _subscribe(member_id, _default_subscription(member_id, message_id));
+                }
+            } break;
+            case ocMessageId::Subscribe_With_Policy:
+            {
+                view.copy_to(_packet);
+                auto reader = _packet.read_from_start();
+                while (reader.can_read<ocMessageId, ocQueuePolicy, uint16_t>())
                 {
-                    auto reader = _packet.read_from_start();
-                    while (reader.can_read<ocMessageId>())
-                    {
-                        ocMessageId message_id = reader.read<ocMessageId>();
-                        _subscribers_by_message_id[message_id].append(_packet.get_sender());
-                    }
-                } break;
-                case ocMessageId::Deafen_Member:
+                    ocMessageId message_id = reader.read<ocMessageId>();
+                    IpcSubscription subscription = {
+                        .message_id = message_id,
+                        .member_id  = member_id,
+                        .policy     = reader.read<ocQueuePolicy>(),
+                        .limit      = reader.read<uint16_t>()
+                    };
+                    if (0 == subscription.limit) subscription.limit = 1;
+                    _subscribe(member_id, subscription);
+                }
+            } break;
+            case ocMessageId::Deafen_Member:
+            {
+                view.copy_to(_packet);
+                auto reader = _packet.read_from_start();
+                while (reader.can_read<ocMemberId, bool>())
                 {
-                    auto reader = _packet.read_from_start();
-                    while (reader.can_read<ocMemberId, bool>())
+                    ocMemberId id = reader.read<ocMemberId>();
+                    bool value = reader.read<bool>();
+                    if (_members_by_id.find(id) != _members_by_id.end())
                     {
-                        ocMemberId id = reader.read<ocMemberId>();
-                        bool value = reader.read<bool>();
-                        if (_members_by_id.find(id) != _members_by_id.end())
-                        {
-                            _members_by_id[id]->deaf = value;
-                        }
+                        _members_by_id[id]->deaf = value;
                     }
-                } break;
-                case ocMessageId::Mute_Member:
+                }
+            } break;
+            case ocMessageId::Mute_Member:
+            {
+                view.copy_to(_packet);
+                auto reader = _packet.read_from_start();
+                while (reader.can_read<ocMemberId, bool>())
                 {
-                    auto reader = _packet.read_from_start();
-                    while (reader.can_read<ocMemberId, bool>())
+                    ocMemberId id = reader.read<ocMemberId>();
+                    bool value = reader.read<bool>();
+                    if (_members_by_id.find(id) != _members_by_id.end())
                     {
-                        ocMemberId id = reader.read<ocMemberId>();
-                        bool value = reader.read<bool>();
-                        if (_members_by_id.find(id) != _members_by_id.end())
-                        {
-                            _members_by_id[id]->mute = value;
-                        }
+                        _members_by_id[id]->mute = value;
                     }
-                } break;
-                case ocMessageId::Request_Timing_Sites:
+                }
+            } break;
+            case ocMessageId::Request_Timing_Sites:
+            {
+                _distribute(view);
+
+                _packet.set_sender(ocMemberId::Ipc_Hub);
+                _packet.set_message_id(ocMessageId::Timing_Sites);
+                if (write_timing_sites_to_buffer(_packet.get_payload()))
                 {
                     _distribute(_packet);
-
-                    _packet.set_sender(ocMemberId::Ipc_Hub);
-                    _packet.set_message_id(ocMessageId::Timing_Sites);
-                    if (write_timing_sites_to_buffer(_packet.get_payload()))
-                    {
-                        _distribute(_packet);
-                    }
-                } break;
-                case ocMessageId::Disconnect_Me:
+                }
+            } break;
+            case ocMessageId::Disconnect_Me:
+            {
+                _disconnect_later(member);
+            } break;
+            default:
+            {
+                // Registered payloads are read as a whole struct, so one with
+                // the wrong size would be garbage for every receiver.
+                int32_t payload_size = ocRegisteredMessages::payload_size(view.get_message_id());
+                if (0 <= payload_size && (uint32_t)payload_size != view.get_length())
                 {
-                    it = _disconnect_client(member_id);
-                    disconnect = true;
-                } break;
-                default:
+                    _logger.warn("Member %s (%i) sent %s with %u bytes instead of %i, dropping it",
+                        to_string(member_id),
+                        member_id,
+                        to_string(view.get_message_id()),
+                        view.get_length(),
+                        payload_size);
+                    break;
+                }
+                if (IpcPriority::Bulk == _priority(view.get_message_id()))
                 {
-                    _distribute(_packet);
-                } break;
+                    _defer(view);
                 }
+                else
+                {
+                    _distribute(view);
+                }
+            } break;
+            }
+            member->socket.release_packet();
+
+            // A long burst of packets would overflow the timing event
+            // store before we get to the end of this function.
+            if (TIMING_EVENT_STORE_SIZE / 2 < timing_event_count())
+            {
+                _send_timing_events();
             }
-            _add_stats(0, packets, 0, bytes);
         }
+        _add_stats(0, packets, 0, bytes);
+
         if (status < 0)
         {
             _logger.error("Error while receiving from member %s (%i): (%i) %s", to_string(member_id), member_id, errno, strerror(errno));
-            it = _disconnect_client(member_id);
+            _disconnect_later(member);
         }
-        else
+        // Stop listening to a member that is blocked, otherwise epoll would
+        // keep waking us up for packets we're not going to read.
+        if (ocMemberId::None != member->blocked_by) _update_poll(member);
+    }
+
+    // Control packets from all members are queued by now, so the bulk ones
+    // line up behind them.
+    _distribute_deferred();
+
+    _disconnect_broken_members();
+
+    _has_blocked_rings = false;
+    _has_pending_reads = false;
+    for (auto &[member_id, member] : _members_by_id)
+    {
+        if (ocMemberId::None != member->blocked_by) _try_unblock(member);
+        if (member->pending_read) _has_pending_reads = true;
+        if (member->socket.uses_rings() && 0 < member->socket.get_queue_length())
         {
-            ++it;
+            _has_blocked_rings = true;
         }
     }
 
@@ -250,64 +382,302 @@ void IpcHub::process_clients()
 
     if (40 < timing_event_count())
     {
-        TIMED_BLOCK("Send timing data");
-        _packet.set_sender(ocMemberId::Ipc_Hub);
-        _packet.set_message_id(ocMessageId::Timing_Events);
-        if (write_timing_events_to_buffer(_packet.get_payload()))
+        _send_timing_events();
+    }
+}
+
+void IpcHub::_update_poll(IpcMember *member)
+{
+    // Rings never block the socket, they get retried on every cycle instead.
+    bool want_writes = !member->socket.uses_rings() && 0 < member->socket.get_queue_length();
+    bool want_reads = ocMemberId::None == member->blocked_by;
+    if (want_writes == member->watching_writes && want_reads == member->watching_reads) return;
+
+    auto direction = ocPollDirection::None;
+    if (want_reads && want_writes) direction = ocPollDirection::Read_Write;
+    else if (want_reads)           direction = ocPollDirection::Read;
+    else if (want_writes)          direction = ocPollDirection::Write;
+    _pe.modify_fd(member->socket.get_fd(), direction);
+    member->watching_writes = want_writes;
+    member->watching_reads = want_reads;
+}
+
+void IpcHub::_try_unblock(IpcMember *member)
+{
+    auto it = _members_by_id.find(member->blocked_by);
+    if (_members_by_id.end() != it)
+    {
+        IpcMember *receiver = it->second;
+        size_t depth = receiver->socket.get_queue_length(member->blocked_message_id);
+        if (!receiver->broken && member->blocked_limit <= depth) return;
+    }
+    member->blocked_by = ocMemberId::None;
+    // A ring doesn't ring the doorbell again for packets that are already in
+    // it, so we have to go and look ourselves.
+    member->pending_read = true;
+    _update_poll(member);
+}
+
+bool IpcHub::_would_deadlock(ocMemberId sender_id, ocMemberId receiver_id)
+{
+    // Every member is blocked by at most one other, so this is a chain. It
+    // can't loop, because no link that would close a loop is ever added.
+    ocMemberId id = receiver_id;
+    while (ocMemberId::None != id)
+    {
+        if (sender_id == id) return true;
+        auto it = _members_by_id.find(id);
+        if (_members_by_id.end() == it) return false;
+        id = it->second->blocked_by;
+    }
+    return false;
+}
+
+IpcSubscription IpcHub::_default_subscription(ocMemberId member_id, ocMessageId message_id)
+{
+    IpcSubscription subscription = {
+        .message_id = message_id,
+        .member_id  = member_id,
+        .policy     = ocQueuePolicy::Fifo,
+        .limit      = 64
+    };
+    switch (message_id)
+    {
+    // Notifications about the newest state of something. Nobody cares about
+    // old ones once a newer one is there.
+    case ocMessageId::Camera_Image_Available:
+    case ocMessageId::Binary_Image_Available:
+    case ocMessageId::Birdseye_Image_Available:
+    case ocMessageId::Lines_Available:
+    case ocMessageId::Lane_Detection_Values:
+    case ocMessageId::Ipc_Stats:
+    case ocMessageId::Imu_Rotation_Euler:
+    case ocMessageId::Imu_Rotation_Gyro:
+    case ocMessageId::Imu_Linear_Acceleration:
+    case ocMessageId::Imu_Rotation_Quaternion:
+    case ocMessageId::Shapes:
+    case ocMessageId::Approach_Point:
+    {
+        subscription.policy = ocQueuePolicy::Keep_Latest;
+        subscription.limit = 1;
+    } break;
+    // Control messages must never get lost.
+    case ocMessageId::Member_List:
+    case ocMessageId::Set_Lights:
+    case ocMessageId::Start_Driving_Task:
+    case ocMessageId::Ai_Switched_State:
+    case ocMessageId::Driving_Task_Finished:
+    case ocMessageId::Rc_State_Changed:
+    case ocMessageId::Set_Camera_Parameter:
+    case ocMessageId::Deafen_Member:
+    case ocMessageId::Mute_Member:
+    {
+        subscription.policy = ocQueuePolicy::Block_Producer;
+        subscription.limit = 16;
+    } break;
+    default: break;
+    }
+    return subscription;
+}
+
+IpcPriority IpcHub::_priority(ocMessageId message_id)
+{
+    switch (message_id)
+    {
+    // Driving commands and everything that should make the car stop.
+    case ocMessageId::Start_Driving_Task:
+    case ocMessageId::Send_Can_Frame:
+    case ocMessageId::Object_Found:
+    case ocMessageId::Rc_State_Changed:
+        return IpcPriority::Control;
+    // Large or frequent packets that nobody has to react to right away.
+    case ocMessageId::Timing_Sites:
+    case ocMessageId::Timing_Events:
+    case ocMessageId::Shapes:
+    case ocMessageId::Ipc_Stats:
+    case ocMessageId::Camera_Image_Available:
+    case ocMessageId::Binary_Image_Available:
+    case ocMessageId::Birdseye_Image_Available:
+        return IpcPriority::Bulk;
+    default:
+        return IpcPriority::Normal;
+    }
+}
+
+void IpcHub::_subscribe(ocMemberId member_id, const IpcSubscription &subscription)
+{
+    // subscribing again only updates the policy
+    for (IpcSubscription &existing : _subscribers_by_message_id[subscription.message_id])
+    {
+        if (existing.member_id == member_id)
         {
-            _distribute(_packet);
+            existing = subscription;
+            return;
         }
     }
+    _subscribers_by_message_id[subscription.message_id].append(subscription);
+}
+
+void IpcHub::_send_timing_events()
+{
+    TIMED_BLOCK("Send timing data");
+    _packet.set_sender(ocMemberId::Ipc_Hub);
+    _packet.set_message_id(ocMessageId::Timing_Events);
+    if (write_timing_events_to_buffer(_packet.get_payload()))
+    {
+        _distribute(_packet);
+    }
 }
 
 /* distribute a received packet to all receivers */
 void IpcHub::_distribute(const ocPacket& packet)
+{
+    _distribute(ocPacketView(packet));
+}
+
+void IpcHub::_distribute(const ocPacketView& packet)
+{
+    // The packet is copied into a frame once, all receivers share that copy.
+    // Nobody listening means there is nothing to copy.
+    if (0 == _subscribers_by_message_id[packet.get_message_id()].get_length()) return;
+    ocIpcFrame *frame = ocIpcFrame::create(packet);
+    _distribute(frame);
+    frame->release();
+}
+
+void IpcHub::_defer(const ocPacketView& packet)
+{
+    if (0 == _subscribers_by_message_id[packet.get_message_id()].get_length()) return;
+    _deferred_frames.append(ocIpcFrame::create(packet));
+}
+
+void IpcHub::_distribute_deferred()
+{
+    for (size_t i = 0; i < _deferred_frames.get_length(); ++i)
+    {
+        _distribute(_deferred_frames[i]);
+        _deferred_frames[i]->release();
+    }
+    _deferred_frames.clear();
+}
+
+void IpcHub::_distribute(ocIpcFrame *frame)
 {
     TIMED_BLOCK();
 
     uint32_t packets = 0;
     uint32_t bytes = 0;
 
-    ocMemberId sender_id = packet.get_sender();
-    if (_members_by_id.contains(sender_id) &&
-        _members_by_id[sender_id]->mute) return;
+    ocMemberId sender_id = frame->get_sender();
+    IpcMember *sender = nullptr;
+    if (_members_by_id.contains(sender_id))
+    {
+        sender = _members_by_id[sender_id];
+        if (sender->mute) return;
+    }
 
-    ocMessageId message_id = packet.get_message_id();
-    for (ocMemberId receiver_id : _subscribers_by_message_id[message_id])
+    ocMessageId message_id = frame->get_message_id();
+    bool urgent = IpcPriority::Control == _priority(message_id);
+    for (const IpcSubscription &subscription : _subscribers_by_message_id[message_id])
     {
+        ocMemberId receiver_id = subscription.member_id;
         oc_assert(_members_by_id.contains(receiver_id));
 
         IpcMember *receiver = _members_by_id[receiver_id];
-        if (!receiver->deaf)
+        if (receiver->deaf || receiver->broken) continue;
+
+        size_t depth = receiver->socket.get_queue_length(message_id);
+        // The limit of the whole queue holds for every policy, even for
+        // packets that can't be held back by blocking their sender.
+        bool queue_at_limit = OC_IPC_SEND_QUEUE_LIMIT <= receiver->socket.get_queue_length();
+        bool queue_full = queue_at_limit || subscription.limit <= depth;
+
+        if (queue_full)
         {
-            int32_t result = receiver->socket.send_packet(packet, false);
-            if (result == 0)
+            // Blocking the sender can't make room once the whole queue is at
+            // its limit, so the packet gets dropped like with Fifo.
+            ocQueuePolicy policy = subscription.policy;
+            if (ocQueuePolicy::Block_Producer == policy && queue_at_limit) policy = ocQueuePolicy::Fifo;
+            switch (policy)
+            {
+            case ocQueuePolicy::Keep_Latest:
             {
+                // The new packet takes the place of the newest queued one of
+                // this message, so the receiver gets the latest one where
+                // the one it replaces would have been.
+                if (receiver->socket.replace_queued_frame(frame))
+                {
+                    receiver->packets_dropped++;
+                    _packets_dropped++;
+                    continue;
+                }
+            } break;
+            case ocQueuePolicy::Fifo:
+            {
+                receiver->packets_dropped++;
+                _packets_dropped++;
                 _logger.error(
-                    "IPC Packet lost due to nonblocking. message_id: %s (%i) from %s (%i) to %s (%i)",
+                    "IPC Packet lost because the send queue is full. message_id: %s (%i) from %s (%i) to %s (%i)",
                     to_string(message_id), message_id,
                     to_string(sender_id), sender_id,
                     to_string(receiver_id), receiver_id);
+                continue;
             }
-            else if (result < 0)
-            {
-                _logger.error("IPC Packet lost due to an error. message_id: %s (%i) from %s (%i) to %s (%i) error: (%i) %s",
-                    to_string(message_id), message_id,
-                    to_string(sender_id), sender_id,
-                    to_string(receiver_id), receiver_id,
-                    errno, strerror(errno));
-                _disconnect_client(receiver_id);
-                // TODO: when a member gets disconnected here, they will be replaced by the last member in the _subscribers_by_message_id[message_id] list that
-                // we're currently iterating over. This has two problems: 1. we're advancing the iterator in this loop, so that member will be skipped.
-                // 2. if the disconnected member was the second-to-last member in that list, we're going to crash because the loop wants to go once more, but
-                // by skipping the last one, we're now one over.
-            } else
+            case ocQueuePolicy::Block_Producer:
             {
-                bytes += (uint32_t)result;
-                packets += 1;
-                receiver->packets_received++;
+                // The packet still gets queued, but we don't read anything
+                // from the sender until the receiver caught up. Packets from
+                // the hub itself can't be held back, neither can a sender
+                // that the receiver is waiting for.
+                if (sender && ocMemberId::None == sender->blocked_by)
+                {
+                    if (_would_deadlock(sender_id, receiver_id))
+                    {
+                        _logger.warn("Not blocking %s (%i) for %s (%i), they would wait for each other. message_id: %s (%i)",
+                            to_string(sender_id), sender_id,
+                            to_string(receiver_id), receiver_id,
+                            to_string(message_id), message_id);
+                    }
+                    else
+                    {
+                        sender->blocked_by = receiver_id;
+                        sender->blocked_message_id = message_id;
+                        sender->blocked_limit = subscription.limit;
+                    }
+                }
+            } break;
             }
         }
+
+        int32_t result = receiver->socket.queue_frame(frame, urgent);
+        if (result < 0 && EMSGSIZE == errno)
+        {
+            receiver->packets_dropped++;
+            _packets_dropped++;
+            _logger.error(
+                "IPC Packet lost because it doesn't fit into the ring. message_id: %s (%i) from %s (%i) to %s (%i) length: %u",
+                to_string(message_id), message_id,
+                to_string(sender_id), sender_id,
+                to_string(receiver_id), receiver_id,
+                frame->get_length());
+        }
+        else if (result < 0)
+        {
+            _logger.error("IPC Packet lost due to an error. message_id: %s (%i) from %s (%i) to %s (%i) error: (%i) %s",
+                to_string(message_id), message_id,
+                to_string(sender_id), sender_id,
+                to_string(receiver_id), receiver_id,
+                errno, strerror(errno));
+            // Disconnecting right away would change the subscriber list
+            // we're iterating over.
+            _disconnect_later(receiver);
+        } else
+        {
+            bytes += (uint32_t)result;
+            packets += 1;
+            receiver->packets_received++;
+            _update_poll(receiver);
+        }
     }
     _add_stats(packets, 0, bytes, 0);
 }
@@ -329,17 +699,40 @@ void IpcHub::_add_stats(uint32_t sent_packets, uint32_t read_packets, uint32_t s
     {
         recursion = true; // make sure we don't recurse into this function
         auto diff_f = diff.get_float_seconds();
+
+        uint32_t queued_total = 0;
+        uint32_t queued_max = 0;
+        for (auto &[member_id, member] : _members_by_id)
+        {
+            uint32_t depth = (uint32_t)member->socket.get_queue_length();
+            queued_total += depth;
+            if (queued_max < depth) queued_max = depth;
+        }
+
+        ocFrameLeaseStats lease_stats = _frame_pool.collect_lease_stats();
+        uint64_t held_time_avg_us = 0;
+        if (0 < lease_stats.leases) held_time_avg_us = lease_stats.held_time_total_us / lease_stats.leases;
+
         ocPacket stats(ocMessageId::Ipc_Stats, ocMemberId::Ipc_Hub);
         stats.clear_and_edit()
             .write<uint32_t>((uint32_t)((float)_packets_sent / diff_f))
             .write<uint32_t>((uint32_t)((float)_packets_read / diff_f))
             .write<uint32_t>((uint32_t)((float)_bytes_sent / diff_f))
-            .write<uint32_t>((uint32_t)((float)_bytes_read / diff_f));
+            .write<uint32_t>((uint32_t)((float)_bytes_read / diff_f))
+            .write<uint32_t>((uint32_t)((float)_packets_dropped / diff_f))
+            .write<uint32_t>(queued_total)
+            .write<uint32_t>(queued_max)
+            .write<uint32_t>((uint32_t)((float)lease_stats.leases / diff_f))
+            .write<uint32_t>((uint32_t)held_time_avg_us)
+            .write<uint32_t>((uint32_t)lease_stats.held_time_max_us)
+            .write<uint32_t>((uint32_t)((float)lease_stats.skipped_slots / diff_f))
+            .write<uint32_t>(_frame_pool.get_free_slot_count());
 
         _packets_sent = 0;
         _packets_read = 0;
         _bytes_sent = 0;
         _bytes_read = 0;
+        _packets_dropped = 0;
         _distribute(stats);
         _last_stat_time = now;
         recursion = false;
@@ -372,8 +765,12 @@ int IpcHub::_handle_auth(int new_socket)
         delete member;
         return EXIT_FAILURE;
     }
+    member->id = member_id;
     member->packets_sent++;
 
+    // members can ask for the ring transport by sending the ring size
+    uint32_t ring_size = tp.read_from_start().read_or_default<uint32_t>(0);
+
     // if a process with that member ID already exists, we kill the old one
     // and let the new one take its place.
     if (_members_by_id.contains(member_id))
@@ -383,25 +780,41 @@ int IpcHub::_handle_auth(int new_socket)
 
     // answer with the Shared Memory ID so the client can attach to it
     // we also send a password so the client can be sure that it connected to the right socket.
+    // The ring ID is -1 if the member didn't ask for rings, the frame pool ID
+    // always comes after it.
     tp.set_header(ocMessageId::Auth_Response, ocMemberId::Ipc_Hub);
     tp.clear_and_edit()
         .write<uint32_t>(OC_AUTH_PASSWORD)
-        .write<int>(_shmid);
+        .write<int>(_shmid)
+        .write<int>(0 < ring_size ? _create_rings(member, ring_size) : -1)
+        .write<int>(_frame_pool_id);
 
     _logger.log("New connection from %s (%i) at socket %i", to_string(member_id), member_id, new_socket);
     if (member->socket.send_packet(tp) <= 0)
     {
         _logger.error("Failed to send the answer: (%i) %s", errno, strerror(errno));
+        if (member->ring_memory) shmdt(member->ring_memory);
         delete member;
         return EXIT_FAILURE;
     }
     member->packets_received++;
 
+    // The answer still had to go through the socket, everything after it goes
+    // through the rings.
+    if (member->ring_memory)
+    {
+        std::byte *to_hub = (std::byte *)member->ring_memory;
+        std::byte *from_hub = to_hub + ocShmRing::memory_size(ring_size);
+        member->socket.attach_rings(from_hub, to_hub);
+    }
+
     // now that the client is properly authenticated, we can add it to the list
     _members_by_id[member_id] = member;
 
     // add the new socket to the watchlist
     _pe.add_fd(new_socket);
+    // the read of the auth packet might have picked up more than that
+    member->pending_read = true;
 
     _shared_memory->online_members |= (uint16_t) member_id;
     _notify_members_changed(member_id, true);
@@ -412,7 +825,65 @@ int IpcHub::_handle_auth(int new_socket)
     return EXIT_SUCCESS;
 }
 
-std::map<ocMemberId, IpcMember*>::iterator IpcHub::_disconnect_client(ocMemberId member_id)
+int IpcHub::_create_rings(IpcMember *member, uint32_t ring_size)
+{
+    if (ring_size < 4096 || (1 << 24) < ring_size || 0 != (ring_size & (ring_size - 1)))
+    {
+        _logger.warn("Member asked for an invalid ring size of %u bytes, using the socket instead.", ring_size);
+        return -1;
+    }
+
+    size_t ring_memory_size = ocShmRing::memory_size(ring_size);
+    int ring_id = shmget(IPC_PRIVATE, 2 * ring_memory_size, IPC_CREAT | 0600);
+    if (ring_id < 0)
+    {
+        _logger.error("Could not create ring memory: (%i) %s", errno, strerror(errno));
+        return -1;
+    }
+
+    void *ring_memory = shmat(ring_id, nullptr, 0);
+    // Marking the segment for deletion right away means it goes away as soon
+    // as both sides detached, even if one of them crashes. Linux still lets
+    // the member attach in the meantime.
+    shmctl(ring_id, IPC_RMID, nullptr);
+    if (((void *)-1) == ring_memory)
+    {
+        _logger.error("Could not attach ring memory: (%i) %s", errno, strerror(errno));
+        return -1;
+    }
+
+    std::byte *to_hub = (std::byte *)ring_memory;
+    std::byte *from_hub = to_hub + ring_memory_size;
+    ocShmRing().init(to_hub, ring_size);
+    ocShmRing().init(from_hub, ring_size);
+    member->ring_memory = ring_memory;
+    return ring_id;
+}
+
+void IpcHub::_disconnect_later(IpcMember *member)
+{
+    if (member->broken) return;
+    member->broken = true;
+    _broken_members.append(member->id);
+}
+
+void IpcHub::_disconnect_broken_members()
+{
+    // Disconnecting notifies the others, which can break more members, so
+    // the list can grow while we walk through it.
+    for (size_t i = 0; i < _broken_members.get_length(); ++i)
+    {
+        ocMemberId member_id = _broken_members[i];
+        auto it = _members_by_id.find(member_id);
+        if (_members_by_id.end() != it && it->second->broken)
+        {
+            _disconnect_client(member_id);
+        }
+    }
+    _broken_members.clear();
+}
+
+void IpcHub::_disconnect_client(ocMemberId member_id)
 {
     auto it = _members_by_id.find(member_id);
     oc_assert(_members_by_id.end() != it);
@@ -420,23 +891,28 @@ std::map<ocMemberId, IpcMember*>::iterator IpcHub::_disconnect_client(ocMemberId
 
     _pe.delete_fd(member->socket.get_fd());
 
-    it = _members_by_id.erase(it);
+    _members_by_id.erase(it);
+    if (member->ring_memory) shmdt(member->ring_memory);
     delete member;
 
     // walk through all the message_ids and remove the process from the subscriber list
     for (auto &entry : _subscribers_by_message_id)
     {
-        ocArray<ocMemberId> &arr = entry.second;
-        size_t index = arr.first_index_of(member_id);
-        if (index < arr.get_length()) arr.remove_at(index);
+        ocArray<IpcSubscription> &arr = entry.second;
+        for (size_t index = 0; index < arr.get_length(); ++index)
+        {
+            if (arr[index].member_id == member_id)
+            {
+                arr.remove_at(index);
+                break;
+            }
+        }
     }
 
     _shared_memory->online_members &= (uint16_t) ~(int)member_id;
     _notify_members_changed(member_id, false);
 
     _logger.log("Disconnected member %s (%i)", to_string(member_id), member_id);
-
-    return it;
 }
 
 void IpcHub::_notify_members_changed(ocMemberId member_id, bool came_online)
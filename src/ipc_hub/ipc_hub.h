@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../common/ocConst.h"
+#include "../common/ocFramePool.h"
+#include "../common/ocIpcFrame.h"
 #include "../common/ocLogger.h"
 #include "../common/ocPacket.h"
 #include "../common/ocPollEngine.h"
@@ -20,7 +22,44 @@ struct IpcMember
     bool mute = true;
     uint64_t packets_sent     = 0;
     uint64_t packets_received = 0;
+    uint64_t packets_dropped  = 0;
     ocTime   last_active_time;
+    // shared memory of the two rings, if the member uses the ring transport
+    void    *ring_memory = nullptr;
+    // what the hub currently waits for on the socket
+    bool     watching_reads  = true;
+    bool     watching_writes = false;
+    // set when something went wrong, the member gets disconnected at the end
+    // of the current cycle
+    bool     broken = false;
+    // read the member in the next cycle even if its socket isn't readable
+    bool     pending_read = false;
+    // While a Block_Producer subscriber has too many packets from this member
+    // in its queue, the hub doesn't read anything from this member.
+    ocMemberId  blocked_by = ocMemberId::None;
+    ocMessageId blocked_message_id = ocMessageId::None;
+    uint16_t    blocked_limit = 0;
+};
+
+struct IpcSubscription
+{
+    ocMessageId   message_id;
+    ocMemberId    member_id;
+    ocQueuePolicy policy;
+    // how many packets of this message may wait in the member's send queue
+    uint16_t      limit;
+};
+
+// How soon the hub forwards a message after reading it.
+enum class IpcPriority
+{
+    // only forwarded after all members were read in the current cycle
+    Bulk,
+    // forwarded right away
+    Normal,
+    // forwarded right away and put in front of everything non-urgent in the
+    // receivers' send queues
+    Control
 };
 
 class IpcHub
@@ -34,6 +73,9 @@ public:
     // init shared memory
     int create_shared_memory();
 
+    // init the pool for the camera frames
+    int create_frame_pool(uint32_t slot_count, size_t size);
+
     // check the canaries in the shred memory for modifications
     void check_shared_memory();
 
@@ -47,6 +89,10 @@ private:
     // the shared memory itself
     ocSharedMemory *_shared_memory;
 
+    // the frame pool has its own segment, its size isn't known at compile time
+    int _frame_pool_id = -1;
+    ocFramePool _frame_pool;
+
     ocPacket _packet;
 
     // Socket-Management
@@ -60,14 +106,27 @@ private:
     uint32_t _packets_read = 0;
     uint32_t _bytes_sent = 0;
     uint32_t _bytes_read = 0;
+    uint32_t _packets_dropped = 0;
+
+    ocCanary<uint64_t> _canaries[6];
+
+    // true if some members with the ring transport still have queued frames
+    bool _has_blocked_rings = false;
 
-    ocCanary<uint64_t> _canaries[8];
+    // true if a member has to be read in the next cycle, even without an event
+    bool _has_pending_reads = false;
+
+    // members that get disconnected at the end of the current cycle
+    ocArray<ocMemberId> _broken_members;
+
+    // bulk packets that get forwarded once all members were read
+    ocArray<ocIpcFrame *> _deferred_frames;
 
     // list of all connected clients
     std::map<ocMemberId, IpcMember*> _members_by_id;
 
     // list of subscribers for every message_id
-    std::map<ocMessageId, ocArray<ocMemberId>> _subscribers_by_message_id;
+    std::map<ocMessageId, ocArray<IpcSubscription>> _subscribers_by_message_id;
 
     /* Private Functions */
     void _add_stats(uint32_t sent_packets, uint32_t read_packets, uint32_t sent_bytes, uint32_t read_bytes);
@@ -75,11 +134,44 @@ private:
     // create a new client, add it to the list and send it the shared memory key
     int _handle_auth(int newConnection);
 
+    // create the two rings of a member that asked for the ring transport and
+    // return the shared memory ID, or -1 if that didn't work
+    int _create_rings(IpcMember *member, uint32_t ring_size);
+
     // send a packet to all clients that should receive it
     void _distribute(const ocPacket& packet);
+    void _distribute(const ocPacketView& packet);
+    void _distribute(ocIpcFrame *frame);
+
+    // keep a bulk packet until all members were read in this cycle
+    void _defer(const ocPacketView& packet);
+    void _distribute_deferred();
 
     // remove a client and clear all the message_ids it was subscribed to
-    std::map<ocMemberId, IpcMember*>::iterator _disconnect_client(ocMemberId client_id);
+    void _disconnect_client(ocMemberId client_id);
+
+    // mark a client as broken, so it gets disconnected once it is safe to do so
+    void _disconnect_later(IpcMember *member);
+    void _disconnect_broken_members();
+
+    // the queue policy a subscription gets when the member didn't pick one
+    IpcSubscription _default_subscription(ocMemberId member_id, ocMessageId message_id);
+    IpcPriority _priority(ocMessageId message_id);
+    void _subscribe(ocMemberId member_id, const IpcSubscription &subscription);
+
+    // resume reading from a blocked member once its receiver caught up
+    void _try_unblock(IpcMember *member);
+
+    // true if the receiver waits for the sender, directly or through other
+    // blocked members, so blocking the sender would never end
+    bool _would_deadlock(ocMemberId sender_id, ocMemberId receiver_id);
+
+    // update what we wait for on a member's socket, depending on its send
+    // queue and whether it is blocked
+    void _update_poll(IpcMember *member);
+
+    // send the collected profiler events to everyone who is interested
+    void _send_timing_events();
 
     // send a packet to everyone who cares about newly connected and disconnected members
     void _notify_members_changed(ocMemberId member_id, bool came_online);
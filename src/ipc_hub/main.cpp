@@ -7,12 +7,21 @@
 
 #include <cstdlib> // EXIT_FAILURE
 #include "ipc_hub.h"
+#include "../common/ocArgumentParser.h"
 
-int main()
+int main(int argc, const char **argv)
 {
     IpcHub hub;
 
+    // -fs: number of frames in the frame pool, -fp: size of the pool in MiB
+    ocArgumentParser arg_parser(argc, argv);
+    uint32_t frame_slots = OC_FRAME_POOL_SLOTS;
+    uint32_t frame_pool_mib = OC_FRAME_POOL_SIZE / (1024 * 1024);
+    arg_parser.get_uint32("-fs", &frame_slots);
+    arg_parser.get_uint32("-fp", &frame_pool_mib);
+
     if (hub.create_shared_memory() == EXIT_FAILURE) exit(1);
+    if (hub.create_frame_pool(frame_slots, (size_t)frame_pool_mib * 1024 * 1024) == EXIT_FAILURE) exit(1);
     if (hub.start_server() == EXIT_FAILURE) exit(1);
 
     while(true) hub.process_clients();
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Circle along the lane in BEV pixels.
+struct LaneCircle {
+    cv::Point2d center;
+    // 0 if no lane was ever found
+    double radius = 0;
+    // 0 if the last frame didn't have enough points, up to 1 if all points
+    // lie on the circle
+    double confidence = 0;
+
+    bool is_valid() const {
+        return 0 < radius;
+    }
+};
+
+// Fits a circle to the lane points of one frame. Every circle through three
+// of the points is a candidate, as are the circle of the previous frame and a
+// fit through all points. The candidate that the most points agree with is
+// refined by an algebraic fit (Pratt) on just those points, so single wrong
+// points don't pull the circle away.
+class CircleFit {
+    public:
+        // Points further away from a candidate don't count for it.
+        static constexpr double INLIER_DISTANCE = 8.0;
+        // Straight lanes have no circle, they get one this big instead.
+        static constexpr double MAX_RADIUS = 3125.0;
+        // With fewer points the confidence goes down.
+        static constexpr size_t FULL_SUPPORT = 5;
+        // Above that many triples, random ones are tried.
+        static constexpr size_t MAX_CANDIDATES = 64;
+
+        LaneCircle fit(const std::vector<cv::Point> &points, const LaneCircle &previous) {
+            LaneCircle result = previous;
+            result.confidence = 0;
+
+            const size_t count = points.size();
+            if (count < 3) {
+                return result;
+            }
+
+            std::vector<cv::Point2d> all(points.begin(), points.end());
+
+            LaneCircle best;
+            double best_cost = INFINITY;
+            auto try_candidate = [&](const LaneCircle &candidate) {
+                double cost = 0;
+                for (const cv::Point2d &point : all) {
+                    double d = distance(candidate, point);
+                    cost += std::min(d * d, INLIER_DISTANCE * INLIER_DISTANCE);
+                }
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best = candidate;
+                }
+            };
+
+            if (previous.is_valid()) {
+                try_candidate(previous);
+            }
+            LaneCircle circle;
+            if (fit_all(all, &circle)) {
+                try_candidate(circle);
+            }
+
+            size_t triple_count = count * (count - 1) * (count - 2) / 6;
+            if (triple_count <= MAX_CANDIDATES) {
+                for (size_t a = 0; a < count; ++a) {
+                    for (size_t b = a + 1; b < count; ++b) {
+                        for (size_t c = b + 1; c < count; ++c) {
+                            if (circle_through(all[a], all[b], all[c], &circle)) {
+                                try_candidate(circle);
+                            }
+                        }
+                    }
+                }
+            } else {
+                std::uniform_int_distribution<size_t> pick(0, count - 1);
+                for (size_t i = 0; i < MAX_CANDIDATES; ++i) {
+                    size_t a = pick(random), b = pick(random), c = pick(random);
+                    if (a != b && b != c && a != c && circle_through(all[a], all[b], all[c], &circle)) {
+                        try_candidate(circle);
+                    }
+                }
+            }
+
+            if (!best.is_valid()) {
+                return result;
+            }
+
+            // Refit on the inliers, more points may agree with the refined
+            // circle than with the candidate.
+            std::vector<cv::Point2d> inliers;
+            for (int round = 0; round < 2; ++round) {
+                size_t inlier_count = inliers.size();
+                collect_inliers(best, all, &inliers);
+                if (inliers.size() < 3 || inliers.size() == inlier_count) {
+                    break;
+                }
+                if (!fit_all(inliers, &circle)) {
+                    break;
+                }
+                best = circle;
+            }
+            collect_inliers(best, all, &inliers);
+            if (inliers.size() < 3) {
+                return result;
+            }
+
+            double squared_error = 0;
+            for (const cv::Point2d &point : inliers) {
+                double d = distance(best, point);
+                squared_error += d * d;
+            }
+            double rms = std::sqrt(squared_error / inliers.size());
+
+            best.confidence = (double)inliers.size() / count
+                            * std::min(1.0, (double)inliers.size() / FULL_SUPPORT)
+                            * std::max(0.0, 1.0 - rms / INLIER_DISTANCE);
+            return best;
+        }
+
+        static double distance(const LaneCircle &circle, cv::Point2d point) {
+            return std::abs(std::hypot(point.x - circle.center.x, point.y - circle.center.y) - circle.radius);
+        }
+
+    private:
+        // fixed seed, so a recorded drive gives the same result every time
+        std::minstd_rand random{42};
+
+        static void collect_inliers(const LaneCircle &circle, const std::vector<cv::Point2d> &points, std::vector<cv::Point2d> *inliers) {
+            inliers->clear();
+            for (const cv::Point2d &point : points) {
+                if (distance(circle, point) < INLIER_DISTANCE) {
+                    inliers->push_back(point);
+                }
+            }
+        }
+
+        // Circle through three points, false if they are (nearly) on a line.
+        static bool circle_through(cv::Point2d a, cv::Point2d b, cv::Point2d c, LaneCircle *circle) {
+            double bx = b.x - a.x, by = b.y - a.y;
+            double cx = c.x - a.x, cy = c.y - a.y;
+            double det = 2 * (bx * cy - by * cx);
+            if (std::abs(det) < 1e-9) {
+                return false;
+            }
+            double b2 = bx * bx + by * by;
+            double c2 = cx * cx + cy * cy;
+            double ux = (cy * b2 - by * c2) / det;
+            double uy = (bx * c2 - cx * b2) / det;
+            double radius = std::hypot(ux, uy);
+            if (MAX_RADIUS < radius) {
+                return false;
+            }
+            circle->center = cv::Point2d(a.x + ux, a.y + uy);
+            circle->radius = radius;
+            return true;
+        }
+
+        // Algebraic circle fit with Pratt's normalization, solved with
+        // Newton's method like Chernov describes it. Points on a line get a
+        // circle of MAX_RADIUS that touches the line.
+        static bool fit_all(const std::vector<cv::Point2d> &points, LaneCircle *circle) {
+            const double n = (double)points.size();
+            double mean_x = 0, mean_y = 0;
+            for (const cv::Point2d &point : points) {
+                mean_x += point.x;
+                mean_y += point.y;
+            }
+            mean_x /= n;
+            mean_y /= n;
+
+            double mxx = 0, myy = 0, mxy = 0, mxz = 0, myz = 0, mzz = 0;
+            for (const cv::Point2d &point : points) {
+                double x = point.x - mean_x;
+                double y = point.y - mean_y;
+                double z = x * x + y * y;
+                mxx += x * x;
+                myy += y * y;
+                mxy += x * y;
+                mxz += x * z;
+                myz += y * z;
+                mzz += z * z;
+            }
+            mxx /= n; myy /= n; mxy /= n; mxz /= n; myz /= n; mzz /= n;
+
+            const double mz = mxx + myy;
+            if (mz <= 0) {
+                return false;
+            }
+            const double cov_xy = mxx * myy - mxy * mxy;
+            const double a2 = 4 * cov_xy - 3 * mz * mz - mzz;
+            const double a1 = mzz * mz + 4 * cov_xy * mz - mxz * mxz - myz * myz - mz * mz * mz;
+            const double a0 = mxz * mxz * myy + myz * myz * mxx - mzz * cov_xy - 2 * mxz * myz * mxy + mz * mz * cov_xy;
+
+            double x = 0;
+            double y = a0;
+            for (int i = 0; i < 20; ++i) {
+                double dy = a1 + x * (2 * a2 + 16 * x * x);
+                double x_new = x - y / dy;
+                if (x_new == x || !std::isfinite(x_new)) {
+                    break;
+                }
+                double y_new = a0 + x_new * (a1 + x_new * (a2 + 4 * x_new * x_new));
+                if (std::abs(y_new) >= std::abs(y)) {
+                    break;
+                }
+                x = x_new;
+                y = y_new;
+            }
+
+            const double det = x * x - x * mz + cov_xy;
+            const double ux = (mxz * (myy - x) - myz * mxy) / det / 2;
+            const double uy = (myz * (mxx - x) - mxz * mxy) / det / 2;
+
+            if (std::isfinite(ux) && std::isfinite(uy) && std::hypot(ux, uy) < MAX_RADIUS) {
+                circle->center = cv::Point2d(mean_x + ux, mean_y + uy);
+                // the distance that fits the points best for this center
+                double radius = 0;
+                for (const cv::Point2d &point : points) {
+                    radius += std::hypot(point.x - circle->center.x, point.y - circle->center.y);
+                }
+                circle->radius = radius / n;
+                return true;
+            }
+
+            // The points are on a line through the mean, the center is on the
+            // side the fit found, if it found one.
+            double angle = 0.5 * std::atan2(2 * mxy, mxx - myy);
+            double normal_x = -std::sin(angle);
+            double normal_y = std::cos(angle);
+            if (std::isfinite(ux) && std::isfinite(uy) && ux * normal_x + uy * normal_y < 0) {
+                normal_x = -normal_x;
+                normal_y = -normal_y;
+            }
+            circle->center = cv::Point2d(mean_x + normal_x * MAX_RADIUS, mean_y + normal_y * MAX_RADIUS);
+            circle->radius = MAX_RADIUS;
+            return true;
+        }
+};
@@ -2,15 +2,26 @@
 #include <unistd.h>
 #include <opencv2/opencv.hpp>
 
+#include "./circleFit.cpp"
+#include "./polarScanner.cpp"
+
 const int IMAGE_HEIGHT = 400;
 const int IMAGE_WIDTH = 400;
-const int COLOR_DIFFERENCE = 5;
 
 class Helper {
     public:
         cv::Mat* matrix;
         cv::Mat* drawMatrix;
 
+        static constexpr int radiusse[] = {50, 55, 60, 65, 75, 100, 150};
+
+        PolarScanner scanner{cv::Point(200, 400), radiusse, std::size(radiusse), IMAGE_WIDTH, IMAGE_HEIGHT};
+
+        CircleFit circle_fit;
+        // the circle of the last frame, its confidence is 0 if that frame had
+        // no usable lane, then the circle is the one from before
+        LaneCircle lane;
+
         double calc_dist(cv::Point p1, cv::Point p2) {
             return calc_dist(std::pair(p1.x, p1.y), std::pair(p2.x, p2.y));
         }
@@ -19,7 +30,9 @@ class Helper {
             return std::sqrt(std::pow(std::get<0>(p1) - std::get<0>(p2), 2) + std::pow(std::get<1>(p1) - std::get<1>(p2), 2));
         }
 
-        std::tuple<cv::Point, int> calculate_radius(cv::Mat* matrix, cv::Mat* drawMatrix) {
+        // With a prediction of the lane, every circle is only searched within
+        // window pixels around where the prediction crosses it.
+        std::tuple<cv::Point, int> calculate_radius(cv::Mat* matrix, cv::Mat* drawMatrix, const LaneCircle *prediction = nullptr, double window = 0) {
             this->matrix = matrix;
             this->drawMatrix = drawMatrix;
 
@@ -31,28 +44,38 @@ class Helper {
             const int FINAL_RADIUS = 175;
             const int ZIRKLE_DIFF = 25;
 
-            const int radiusse[] = {50, 55, 60, 65, 75, 100, 150};
-
-            cv::Point* previous_center = nullptr;
+            bool has_previous_center = false;
+            cv::Point previous_center;
             float previous_center_radian = -1;
 
             std::vector<cv::Point> center_point_list;
 
             //for(int radius = INITIAL_RADIUS; radius < FINAL_RADIUS; radius += ZIRKLE_DIFF) {
-            for(int radius : radiusse) {
-                std::vector<cv::Point> point_list = get_pointlist_of_radius(radius);
-
-                if(previous_center != nullptr) {
-                    float dy = previous_center->y - 400;
-                    float dx = previous_center->x - 200;
+            for(size_t ring = 0; ring < scanner.ring_count(); ring++) {
+                int radius = scanner.radius(ring);
+                double angle_begin = 0;
+                double angle_end = CV_PI;
+
+                cv::Point2d expected;
+                if(prediction != nullptr && crosses_ring(*prediction, radius, &expected)) {
+                    double angle = std::atan2(400 - expected.y, expected.x - 200);
+                    angle_begin = angle - window / radius;
+                    angle_end = angle + window / radius;
+                    previous_center_radian = std::atan2(expected.x - 200, expected.y - 400);
+                } else if(has_previous_center) {
+                    float dy = previous_center.y - 400;
+                    float dx = previous_center.x - 200;
                     previous_center_radian = std::atan2(dx, dy);
                 }
+
+                const std::vector<cv::Point> &point_list = scanner.find_lines(*matrix, ring, angle_begin, angle_end);
                 
                 cv::Point point = get_street_middle_from_points(point_list, previous_center_radian, radius);
 
                 if(point.x != -1) {
                     center_point_list.push_back(point);
-                    previous_center = &point;
+                    previous_center = point;
+                    has_previous_center = true;
 
                     if(std::getenv("CAR_ENV") != NULL) {
                         cv::circle(*drawMatrix, point, 2, cv::Scalar(0, 255, 255, 1), 2); //gelb
@@ -77,11 +100,17 @@ class Helper {
                 }
             #endif
 
-            cv::Point final_center;
-            int final_radius;
+            lane = circle_fit.fit(center_point_list, prediction != nullptr ? *prediction : lane);
+            if(!lane.is_valid()) {
+                // nothing found yet, drive straight
+                lane.center = cv::Point2d(200 + CircleFit::MAX_RADIUS, 450);
+                lane.radius = CircleFit::MAX_RADIUS;
+            }
 
-            std::tuple<cv::Point, int> final = loop_through_circles(center_point_list);
-            std::tie(final_center, final_radius) = final;
+            // The radius is negative if the curve goes to the left.
+            cv::Point final_center((int)std::lround(lane.center.x), (int)std::lround(lane.center.y));
+            int final_radius = (int)std::lround(lane.center.x < 200 ? -lane.radius : lane.radius);
+            std::tuple<cv::Point, int> final = std::make_tuple(final_center, final_radius);
 
             if(std::getenv("CAR_ENV") != NULL) {
                 cv::circle(*this->drawMatrix, final_center, abs(final_radius), cv::Scalar(200, 110, 50, 255), 5); //end radius kreis
@@ -90,6 +119,11 @@ class Helper {
             return final;
         }
 
+        // Sets every pixel of the mask that calculate_radius can look at.
+        void mark_sampled_pixels(cv::Mat &mask) {
+            scanner.mark_pixels(mask);
+        }
+
         double radius_to_angle(float radius) {
             if(radius > 0) {
                 return 3000000.0 * std::pow(radius, -3) + 10;
@@ -105,57 +139,37 @@ class Helper {
         }
 
     private:
-        cv::Point check_for_valid_point(int direction, int radius, float looking_pi) {
-            std::pair<int, int> pair[2];
-
-            for (double pi = 0; pi < 0.5; pi += 0.01) {
-                double offset = looking_pi + pi * direction;
-
-                int x = 200 + round(cos(offset) * radius);
-                int y = 400 - round(sin(offset) * radius);
-
-                int x2 = 200 + round(cos(offset+0.01 * direction) * radius);
-                int y2 = 400 - round(sin(offset+0.01 * direction) * radius);
-
-                int x3 = 200 + round(cos(offset+0.03 * direction) * radius);
-                int y3 = 400 - round(sin(offset+0.03 * direction) * radius);
-
-                if (x >= IMAGE_WIDTH || x < 0 || y >= IMAGE_HEIGHT || y < 0) {
+        // Where the circle crosses the search circle with the given radius in
+        // front of the car, the crossing closest to straight ahead.
+        bool crosses_ring(const LaneCircle &circle, int radius, cv::Point2d *crossing) {
+            const cv::Point2d origin(200, 400);
+            double dx = circle.center.x - origin.x;
+            double dy = circle.center.y - origin.y;
+            double dist = std::hypot(dx, dy);
+            if(dist < 1) {
+                return false;
+            }
+            // distance from the origin along the line to the circle center
+            // and from there to the crossings
+            double along = (radius * radius - circle.radius * circle.radius + dist * dist) / (2 * dist);
+            double across_squared = radius * radius - along * along;
+            if(across_squared < 0) {
+                return false;
+            }
+            double across = std::sqrt(across_squared);
+            bool found = false;
+            for(double sign : {-1.0, 1.0}) {
+                cv::Point2d point(origin.x + (along * dx - sign * across * dy) / dist,
+                                  origin.y + (along * dy + sign * across * dx) / dist);
+                if(origin.y < point.y) {
                     continue;
                 }
-
-                if (x2 >= IMAGE_WIDTH || x2 < 0 || y2 >= IMAGE_HEIGHT || y2 < 0) {
-                    continue;
-                }
-
-                if (x3 >= IMAGE_WIDTH || x3 < 0 || y3 >= IMAGE_HEIGHT || y3 < 0) {
-                    continue;
-                }
-
-                int color = matrix->at<uint8_t>(y, x);
-                int color2 = matrix->at<uint8_t>(y2, x2);
-                int color3 = matrix->at<uint8_t>(y3, x3);
-
-                if (color > 235) {
-                    continue;
-                }
-
-                if ((color2 - color) * direction > COLOR_DIFFERENCE && (color3 - color) * direction > COLOR_DIFFERENCE) {
-                    pair[0] = std::pair(x,y);
-                }
-
-                if((color - color2) * direction > COLOR_DIFFERENCE && pair[0].first != 0 && pair[0].second != 0 && (color - color3) * direction > COLOR_DIFFERENCE) {
-                    pair[1] = std::pair(x,y);
-
-                    double dist = calc_dist(pair[0], pair[1]);
-
-                    if(dist <= 10.0f) {
-                        return cv::Point((pair[0].first + pair[1].first) / 2, (pair[0].second + pair[1].second) / 2);
-                    }
+                if(!found || std::abs(point.x - origin.x) < std::abs(crossing->x - origin.x)) {
+                    *crossing = point;
+                    found = true;
                 }
             }
-
-            return cv::Point(-1,-1);
+            return found;
         }
 
         cv::Point get_street_middle_from_points(std::vector<cv::Point> point_list, float previous_center, int radius) {
@@ -221,47 +235,4 @@ class Helper {
                 return cv::Point(-1, -1);
             }
         }
-
-        std::vector<cv::Point> get_pointlist_of_radius(int radius) {
-            std::vector<cv::Point> point_list;
-
-            for(float pi = 0; pi < 3.14; pi += 0.1f) {
-                cv::Point point = check_for_valid_point(1, radius, pi);
-
-                if(point.x != -1 && std::find(point_list.begin(), point_list.end(), point) == point_list.end()) {
-                    point_list.push_back(point);
-                }
-            }
-
-            return point_list;
-        }
-
-        std::tuple<cv::Point, int> loop_through_circles(std::vector<cv::Point> points) {
-            int best_radius = 100000000;
-            cv::Point best_center = cv::Point(0,0);
-            double best_dist = 100000000;
-
-            for(float ra = -5; ra < 5; ra+= 0.1) {
-                if (std::abs(ra) < 1.1) {
-                    continue;
-                }
-
-                int r = int(std::pow(ra, 5));
-                cv::Point center = cv::Point(200+r, 450);
-
-                double dist = 0;
-
-                for (cv::Point point : points) {
-                    dist += abs(calc_dist(center, point) - abs(r));
-                }
-
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best_radius = r;
-                    best_center = center;
-                }
-            }
-
-            return std::make_tuple(best_center, best_radius);
-        }
 };
\ No newline at end of file
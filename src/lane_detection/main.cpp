@@ -2,6 +2,12 @@
 #include "../common/ocMember.h"
 #include "../common/ocCar.h"
 #include "../common/ocCarConfig.h"
+#include "../common/ocFrameSlot.h"
+#include "../common/ocLaneTracker.h"
+#include "../common/ocAlarm.h"
+#include "../common/ocMotionHistory.h"
+#include "../common/ocPathController.h"
+#include "../common/ocPollEngine.h"
 #include <signal.h>
 #include <vector>
 #include <unistd.h>
@@ -19,6 +25,35 @@
 
 #define DRAW_LINE_SAMPLES
 
+// Ask Image_Processing to only render the pixels of the lane BEV that the
+// helper looks at. Comment this out to get the whole image, e.g. for bev.jpg.
+#define REQUEST_BEV_REGION
+
+// Image_Processing may have been restarted, so the region is sent again
+// after this many frames.
+#define BEV_REGION_RESEND_FRAMES 100
+
+// Follow the lane across frames with the odometry, search only around the
+// predicted lane and steer along the tracked lane, which also covers frames
+// where the lane isn't found.
+#define TRACK_LANE
+
+// Pixels around the predicted lane middle that are searched for markings,
+// on top of the uncertainty of the prediction.
+#define SEARCH_MARGIN 80.0
+
+// Steer with the path controller at a fixed rate, moving the car along the
+// last lane from the exposure of its frame until now, instead of mapping the
+// circle of each frame to a steering angle.
+#define PATH_CONTROLLER
+#define CONTROL_RATE_HZ 50.0f
+
+// Scale of the lane BEV and where the car is in it, 50 px below its bottom
+// edge. Used to send the lane circle relative to the car.
+#define CM_PER_PIXEL 0.6f
+#define CAR_PIXEL_X 200
+#define CAR_PIXEL_Y 450
+
 //#define DEBUG
 
 //#define DEBUG_WINDOW
@@ -35,6 +70,27 @@ ocCarProperties car_properties;
 Helper helper;
 Circle circle;
 SquareApproach square_approach;
+ocLaneTracker lane_tracker;
+
+// odometry and driving tasks, to tell how the car moved since a frame was
+// exposed
+ocMotionHistory motion_history(&car_properties);
+ocTime last_frame_time = ocTime::null();
+
+#ifdef PATH_CONTROLLER
+ocPathController path_controller;
+// the car relative to where it was when the frame of the last lane was exposed
+ocCarState control_car = {};
+ocTime control_lane_time = ocTime::null();
+// The exposure of a new lane until the first command from it is sent. Only
+// that one carries it, the later ones would measure the age of the lane
+// instead of the latency from the camera to the CAN bus.
+ocTime control_unsent_lane_time = ocTime::null();
+#endif
+
+// the last steering that was sent
+int8_t  last_steering_front = 0;
+int8_t  last_steering_rear = 0;
 
 std::deque<float> last_angles;
 
@@ -78,19 +134,141 @@ float get_oldest_angle() {
     return last_angles.back(); // Gib den ältesten Winkel zurück
 }
 
+void request_bev_region() {
+    static std::vector<ocBevSpan> spans;
+    if (spans.empty()) {
+        cv::Mat mask = cv::Mat::zeros(IMAGE_HEIGHT, IMAGE_WIDTH, CV_8UC1);
+        helper.mark_sampled_pixels(mask);
+        for (int y = 0; y < IMAGE_HEIGHT; ++y) {
+            int x = 0;
+            while (x < IMAGE_WIDTH) {
+                while (x < IMAGE_WIDTH && !mask.at<uint8_t>(y, x)) ++x;
+                if (x == IMAGE_WIDTH) break;
+                int begin = x;
+                while (x < IMAGE_WIDTH && mask.at<uint8_t>(y, x)) ++x;
+                spans.push_back({(uint16_t)y, (uint16_t)begin, (uint16_t)x});
+            }
+        }
+    }
+
+    ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
+    ipc_packet.set_message_id(ocMessageId::Bev_Region_Request);
+    ipc_packet.clear_and_edit()
+        .write(ocBevViewId::Lane)
+        .write((uint32_t)spans.size())
+        .write(spans.data(), spans.size() * sizeof(ocBevSpan));
+    socket->send_packet(ipc_packet);
+}
+
+// The lane BEV is in pixels, ocLaneData in cm relative to the car. This is
+// the only place where the two meet: pixel columns grow to the right, like y
+// of ocCarState, and rows grow backwards.
+void circle_to_car(const LaneCircle &circle, float *center_x, float *center_y, float *radius) {
+    *center_x = CM_PER_PIXEL * (float)(CAR_PIXEL_Y - circle.center.y);
+    *center_y = CM_PER_PIXEL * (float)(circle.center.x - CAR_PIXEL_X);
+    *radius   = CM_PER_PIXEL * (float)circle.radius;
+}
+
+LaneCircle car_to_circle(const ocLaneData &lane_data) {
+    LaneCircle circle;
+    circle.center = cv::Point2d(CAR_PIXEL_X + lane_data.curve_center_y / CM_PER_PIXEL,
+                                CAR_PIXEL_Y - lane_data.curve_center_x / CM_PER_PIXEL);
+    circle.radius = lane_data.curve_radius / CM_PER_PIXEL;
+    return circle;
+}
+
+// Moves the tracked lane by how far the car drove between the exposures of
+// the last frame and this one.
+void predict_lane(ocTime frame_time) {
+    ocTime previous = last_frame_time;
+    last_frame_time = frame_time;
+    if (ocTime::null() == previous || frame_time <= previous) {
+        return;
+    }
+
+    float distance;
+    ocPose motion = motion_history.get_motion(previous, frame_time, &distance);
+    lane_tracker.predict(motion, distance);
+}
+
+ocLaneData get_lane_data(ocTime frame_time, uint32_t frame_number) {
+    ocLaneData lane_data = {};
+    lane_data.frame_time   = frame_time;
+    lane_data.frame_number = frame_number;
+    // A radius of 0 tells that there is no lane.
+#ifdef TRACK_LANE
+    lane_tracker.get_lane(&lane_data);
+#else
+    if (0 < helper.lane.confidence) {
+        circle_to_car(helper.lane, &lane_data.curve_center_x, &lane_data.curve_center_y, &lane_data.curve_radius);
+    }
+#endif
+    return lane_data;
+}
+
+void send_lane_data(const ocLaneData &lane_data) {
+    ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
+    ipc_packet.set_message_id(ocMessageId::Lane_Found);
+    ipc_packet.clear_and_edit()
+        .write(lane_data);
+    socket->send_packet(ipc_packet);
+}
+
+#ifdef PATH_CONTROLLER
+// The lane is relative to where the car was when its frame was exposed. A
+// lane without that time is taken to be from now.
+void set_control_lane(const ocLaneData &lane_data) {
+    path_controller.set_lane(lane_data);
+    control_lane_time = (ocTime::null() == lane_data.frame_time) ? ocTime::now() : lane_data.frame_time;
+    control_unsent_lane_time = lane_data.frame_time;
+}
+
+// Moves the car from where it was at the exposure of the lane until now, by
+// the odometry and the driving tasks in between, and sends the steering for
+// where it is now. That way the steering doesn't lag behind by the time the
+// frame took to get here.
+void control_step(float period) {
+    control_car.pose = motion_history.get_motion(control_lane_time, ocTime::now());
+
+    // Without a lane the car stops, once.
+    static bool has_lane = false;
+    ocPathController::Command command;
+    if (!path_controller.update(control_car, period, &command)) {
+        if (has_lane) {
+            socket->send(ocLaneDetectionValues{
+                .speed          = 0,
+                .steering_front = last_steering_front,
+                .steering_rear  = last_steering_rear
+            });
+            has_lane = false;
+        }
+        return;
+    }
+    has_lane = true;
+
+    last_steering_front = (int8_t)std::clamp(car_properties.front_steering_angle_to_byte(command.steering_front) + ANGLE_OFFSET_FRONT, -90, 90);
+    last_steering_rear  = car_properties.rear_steering_angle_to_byte(command.steering_rear);
+    socket->send(ocLaneDetectionValues{
+        .speed          = (int16_t)std::lround(command.speed),
+        .steering_front = last_steering_front,
+        .steering_rear  = last_steering_rear,
+        .frame_time     = control_unsent_lane_time
+    });
+    control_unsent_lane_time = ocTime::null();
+}
+#endif
+
 bool check_if_on_street() { // TODO:
    return true;
 }
 
 void return_to_street(float front_angle) { //TODO: 
     if(!check_if_on_street()) {
-        ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
-        ipc_packet.set_message_id(ocMessageId::Lane_Detection_Values);
-        ipc_packet.clear_and_edit()
-            .write<int16_t>(-30)
-            .write<int8_t>(front_angle)
-            .write<int8_t>(0);
-        socket->send_packet(ipc_packet);    
+        socket->send(ocLaneDetectionValues{
+            .speed          = -30,
+            .steering_front = (int8_t)front_angle,
+            .steering_rear  = 0
+        });
     }
 }
 
@@ -144,165 +322,266 @@ int main()
     signal(SIGQUIT, signal_handler);
     signal(SIGTERM, signal_handler);
 
-    member.attach();
+    member.attach(ocIpcTransport::Shared_Memory_Ring);
 
     socket = member.get_socket();
     shared_memory = member.get_shared_memory();
     logger = member.get_logger();
 
     read_config_file(CAR_CONFIG_FILE, car_properties, *logger);
+#ifdef PATH_CONTROLLER
+    control_car.properties = &car_properties;
+#endif
 
     ipc_packet.set_message_id(ocMessageId::Subscribe_To_Messages);
     ipc_packet.clear_and_edit()
-        .write(ocMessageId::Lines_Available);
+        .write(ocMessageId::Lines_Available)
+        .write(ocMessageId::Received_Odo_Steps)
+        .write(ocMessageId::Start_Driving_Task);
     socket->send_packet(ipc_packet);
 
+#ifdef REQUEST_BEV_REGION
+    request_bev_region();
+#endif
+
     logger->log("Lane Detection started!");
 
+    ocPollEngine pe(2);
+    pe.add_fd(socket->get_fd());
+#ifdef PATH_CONTROLLER
+    ocAlarm control_alarm(ocTime::hertz(CONTROL_RATE_HZ));
+    control_alarm.start(ocAlarmType::Periodic);
+    pe.add_fd(control_alarm.get_fd());
+#endif
+
     while(running) {
-        int32_t socket_status = socket->read_packet(ipc_packet);
+        pe.await();
 
-        if(socket_status <= 0) {
+#ifdef PATH_CONTROLLER
+        if (pe.was_triggered(control_alarm.get_fd()) && control_alarm.is_expired()) {
+            control_step(1.0f / CONTROL_RATE_HZ);
+        }
+#endif
+
+        if (!pe.was_triggered(socket->get_fd())) {
             continue;
         }
 
-        switch(ipc_packet.get_message_id())
-        {
-            case ocMessageId::Lines_Available:
+        int32_t socket_status;
+        while (0 < (socket_status = socket->read_packet(ipc_packet, false))) {
+            switch(ipc_packet.get_message_id())
             {
-                cv::Mat camImageMatrix = cv::Mat(400,400,CV_8UC1, shared_memory->bev_data[0].img_buffer);
-                cv::Mat matrix;
-                cv::Mat matrix2;
+                case ocMessageId::Lines_Available:
+                {
+                    cv::Mat matrix;
+                    cv::Mat matrix2;
+                    ocTime frame_time = ocTime::null();
+                    uint32_t frame_number = 0;
+
+                    bool got_frame = read_frame(shared_memory->bev_data[0], [&](const ocBevData &bev_data)
+                    {
+                        cv::Mat(400, 400, CV_8UC1, (void *)bev_data.img_buffer).copyTo(matrix);
+                        frame_time   = bev_data.frame_time;
+                        frame_number = bev_data.frame_number;
+                    });
+                    // Image_Processing is already writing the next one, we'll get
+                    // another Lines_Available for it.
+                    if (!got_frame) break;
+
+#ifdef REQUEST_BEV_REGION
+                    static uint32_t frames_since_request = 0;
+                    if (BEV_REGION_RESEND_FRAMES <= ++frames_since_request) {
+                        request_bev_region();
+                        frames_since_request = 0;
+                    }
+#endif
+
+                    matrix.copyTo(matrix2);
 
-                camImageMatrix.copyTo(matrix);
-                matrix.copyTo(matrix2);
+                    if(std::getenv("CAR_ENV") != NULL) {
+                        cv::imwrite("bev.jpg", matrix);
+                    } 
 
-                if(std::getenv("CAR_ENV") != NULL) {
-                    cv::imwrite("bev.jpg", matrix);
-                } 
+#ifndef PATH_CONTROLLER
+                    int radius;
+                    cv::Point center;
+#endif
+
+#ifdef TRACK_LANE
+                    predict_lane(frame_time);
+                    ocLaneData predicted;
+                    if (lane_tracker.get_lane(&predicted)) {
+                        LaneCircle prediction = car_to_circle(predicted);
+                        double window = SEARCH_MARGIN + 3.0 * lane_tracker.get_offset_deviation() / CM_PER_PIXEL;
+                        helper.calculate_radius(&matrix, &matrix2, &prediction, window);
+                    } else {
+                        helper.calculate_radius(&matrix, &matrix2);
+                    }
+
+                    float center_x, center_y, radius_cm;
+                    circle_to_car(helper.lane, &center_x, &center_y, &radius_cm);
+                    lane_tracker.update(center_x, center_y, radius_cm, (float)helper.lane.confidence);
+
+#ifndef PATH_CONTROLLER
+                    // steer along the tracked lane, the same way as along a
+                    // measured one
+                    LaneCircle tracked = helper.lane;
+                    ocLaneData lane_data;
+                    if (lane_tracker.get_lane(&lane_data)) {
+                        tracked = car_to_circle(lane_data);
+                    }
+                    center = cv::Point((int)std::lround(tracked.center.x), (int)std::lround(tracked.center.y));
+                    radius = (int)std::lround(tracked.center.x < 200 ? -tracked.radius : tracked.radius);
+#endif
+#elif defined(PATH_CONTROLLER)
+                    helper.calculate_radius(&matrix, &matrix2);
+#else
+                    std::tie(center, radius) = helper.calculate_radius(&matrix, &matrix2);
+#endif
+                    ocLaneData current_lane = get_lane_data(frame_time, frame_number);
+                    send_lane_data(current_lane);
 
-                int radius;
-                cv::Point center;
+                    if(std::getenv("CAR_ENV") != NULL) {
+                        cv::imwrite("bev_lines.jpg", matrix2);
+                    }
 
-                std::tie(center, radius) = helper.calculate_radius(&matrix, &matrix2);
+#ifdef PATH_CONTROLLER
+                    set_control_lane(current_lane);
+#else
+                    float radius_in_cm = CM_PER_PIXEL * radius;
 
-                float radius_in_cm = 0.6 * radius;
+                    float height = 11.0;
+                    float angle = std::clamp<float>(square_approach.calc_angle(center, radius) + ANGLE_OFFSET_FRONT, -65, 65);
 
-                float height = 11.0;
-                float angle = std::clamp<float>(square_approach.calc_angle(center, radius) + ANGLE_OFFSET_FRONT, -65, 65);
+                    //add_last_angle(angle);
 
-                //add_last_angle(angle);
+                    //angle = get_oldest_angle();
 
-                //angle = get_oldest_angle();
+                    float direction = abs(radius_in_cm)/radius_in_cm;
 
-                float direction = abs(radius_in_cm)/radius_in_cm;
+                    /*angle = abs(std::asin(height / radius_in_cm) * (180/3.14)) * direction;
+                    if(abs(radius_in_cm) <= height) {
+                        angle = 450 * direction;
+                    }
 
-                /*angle = abs(std::asin(height / radius_in_cm) * (180/3.14)) * direction;
-                if(abs(radius_in_cm) <= height) {
-                    angle = 450 * direction;
-                }
+                    angle+=ANGLE_OFFSET_FRONT;
+                    angle = std::clamp<float>(std::pow(abs(angle), 1.35)*direction, -65,65);*/
 
-                angle+=ANGLE_OFFSET_FRONT;
-                angle = std::clamp<float>(std::pow(abs(angle), 1.35)*direction, -65,65);*/
 
+                    //add_last_angle(angle);
 
-                //add_last_angle(angle);
+                    //angle = get_oldest_angle();
+    /*
+                    float lowestY = 0;
+                    float destX = 0;
 
-                //angle = get_oldest_angle();
-/*
-                float lowestY = 0;
-                float destX = 0;
+                    for (double pi = 0; pi < 3.14; pi += 0.01) {
+                        float x = center.x + std::cos(pi) * radius;
+                        float y = center.y + std::sin(pi) * radius;
 
-                for (double pi = 0; pi < 3.14; pi += 0.01) {
-                    float x = center.x + std::cos(pi) * radius;
-                    float y = center.y + std::sin(pi) * radius;
+                        if(x > 400 || x < 0 || y > 400 || y < 0) {
+                            continue;
+                        }
 
-                    if(x > 400 || x < 0 || y > 400 || y < 0) {
-                        continue;
+                        if(y < lowestY) {
+                            lowestY = y;
+                            destX = x;
+                        }
                     }
 
-                    if(y < lowestY) {
-                        lowestY = y;
-                        destX = x;
+                    std::cout << "DESTX: " << destX;
+
+                    cv::line(matrix2, cv::Point(400, lowestY), cv::Point(0, lowestY), cv::Scalar(100,0,255,0), 3);
+                    cv::circle(matrix2, cv::Point(destX, lowestY), 5, cv::Scalar(0,0,255,0), 5);
+    */
+                    int speed = 60;
+
+                    /*double speed_multiplikator = 0;
+                    double normalized_radius = std::clamp<double>(std::abs(radius)/1000, 0, 1);
+                
+                    if(normalized_radius >= 0.5) {
+                        speed_multiplikator = 1-2*std::pow((1-normalized_radius),2);
+                    } else {
+                        speed_multiplikator = 2*std::pow((normalized_radius),2);
                     }
-                }
 
-                std::cout << "DESTX: " << destX;
+                    speed += speed_multiplikator*20;*/
 
-                cv::line(matrix2, cv::Point(400, lowestY), cv::Point(0, lowestY), cv::Scalar(100,0,255,0), 3);
-                cv::circle(matrix2, cv::Point(destX, lowestY), 5, cv::Scalar(0,0,255,0), 5);
-*/
-                if(std::getenv("CAR_ENV") != NULL) {
-                    cv::imwrite("bev_lines.jpg", matrix2);
-                }
+                    //auto [front_angle, back_angle] = drive_circle_in_angle(angle);
 
-                int speed = 60;
+                    //speed = std::clamp(speed, 0, 120);
 
-                /*double speed_multiplikator = 0;
-                double normalized_radius = std::clamp<double>(std::abs(radius)/1000, 0, 1);
-                
-                if(normalized_radius >= 0.5) {
-                    speed_multiplikator = 1-2*std::pow((1-normalized_radius),2);
-                } else {
-                    speed_multiplikator = 2*std::pow((normalized_radius),2);
-                }
-
-                speed += speed_multiplikator*20;*/
-
-                //auto [front_angle, back_angle] = drive_circle_in_angle(angle);
-
-                //speed = std::clamp(speed, 0, 120);
-
-
-                //logger->log("Radius in cm %f, ANGLE: %f, BANGLE: %f, DESTX: %d", radius_in_cm, front_angle, back_angle, destX);
-                if(std::getenv("CAR_ENV") != NULL) {
-                    logger->log("Radius in cm %f, ANGLE: %f", radius_in_cm, angle);
-                }
-
-                ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
-                ipc_packet.set_message_id(ocMessageId::Lane_Detection_Values);
-                ipc_packet.clear_and_edit()
-                    .write<int16_t>(speed)
-                    .write<int8_t>(angle)
-                    .write<int8_t>(-angle);
-                socket->send_packet(ipc_packet);
-
-            /*
-
-                if((check_if_on_street(histogram_unten) && onStreet)) {
-                    ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
-                    ipc_packet.set_message_id(ocMessageId::Lane_Detection_Values);
-                    ipc_packet.clear_and_edit()
-                        .write<int16_t>(30)
-                        .write<int8_t>(front_angle)
-                        .write<int8_t>(back_angle);
-                    socket->send_packet(ipc_packet);
-                } else if(check_if_on_street(histogram_unten) && !onStreet) {
-                    ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
-                    ipc_packet.set_message_id(ocMessageId::Lane_Detection_Values);
-                    ipc_packet.clear_and_edit()
-                        .write<int16_t>(-30)
-                        .write<int8_t>(-front_angle)
-                        .write<int8_t>(0); 
-                    socket->send_packet(ipc_packet);
-                    
-                    if(onStreetCount > 15) {
-                        onStreet = true;
-                        onStreetCount = 0;
-                    } else {
-                        onStreetCount++;
+
+                    //logger->log("Radius in cm %f, ANGLE: %f, BANGLE: %f, DESTX: %d", radius_in_cm, front_angle, back_angle, destX);
+                    if(std::getenv("CAR_ENV") != NULL) {
+                        logger->log("Radius in cm %f, ANGLE: %f", radius_in_cm, angle);
                     }
+
+                    last_steering_front = (int8_t)angle;
+                    last_steering_rear  = (int8_t)-angle;
+                    socket->send(ocLaneDetectionValues{
+                        .speed          = (int16_t)speed,
+                        .steering_front = last_steering_front,
+                        .steering_rear  = last_steering_rear,
+                        .frame_time     = frame_time
+                    });
+#endif
+
+                /*
+
+                    if((check_if_on_street(histogram_unten) && onStreet)) {
+                        ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
+                        ipc_packet.set_message_id(ocMessageId::Lane_Detection_Values);
+                        ipc_packet.clear_and_edit()
+                            .write<int16_t>(30)
+                            .write<int8_t>(front_angle)
+                            .write<int8_t>(back_angle);
+                        socket->send_packet(ipc_packet);
+                    } else if(check_if_on_street(histogram_unten) && !onStreet) {
+                        ipc_packet.set_sender(ocMemberId::Lane_Detection_Values);
+                        ipc_packet.set_message_id(ocMessageId::Lane_Detection_Values);
+                        ipc_packet.clear_and_edit()
+                            .write<int16_t>(-30)
+                            .write<int8_t>(-front_angle)
+                            .write<int8_t>(0); 
+                        socket->send_packet(ipc_packet);
+                    
+                        if(onStreetCount > 15) {
+                            onStreet = true;
+                            onStreetCount = 0;
+                        } else {
+                            onStreetCount++;
+                        }
                     
-                } else if (!onStreet){
-                    return_to_street(front_angle, histogram_unten);
-                }*/
-            } break;
-            default:
+                    } else if (!onStreet){
+                        return_to_street(front_angle, histogram_unten);
+                    }*/
+                } break;
+                case ocMessageId::Received_Odo_Steps:
+                {
+                    auto reader = ipc_packet.read_from_start();
+                    int32_t steps = reader.read<int32_t>();
+                    ocTime  time  = reader.read<ocTime>();
+                    motion_history.add_odometry(time, steps);
+                } break;
+                case ocMessageId::Start_Driving_Task:
                 {
-                    ocMessageId msg_id = ipc_packet.get_message_id();
-                    ocMemberId  mbr_id = ipc_packet.get_sender();
-                    logger->warn("Unhandled message_id: %s (0x%x) from sender: %s (%i)", to_string(msg_id), msg_id, to_string(mbr_id), mbr_id);
+                    // The car follows the task from about now on.
+                    ocStartDrivingTask task;
+                    if (!ipc_packet.read(&task)) break;
+                    motion_history.add_command(ocTime::now(), task.speed, task.steering_front, task.steering_rear);
                 } break;
+                default:
+                    {
+                        ocMessageId msg_id = ipc_packet.get_message_id();
+                        ocMemberId  mbr_id = ipc_packet.get_sender();
+                        logger->warn("Unhandled message_id: %s (0x%x) from sender: %s (%i)", to_string(msg_id), msg_id, to_string(mbr_id), mbr_id);
+                    } break;
+            }
+        }
+        if (socket_status < 0) {
+            logger->error("Error reading the IPC socket: (%i) %s", errno, strerror(errno));
+            running = false;
         }
     }
 
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Looks for lane markings along semicircles in front of the car. The pixels
+// of every circle are computed once, without duplicates and ordered by their
+// angle from the right to the left. A frame then only costs gathering those
+// pixels into a 1-D profile and a few passes over it. The search can also be
+// limited to a range of angles, then the rest of the circle isn't read.
+class PolarScanner {
+    public:
+        // A marking is a run of brighter pixels, it starts where the profile
+        // rises by more than EDGE_STEP and ends where it falls by that much.
+        static constexpr int EDGE_STEP = 5;
+        // brighter pixels are glare and can't start or end a marking
+        static constexpr int MAX_BRIGHTNESS = 235;
+        // maximum distance in pixels between the two edges of a marking
+        static constexpr double MAX_LINE_WIDTH = 10.0;
+
+        PolarScanner(cv::Point center, const int *radii, size_t radius_count, int width, int height) {
+            for (size_t i = 0; i < radius_count; ++i) {
+                Ring ring;
+                ring.radius = radii[i];
+                // The edges are compared over 0.01 and 0.03 rad, which is
+                // a number of pixels along the circle.
+                ring.near = std::max(1, (int)std::lround(0.01 * ring.radius));
+                ring.far = std::max(ring.near + 1, (int)std::lround(0.03 * ring.radius));
+
+                // A quarter pixel per step doesn't skip any pixel.
+                double step = 0.25 / ring.radius;
+                for (double angle = 0; angle <= CV_PI; angle += step) {
+                    int x = center.x + (int)std::round(std::cos(angle) * ring.radius);
+                    int y = center.y - (int)std::round(std::sin(angle) * ring.radius);
+                    if (x < 0 || x >= width || y < 0 || y >= height) {
+                        continue;
+                    }
+                    if (!ring.pixels.empty() && ring.pixels.back() == cv::Point(x, y)) {
+                        continue;
+                    }
+                    ring.pixels.push_back(cv::Point(x, y));
+                    ring.angles.push_back((float)angle);
+                }
+                rings.push_back(std::move(ring));
+            }
+        }
+
+        size_t ring_count() const {
+            return rings.size();
+        }
+
+        int radius(size_t ring) const {
+            return rings[ring].radius;
+        }
+
+        // Returns the middle of every marking that crosses the given circle
+        // between the two angles, ordered by angle. 0 is to the right of the
+        // center and pi to the left. The list is reused by the next call.
+        const std::vector<cv::Point> &find_lines(const cv::Mat &image, size_t ring_index, double angle_begin = 0, double angle_end = CV_PI) {
+            const Ring &ring = rings[ring_index];
+            lines.clear();
+
+            size_t first = std::lower_bound(ring.angles.begin(), ring.angles.end(), (float)angle_begin) - ring.angles.begin();
+            size_t last = std::upper_bound(ring.angles.begin(), ring.angles.end(), (float)angle_end) - ring.angles.begin();
+            if (last <= first) {
+                return lines;
+            }
+            const cv::Point *pixels = ring.pixels.data() + first;
+            const int count = (int)(last - first);
+            profile.resize(count);
+            for (int i = 0; i < count; ++i) {
+                profile[i] = image.at<uint8_t>(pixels[i].y, pixels[i].x);
+            }
+
+            // Plain loops over flat arrays, so the compiler vectorizes them.
+            const int scan_count = count - ring.far;
+            if (scan_count <= 0) {
+                return lines;
+            }
+            rising.resize(scan_count);
+            falling.resize(scan_count);
+            const int16_t *p = profile.data();
+            for (int i = 0; i < scan_count; ++i) {
+                int near = p[i + ring.near] - p[i];
+                int far = p[i + ring.far] - p[i];
+                bool usable = p[i] <= MAX_BRIGHTNESS;
+                rising[i] = usable & (near > EDGE_STEP) & (far > EDGE_STEP);
+                falling[i] = usable & (-near > EDGE_STEP) & (-far > EDGE_STEP);
+            }
+
+            // The last rise before a fall starts the marking.
+            int rise = -1;
+            for (int i = 0; i < scan_count; ++i) {
+                if (rising[i]) {
+                    rise = i;
+                } else if (falling[i] && 0 <= rise) {
+                    cv::Point a = pixels[rise];
+                    cv::Point b = pixels[i];
+                    if (cv::norm(a - b) <= MAX_LINE_WIDTH) {
+                        lines.push_back(cv::Point((a.x + b.x) / 2, (a.y + b.y) / 2));
+                        rise = -1;
+                    }
+                }
+            }
+            return lines;
+        }
+
+        // Sets every pixel of the mask that find_lines looks at.
+        void mark_pixels(cv::Mat &mask) const {
+            for (const Ring &ring : rings) {
+                for (const cv::Point &pixel : ring.pixels) {
+                    mask.at<uint8_t>(pixel.y, pixel.x) = 1;
+                }
+            }
+        }
+
+    private:
+        struct Ring {
+            int radius;
+            // profile distance of the two pixels an edge is compared with
+            int near;
+            int far;
+            std::vector<cv::Point> pixels;
+            // angle of every pixel, ascending
+            std::vector<float> angles;
+        };
+
+        std::vector<Ring> rings;
+        std::vector<int16_t> profile;
+        std::vector<uint8_t> rising;
+        std::vector<uint8_t> falling;
+        std::vector<cv::Point> lines;
+};
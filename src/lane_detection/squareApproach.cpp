@@ -20,7 +20,7 @@ class SquareApproach {
 
             for(; is_pi(center.x > 200, pi); pi+=eps) {
                 int x = center.x + std::cos(pi) * radius;
-                int y = -50 + std::sin(pi) * radius;
+                int y = (400 - center.y) + std::sin(pi) * radius;
 
                 if(last_x == x && last_y == y) {
                     continue;
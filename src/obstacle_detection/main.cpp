@@ -1,5 +1,9 @@
 #include <iostream>
+#include "../common/ocFramePool.h"
 #include "../common/ocMember.h"
+#include "../common/ocPollEngine.h"
+
+#include <cstring> // strerror()
 
 #include <chrono>
 #include <thread>
@@ -67,36 +71,72 @@ int main(int argc,char* argv[])
     // Some functionality of the ocMember is put in separate types. We grab
     // pointers to them here so we don't have to call the getters every time.
     ocIpcSocket* socket = member.get_socket();
-    ocSharedMemory* shared_memory = member.get_shared_memory();
     ocLogger*    logger = member.get_logger();
 
-    while (true)
+    ocFrameNotifier* cam_notifier = member.get_frame_notifier(ocImageType::Cam);
+    if (!cam_notifier)
     {
-        ocCamData *cam_data = &shared_memory->cam_data[shared_memory->last_written_cam_data_index];
+        logger->error("There is no frame pool to get camera frames from.");
+        return -1;
+    }
 
-        int type = CV_8UC1;
-        if (3 == bytes_per_pixel(cam_data->pixel_format)) type = CV_8UC3;
-        if (4 == bytes_per_pixel(cam_data->pixel_format)) type = CV_8UC4;
-        if (12 == bytes_per_pixel(cam_data->pixel_format)) type = CV_32FC3;
+    // We wake up once for every new camera frame. The socket is only watched
+    // so we notice when the IPC hub goes away.
+    ocPollEngine pe(2);
+    pe.add_fd(cam_notifier->get_fd());
+    pe.add_fd(socket->get_fd());
 
-        cv::Mat cam_image((int)cam_data->height, (int)cam_data->width, type);
-        cam_image.data = cam_data->img_buffer;
+    ocPacket ipc_packet;
+    bool running = true;
+    while (running)
+    {
+        pe.await();
 
-        const double percent = CalcObstacleCoverage(cam_image);
+        if (pe.was_triggered(socket->get_fd()))
+        {
+            int32_t socket_status;
+            while (0 < (socket_status = socket->read_packet(ipc_packet, false))) {}
+            if (socket_status < 0)
+            {
+                logger->error("Error while reading the IPC socket: (%i) %s", errno, strerror(errno));
+                running = false;
+            }
+        }
 
-        if (percent >= THRESHOLD)
+        if (!pe.was_triggered(cam_notifier->get_fd())) continue;
+
+        // The coverage is computed directly on the frame in the pool, the
+        // lease keeps the camera from reusing it in the meantime.
+        double percent = 0.0;
+        ocDetectedObject obstacle = {};
+        obstacle.object_type = ocObjectType::Obstacle;
+        ocFrameLease cam_frame = cam_notifier->next_frame();
+        bool got_frame = (bool)cam_frame;
+        if (got_frame)
         {
-            ocPacket s(ocMessageId::Object_Found);
-            s.clear_and_edit().write(percent);
-            socket->send_packet(s);
+            obstacle.frame_number = cam_frame->frame_number;
+            obstacle.frame_time   = cam_frame->frame_time;
+            int type = CV_8UC1;
+            if (3 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_8UC3;
+            if (4 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_8UC4;
+            if (12 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_32FC3;
+
+            cv::Mat cam_image((int)cam_frame->height, (int)cam_frame->width, type, (void *)cam_frame.get_data());
+            percent = CalcObstacleCoverage(cam_image);
+            cam_frame.release();
+        }
+
+        if (got_frame && percent >= THRESHOLD)
+        {
+            // The coverage doesn't tell how far away the obstacle is, so the
+            // distance and length stay 0.
+            socket->send(obstacle);
             logger->warn((std::string("Obstacle detected: ") + std::to_string(percent)).c_str());
         }
         if (verbose)
         {
             logger->warn(std::to_string(percent).c_str());
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-
     }
 
     logger->warn("Obstacle-Detection: Process Shutdown.");
@@ -32,6 +32,10 @@ int main()
     ocHistoryBuffer<ocTime, uint32_t> read_packets_history(12);
     ocHistoryBuffer<ocTime, uint32_t> sent_bytes_history(12);
     ocHistoryBuffer<ocTime, uint32_t> read_bytes_history(12);
+    ocHistoryBuffer<ocTime, uint32_t> dropped_packets_history(12);
+    ocHistoryBuffer<ocTime, uint32_t> queued_packets_history(12);
+    ocHistoryBuffer<ocTime, uint32_t> lease_held_max_history(12);
+    ocHistoryBuffer<ocTime, uint32_t> skipped_slots_history(12);
     ocHistoryBuffer<ocTime, int16_t> speed_history(1000);
     ocHistoryBuffer<ocTime, uint32_t> steps_history(1000);
     ocHistoryBuffer<ocTime, int16_t> target_speed_history(1000);
@@ -49,6 +53,10 @@ int main()
     float read_packets_scale    = 0.5f;
     float sent_bytes_scale      = 0.002f;
     float read_bytes_scale      = 0.002f;
+    float dropped_packets_scale = 0.5f;
+    float queued_packets_scale  = 0.5f;
+    float lease_held_max_scale  = 0.002f;
+    float skipped_slots_scale   = 1.0f;
     float speed_scale           = 1.0f;
     float steps_scale           = 1.0f;
     float target_speed_scale    = 1.0f;
@@ -66,6 +74,10 @@ int main()
     float read_packets_offset    = 0.0f;
     float sent_bytes_offset      = 0.0f;
     float read_bytes_offset      = 0.0f;
+    float dropped_packets_offset = 0.0f;
+    float queued_packets_offset  = 0.0f;
+    float lease_held_max_offset  = 0.0f;
+    float skipped_slots_offset   = 0.0f;
     float speed_offset           = 200.0f;
     float steps_offset           = 1.0f;
     float target_speed_offset    = 200.0f;
@@ -116,12 +128,24 @@ int main()
                     read_packets_history.push(now, reader.read<uint32_t>());
                     sent_bytes_history.push(now, reader.read<uint32_t>());
                     read_bytes_history.push(now, reader.read<uint32_t>());
+                    // older hubs don't send queue stats
+                    dropped_packets_history.push(now, reader.read_or_default<uint32_t>(0));
+                    queued_packets_history.push(now, reader.read_or_default<uint32_t>(0));
+                    // frame lease stats: count, average and max held time in us, skipped slots
+                    if (reader.can_read<uint32_t, uint32_t, uint32_t, uint32_t>())
+                    {
+                        reader.skip<uint32_t, uint32_t>();
+                        lease_held_max_history.push(now, reader.read<uint32_t>());
+                        skipped_slots_history.push(now, reader.read<uint32_t>());
+                    }
                 } break;
                 case ocMessageId::Start_Driving_Task:
                 {
-                    target_speed_history.push(now, reader.read<int16_t>());
-                    steering_front_history.push(now, reader.read<int8_t>());
-                    steering_rear_history.push(now, reader.read<int8_t>());
+                    ocStartDrivingTask task;
+                    if (!recv_packet.read(&task)) break;
+                    target_speed_history.push(now, task.speed);
+                    steering_front_history.push(now, task.steering_front);
+                    steering_rear_history.push(now, task.steering_rear);
                 } break;
                 case ocMessageId::Received_Odo_Steps:
                 {
@@ -203,6 +227,54 @@ int main()
                 x0 = x1;
                 y0 = y1;
             }
+            for (int x0 = 0, y0 = 0; auto &[time, value] : dropped_packets_history)
+            {
+                int x1 = (int)((float)display_width * ((time - oldest) / window_length));
+                int y1 = display_height - (int)((float)value * dropped_packets_scale + dropped_packets_offset);
+                if (0 != x0)
+                {
+                    cv::line(display, cv::Point(x0, y0), cv::Point(x1, y1), cv::Scalar(16.0, 127.0, 255.0), 2);
+                }
+                if (x1 < 0) break;
+                x0 = x1;
+                y0 = y1;
+            }
+            for (int x0 = 0, y0 = 0; auto &[time, value] : queued_packets_history)
+            {
+                int x1 = (int)((float)display_width * ((time - oldest) / window_length));
+                int y1 = display_height - (int)((float)value * queued_packets_scale + queued_packets_offset);
+                if (0 != x0)
+                {
+                    cv::line(display, cv::Point(x0, y0), cv::Point(x1, y1), cv::Scalar(16.0, 255.0, 255.0), 2);
+                }
+                if (x1 < 0) break;
+                x0 = x1;
+                y0 = y1;
+            }
+            for (int x0 = 0, y0 = 0; auto &[time, value] : lease_held_max_history)
+            {
+                int x1 = (int)((float)display_width * ((time - oldest) / window_length));
+                int y1 = display_height - (int)((float)value * lease_held_max_scale + lease_held_max_offset);
+                if (0 != x0)
+                {
+                    cv::line(display, cv::Point(x0, y0), cv::Point(x1, y1), cv::Scalar(255.0, 127.0, 16.0), 2);
+                }
+                if (x1 < 0) break;
+                x0 = x1;
+                y0 = y1;
+            }
+            for (int x0 = 0, y0 = 0; auto &[time, value] : skipped_slots_history)
+            {
+                int x1 = (int)((float)display_width * ((time - oldest) / window_length));
+                int y1 = display_height - (int)((float)value * skipped_slots_scale + skipped_slots_offset);
+                if (0 != x0)
+                {
+                    cv::line(display, cv::Point(x0, y0), cv::Point(x1, y1), cv::Scalar(127.0, 255.0, 16.0), 2);
+                }
+                if (x1 < 0) break;
+                x0 = x1;
+                y0 = y1;
+            }
             for (int x0 = 0, y0 = 0; auto &[time, value] : speed_history)
             {
                 int x1 = (int)((float)display_width * ((time - oldest) / window_length));
@@ -0,0 +1,137 @@
+#include "CascadeEngine.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Same as detectMultiScale uses to group the objects of all scales.
+static constexpr double GROUP_EPS = 0.2;
+
+CascadeEngine::CascadeEngine(uint32_t threadCount, double scaleFactor, int minNeighbors)
+    : m_Workers(threadCount), m_ScaleFactor(scaleFactor), m_MinNeighbors(minNeighbors)
+{
+    // The tasks are spread over the worker pool already, OpenCV's own
+    // threads would only compete with it.
+    cv::setNumThreads(0);
+    m_ClassifierSets.resize(m_Workers.get_concurrency());
+    for (size_t set = 0; set < m_ClassifierSets.size(); ++set)
+    {
+        m_FreeSets.push_back(set);
+    }
+}
+
+bool CascadeEngine::AddClassifier(const std::string& path)
+{
+    // Copies of a CascadeClassifier share their data, so every set loads
+    // its own.
+    for (size_t set = 0; set < m_ClassifierSets.size(); ++set)
+    {
+        cv::CascadeClassifier classifier;
+        if (!classifier.load(path))
+        {
+            for (size_t loaded = 0; loaded < set; ++loaded) m_ClassifierSets[loaded].pop_back();
+            return false;
+        }
+        m_ClassifierSets[set].push_back(classifier);
+    }
+    m_WindowSizes.push_back(m_ClassifierSets[0].back().getOriginalWindowSize());
+    m_Detections.emplace_back();
+    return true;
+}
+
+void CascadeEngine::SetSearchRegion(const SignSearchRegion& region)
+{
+    m_Region = region;
+}
+
+void CascadeEngine::Detect(const cv::Mat& gray)
+{
+    const size_t classifierCount = m_WindowSizes.size();
+    for (std::vector<cv::Rect>& detections : m_Detections) detections.clear();
+    if (0 == classifierCount) return;
+
+    cv::Rect region((int)std::lround(m_Region.x * (float)gray.cols), (int)std::lround(m_Region.y * (float)gray.rows),
+                    (int)std::lround(m_Region.width * (float)gray.cols), (int)std::lround(m_Region.height * (float)gray.rows));
+    region &= cv::Rect(0, 0, gray.cols, gray.rows);
+    if (region.empty()) return;
+
+    // Levels get smaller by the scale factor, until even the smallest
+    // classifier window doesn't fit anymore.
+    cv::Size smallestWindow = m_WindowSizes[0];
+    for (const cv::Size& size : m_WindowSizes)
+    {
+        smallestWindow.width = std::min(smallestWindow.width, size.width);
+        smallestWindow.height = std::min(smallestWindow.height, size.height);
+    }
+    m_LevelScales.clear();
+    for (double scale = 1.0; ; scale *= m_ScaleFactor)
+    {
+        if (region.width / scale < smallestWindow.width || region.height / scale < smallestWindow.height) break;
+        m_LevelScales.push_back(scale);
+    }
+    const size_t levelCount = m_LevelScales.size();
+    if (0 == levelCount) return;
+
+    // Every level is scaled from the full region, like detectMultiScale does.
+    // The Mats keep their memory from frame to frame.
+    m_Pyramid.resize(levelCount);
+    m_Workers.run((uint32_t)levelCount, [&](uint32_t level)
+    {
+        cv::Mat source = gray(region);
+        if (0 == level)
+        {
+            m_Pyramid[0] = source;
+            return;
+        }
+        cv::Size size((int)std::lround(region.width / m_LevelScales[level]), (int)std::lround(region.height / m_LevelScales[level]));
+        cv::resize(source, m_Pyramid[level], size, 0, 0, cv::INTER_LINEAR);
+    });
+
+    // The big levels come first, so the slowest tasks don't end up last.
+    m_Candidates.resize(levelCount * classifierCount);
+    m_Workers.run((uint32_t)(levelCount * classifierCount), [&](uint32_t task)
+    {
+        size_t level = task / classifierCount;
+        size_t classifier = task % classifierCount;
+        std::vector<cv::Rect>& candidates = m_Candidates[task];
+        candidates.clear();
+        const cv::Mat& image = m_Pyramid[level];
+        const cv::Size window = m_WindowSizes[classifier];
+        if (image.cols < window.width || image.rows < window.height) return;
+
+        size_t set;
+        {
+            std::lock_guard<std::mutex> lock(m_FreeSetsMutex);
+            set = m_FreeSets.back();
+            m_FreeSets.pop_back();
+        }
+        // Without neighbours the raw objects come back, they are grouped
+        // over all levels below. The window size is fixed, so only this
+        // level gets scanned.
+        m_ClassifierSets[set][classifier].detectMultiScale(image, candidates, m_ScaleFactor, 0, 0, window, window);
+        {
+            std::lock_guard<std::mutex> lock(m_FreeSetsMutex);
+            m_FreeSets.push_back(set);
+        }
+
+        const double scale = m_LevelScales[level];
+        for (cv::Rect& rect : candidates)
+        {
+            rect = cv::Rect(region.x + (int)std::lround(rect.x * scale), region.y + (int)std::lround(rect.y * scale),
+                            (int)std::lround(rect.width * scale), (int)std::lround(rect.height * scale));
+        }
+    });
+
+    for (size_t classifier = 0; classifier < classifierCount; ++classifier)
+    {
+        std::vector<cv::Rect>& detections = m_Detections[classifier];
+        for (size_t level = 0; level < levelCount; ++level)
+        {
+            const std::vector<cv::Rect>& candidates = m_Candidates[level * classifierCount + classifier];
+            detections.insert(detections.end(), candidates.begin(), candidates.end());
+        }
+        cv::groupRectangles(detections, m_MinNeighbors, GROUP_EPS);
+    }
+}
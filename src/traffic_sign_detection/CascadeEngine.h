@@ -0,0 +1,60 @@
+#pragma once
+#include "../common/ocWorkerPool.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/objdetect.hpp>
+
+// Part of the camera image that is searched for signs, as fractions of the
+// image size.
+struct SignSearchRegion
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 1.0f;
+    float height = 1.0f;
+};
+
+// Runs several cascade classifiers on the same image, like calling
+// detectMultiScale for each of them, but the image pyramid is built once per
+// frame and every pair of pyramid level and classifier is a task on a
+// worker pool.
+class CascadeEngine
+{
+public:
+    CascadeEngine(uint32_t threadCount, double scaleFactor, int minNeighbors);
+
+    // Returns false if the cascade couldn't be loaded, it isn't added then.
+    bool AddClassifier(const std::string& path);
+    void SetSearchRegion(const SignSearchRegion& region);
+
+    // Finds the objects of all classifiers in a gray image.
+    void Detect(const cv::Mat& gray);
+    // The objects classifier number i found in the last image, in image
+    // coordinates.
+    const std::vector<cv::Rect>& GetDetections(size_t classifier) const { return m_Detections[classifier]; }
+
+    uint32_t GetConcurrency() const { return m_Workers.get_concurrency(); }
+
+private:
+    ocWorkerPool m_Workers;
+    double m_ScaleFactor;
+    int m_MinNeighbors;
+    SignSearchRegion m_Region;
+
+    // OpenCV's classifiers aren't thread safe, so there is one copy of all of
+    // them per thread. A task takes a free set and gives it back afterwards.
+    std::vector<std::vector<cv::CascadeClassifier>> m_ClassifierSets;
+    std::vector<size_t> m_FreeSets;
+    std::mutex m_FreeSetsMutex;
+    std::vector<cv::Size> m_WindowSizes;
+
+    std::vector<cv::Mat> m_Pyramid;
+    std::vector<double> m_LevelScales;
+    // unmerged objects per level and classifier
+    std::vector<std::vector<cv::Rect>> m_Candidates;
+    std::vector<std::vector<cv::Rect>> m_Detections;
+};
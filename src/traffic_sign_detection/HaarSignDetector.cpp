@@ -1,5 +1,9 @@
 #include "HaarSignDetector.h"
 
+#include "../common/ocFrameNotifier.h"
+#include "../common/ocPollEngine.h"
+
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -17,16 +21,28 @@
 #include <opencv2/videoio.hpp>
 
 static ocIpcSocket* s_Socket = nullptr;
-static ocSharedMemory* s_SharedMemory = nullptr;
+static ocFrameNotifier* s_CamNotifier = nullptr;
 static ocLogger* s_Logger = nullptr;
 static bool s_SupportGUI = false;
+static SignSearchRegion s_SearchRegion;
+static uint32_t s_ThreadCount = 0;
+
+void HaarSignDetector::SetSearchRegion(const SignSearchRegion& region)
+{
+    s_SearchRegion = region;
+}
 
-void HaarSignDetector::Init(ocIpcSocket* socket, ocSharedMemory* shared_memory, ocLogger* logger, bool supportGUI)
+void HaarSignDetector::SetThreadCount(uint32_t threadCount)
 {
-    SignDetector::Init(socket, shared_memory, logger, supportGUI);
+    s_ThreadCount = threadCount;
+}
+
+void HaarSignDetector::Init(ocIpcSocket* socket, ocFrameNotifier* cam_notifier, ocLogger* logger, bool supportGUI)
+{
+    SignDetector::Init(socket, cam_notifier, logger, supportGUI);
     logger->log("SignDetector::Init()");
     s_Socket = socket;
-    s_SharedMemory = shared_memory;
+    s_CamNotifier = cam_notifier;
     s_Logger = logger;
     s_SupportGUI = supportGUI;
     Run();
@@ -56,59 +72,96 @@ std::filesystem::path HaarSignDetector::GetParkSignXML()
 
 struct ClassifierInstance
 {
-    cv::CascadeClassifier classifier;
     std::string label;
     TrafficSignType type;
     double signSizeFactor;
     bool seenLastFrame = false;
 
-    ClassifierInstance(const std::string& path, const std::string& signLabel, TrafficSignType signType, double sizeFactor)
+    ClassifierInstance(const std::string& signLabel, TrafficSignType signType, double sizeFactor)
     {
-        classifier.load(path);
         label = signLabel;
         type = signType;
         signSizeFactor = sizeFactor;
     }
 };
 
+// The classifiers of s_Engine, in the same order.
 static std::vector<std::shared_ptr<ClassifierInstance>> s_Instances;
 
+static void AddClassifier(CascadeEngine& engine, const std::filesystem::path& path, const std::string& label, TrafficSignType type, double sizeFactor)
+{
+    if (!engine.AddClassifier(path.string()))
+    {
+        s_Logger->error("Could not load the %s sign classifier from %s", label.c_str(), path.c_str());
+        return;
+    }
+    s_Instances.push_back(std::make_shared<ClassifierInstance>(label, type, sizeFactor));
+}
+
 void HaarSignDetector::Run()
 {
+    // All classifiers share one image pyramid per frame. Image_Processing runs
+    // next to us, so one core is left for the other processes and the rest is
+    // split between the two, we get the rounded down half.
+    uint32_t threadCount = s_ThreadCount;
+    if (!threadCount)
+    {
+        uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::max(1u, (coreCount - 1) / 2);
+    }
+    CascadeEngine engine(threadCount - 1, 1.3, 5);
+    engine.SetSearchRegion(s_SearchRegion);
+    s_Logger->log("Detecting signs on %u threads in x %.2f y %.2f width %.2f height %.2f of the image",
+        engine.GetConcurrency(), s_SearchRegion.x, s_SearchRegion.y, s_SearchRegion.width, s_SearchRegion.height);
+
     // Load sign cascade classifiers
-    s_Instances.push_back(std::make_shared<ClassifierInstance>(GetStopSignXML().string(), "Stop", TrafficSignType::Stop, 0.3));
-    s_Instances.push_back(std::make_shared<ClassifierInstance>(GetLeftSignXML().string(), "Left", TrafficSignType::Left, 0.2));
-    s_Instances.push_back(std::make_shared<ClassifierInstance>(GetRightSignXML().string(), "Right", TrafficSignType::Right, 0.2));
-    s_Instances.push_back(std::make_shared<ClassifierInstance>(GetPrioritySignXML().string(), "Priority", TrafficSignType::PriorityRoad, 0.25));
-    s_Instances.push_back(std::make_shared<ClassifierInstance>(GetParkSignXML().string(), "Park", TrafficSignType::Park, 0.32));
+    AddClassifier(engine, GetStopSignXML(), "Stop", TrafficSignType::Stop, 0.3);
+    AddClassifier(engine, GetLeftSignXML(), "Left", TrafficSignType::Left, 0.2);
+    AddClassifier(engine, GetRightSignXML(), "Right", TrafficSignType::Right, 0.2);
+    AddClassifier(engine, GetPrioritySignXML(), "Priority", TrafficSignType::PriorityRoad, 0.25);
+    AddClassifier(engine, GetParkSignXML(), "Park", TrafficSignType::Park, 0.32);
+
+    // Wake up once for every new camera frame. Frames that arrive while the
+    // classifiers are running are skipped, we always get the newest one.
+    ocPollEngine pe(1);
+    pe.add_fd(s_CamNotifier->get_fd());
 
     while (true)
     {
-        // Fetch Camera Data
-        ocCamData *cam_data = &s_SharedMemory->cam_data[s_SharedMemory->last_written_cam_data_index];
-
-        int type = CV_8UC1;
-        if (3 == bytes_per_pixel(cam_data->pixel_format)) type = CV_8UC3;
-        if (4 == bytes_per_pixel(cam_data->pixel_format)) type = CV_8UC4;
-        if (12 == bytes_per_pixel(cam_data->pixel_format)) type = CV_32FC3;
-
-        cv::Mat cam_image((int)cam_data->height, (int)cam_data->width, type);
-        cam_image.data = cam_data->img_buffer;
+        pe.await();
 
+        // Fetch Camera Data. The classifiers only look at our gray copy, so
+        // the frame goes back to the pool before we start detecting.
+        cv::Mat cam_image;
         cv::Mat gray;
-        cv::cvtColor(cam_image, gray, cv::COLOR_BGR2GRAY);
-
-        // Iterate over all the XML Classifier Instances and detect the signs
-        for (auto& signClassifier : s_Instances)
+        ocFrameLease cam_frame = s_CamNotifier->next_frame();
+        if (!cam_frame) continue;
+        int type = CV_8UC1;
+        if (3 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_8UC3;
+        if (4 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_8UC4;
+        if (12 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_32FC3;
+
+        int cam_width  = (int)cam_frame->width;
+        int cam_height = (int)cam_frame->height;
+        cv::Mat frame(cam_height, cam_width, type, (void *)cam_frame.get_data());
+        // Only the GUI draws into the color image.
+        if (s_SupportGUI) frame.copyTo(cam_image);
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        cam_frame.release();
+
+        // Detect the signs of all classifiers at once, then iterate over
+        // what each of them found
+        engine.Detect(gray);
+        for (size_t classifier = 0; classifier < s_Instances.size(); ++classifier)
         {
-            std::vector<cv::Rect> sign_scaled;
-            signClassifier->classifier.detectMultiScale(gray, sign_scaled, 1.3, 5);
+            auto& signClassifier = s_Instances[classifier];
+            const std::vector<cv::Rect>& sign_scaled = engine.GetDetections(classifier);
 
             // Detect the sign, x,y = origin points, w = width, h = height
             for (size_t i = 0; i < sign_scaled.size(); i++)
             {
                 cv::Rect roi = sign_scaled[i];
-                const uint32_t distance = ConvertRectToDistanceInCM(roi, (int)cam_data->width, (int)cam_data->height, signClassifier->signSizeFactor);
+                const uint32_t distance = ConvertRectToDistanceInCM(roi, cam_width, cam_height, signClassifier->signSizeFactor);
 
                 if (distance <= 8) continue;
 
@@ -139,8 +192,6 @@ void HaarSignDetector::Run()
                 break;
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(4));
-        
     }
 
 }
\ No newline at end of file
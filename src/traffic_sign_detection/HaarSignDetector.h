@@ -1,12 +1,20 @@
 #pragma once
 #include "SignDetector.h"
+#include "CascadeEngine.h"
 
 class HaarSignDetector : public SignDetector
 {
 public:
-    virtual void Init(ocIpcSocket* socket, ocSharedMemory* shared_memory, ocLogger* logger, bool supportGUI) override;
+    virtual void Init(ocIpcSocket* socket, ocFrameNotifier* cam_notifier, ocLogger* logger, bool supportGUI) override;
     virtual void Run() override;
 
+    // Only this part of the camera image is searched, the whole image by
+    // default. Must be set before Init().
+    void SetSearchRegion(const SignSearchRegion& region);
+
+    // How many threads detect signs, including the calling one. 0 takes a
+    // share of the cores. Must be set before Init().
+    void SetThreadCount(uint32_t threadCount);
 
     static std::filesystem::path GetStopSignXML();
     static std::filesystem::path GetLeftSignXML();
@@ -14,15 +14,15 @@
 #include <opencv2/videoio.hpp>
 
 static ocIpcSocket* s_Socket = nullptr;
-static ocSharedMemory* s_SharedMemory = nullptr;
+static ocFrameNotifier* s_CamNotifier = nullptr;
 static ocLogger* s_Logger = nullptr;
 static bool s_SupportGUI = false;
 
-void SignDetector::Init(ocIpcSocket* socket, ocSharedMemory* shared_memory, ocLogger* logger, bool supportGUI)
+void SignDetector::Init(ocIpcSocket* socket, ocFrameNotifier* cam_notifier, ocLogger* logger, bool supportGUI)
 {
     logger->log("SignDetector::Init()");
     s_Socket = socket;
-    s_SharedMemory = shared_memory;
+    s_CamNotifier = cam_notifier;
     s_Logger = logger;
     s_SupportGUI = supportGUI;
 }
@@ -39,7 +39,9 @@ uint32_t SignDetector::ConvertRectToDistanceInCM(const cv::Rect& rect, const int
 
 void SignDetector::SendPacket(TrafficSign sign)
 {
-    ocPacket s(ocMessageId::Traffic_Sign_Detected);
-    s.clear_and_edit().write((uint16_t)sign.type).write(sign.distanceCM);
-    s_Socket->send_packet(s);
+    ocTrafficSignDetected detected = {
+        .sign_type = (uint16_t)sign.type,
+        .distance  = sign.distanceCM
+    };
+    s_Socket->send(detected);
 }
\ No newline at end of file
@@ -10,7 +10,7 @@
 class SignDetector
 {
 public:
-    virtual void Init(ocIpcSocket* socket, ocSharedMemory* shared_memory, ocLogger* logger, bool supportGUI);
+    virtual void Init(ocIpcSocket* socket, ocFrameNotifier* cam_notifier, ocLogger* logger, bool supportGUI);
     virtual void Run() = 0;
 
     static float ConvertRectSizeToEstimatedDistance(float rectSize, double sizeFactor);
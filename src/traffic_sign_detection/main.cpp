@@ -4,6 +4,7 @@
 #include "SignDetector.h"
 #include "HaarSignDetector.h"
 #include <chrono>
+#include <cstdio>
 #include <thread>
 #include <string>
 #include <vector>
@@ -14,15 +15,36 @@ int main(int argc,char* argv[])
 
     // Parsing Params
     bool supportGUI = true;
+    // --roi x,y,width,height as fractions of the camera image, e.g.
+    // --roi 0.5,0,0.5,0.6 for the upper part of the right half
+    SignSearchRegion searchRegion;
+    bool validRegion = true;
+    // --threads N to detect on N threads instead of a share of the cores
+    uint32_t threadCount = 0;
     std::vector<std::string> params{argv, argv+argc};
-    for (auto i : params)
+    for (size_t i = 0; i < params.size(); ++i)
     {
-        if (i == "--nogui" || i == "--headless")
+        if (params[i] == "--nogui" || params[i] == "--headless")
         {
             supportGUI = false;
         }
+        if (params[i] == "--roi" && i + 1 < params.size())
+        {
+            validRegion = 4 == std::sscanf(params[i + 1].c_str(), "%f,%f,%f,%f",
+                &searchRegion.x, &searchRegion.y, &searchRegion.width, &searchRegion.height);
+        }
+        if (params[i] == "--threads" && i + 1 < params.size())
+        {
+            std::sscanf(params[i + 1].c_str(), "%u", &threadCount);
+        }
+    }
+    HaarSignDetector* haarDetector = new HaarSignDetector();
+    if (validRegion)
+    {
+        haarDetector->SetSearchRegion(searchRegion);
     }
-    detector = new HaarSignDetector();
+    haarDetector->SetThreadCount(threadCount);
+    detector = haarDetector;
 
     std::this_thread::sleep_for(std::chrono::milliseconds(8000));
     // ocMember represents the interface to the IPC system
@@ -35,10 +57,21 @@ int main(int argc,char* argv[])
     // Some functionality of the ocMember is put in separate types. We grab
     // pointers to them here so we don't have to call the getters every time.
     ocIpcSocket* socket = member.get_socket();
-    ocSharedMemory* shared_memory = member.get_shared_memory();
+    ocFrameNotifier* cam_notifier = member.get_frame_notifier(ocImageType::Cam);
     ocLogger*    logger = member.get_logger();
 
-    detector->Init(socket, shared_memory, logger, supportGUI);
+    if (!validRegion)
+    {
+        logger->warn("Could not read the --roi parameter, searching the whole image.");
+    }
+
+    if (!cam_notifier)
+    {
+        logger->error("There is no frame pool to get camera frames from.");
+        return -1;
+    }
+
+    detector->Init(socket, cam_notifier, logger, supportGUI);
 
     logger->warn("Traffic-Sign-Detection: Process Shutdown.");
 
@@ -1,5 +1,6 @@
 #include "../common/ocAlarm.h"
 #include "../common/ocConst.h"
+#include "../common/ocFramePool.h"
 #include "../common/ocMember.h"
 #include "../common/ocPacket.h"
 #include "../common/ocSdfRenderer.h"
@@ -31,7 +32,7 @@ int main(int argc, char** argv)
     std::string filename = argv[1];
 
     member.attach();
-    ocSharedMemory *shared_memory = member.get_shared_memory();
+    ocFramePool *frame_pool = member.get_frame_pool();
     ocIpcSocket *socket = member.get_socket();
 
     ocPacket ipc_packet;
@@ -72,16 +73,15 @@ int main(int argc, char** argv)
         window = new oc::Window(200, 60, "Video Input", false);
     }
 
-    if (OC_CAM_BUFFER_SIZE < width * height * channels)
+    if (!frame_pool)
     {
-        logger->error("Error: Video image is larger than the space in the shared memory!");
+        logger->error("Error: There is no frame pool to put the video images into!");
         return -1;
     }
 
     logger->log("size: { w: %i, h: %i, d: %i }", width, height, channels);
 
     uint32_t frame_number = 0; // for the ipc, should never decrease. 
-    uint32_t index = 0;
     uint32_t video_frame_number = 0; // for displaying the progress bar, can go forward, backward, whatever 
 
     ocAlarm timer(ocTime::seconds_float(frame_time), ocAlarmType::Periodic);
@@ -236,33 +236,39 @@ int main(int argc, char** argv)
 
         ocTime frame_time = ocTime::now();
 
-        // Grab the frame from the shared memory that we want to write to and
-        // write all the frame info into it
-        ocCamData *cam_data = &shared_memory->cam_data[index];
-        cam_data->frame_time   = frame_time;
-        cam_data->frame_number = frame_number;
-        cam_data->width        = width;
-        cam_data->height       = height;
+        // Grab a frame from the pool that we can write to and write all the
+        // frame info into it
+        ocFrame *cam_frame = frame_pool->acquire_for_write(width * height * channels);
+        if (!cam_frame)
+        {
+            logger->warn("No free frame in the frame pool, skipping frame %u.", frame_number);
+            continue;
+        }
+        uint8_t *cam_buffer = frame_pool->get_data(cam_frame);
+        cam_frame->frame_time   = frame_time;
+        cam_frame->frame_number = frame_number;
+        cam_frame->width        = width;
+        cam_frame->height       = height;
         switch (channels)
         {
             case 1:
             {
-                cam_data->pixel_format = ocPixelFormat::Gray_U8;
+                cam_frame->pixel_format = ocPixelFormat::Gray_U8;
             } break;
             case 3:
             {
-                cam_data->pixel_format = ocPixelFormat::Bgr_U8;
+                cam_frame->pixel_format = ocPixelFormat::Bgr_U8;
             } break;
             case 4:
             {
-                cam_data->pixel_format = ocPixelFormat::Bgra_U8;
+                cam_frame->pixel_format = ocPixelFormat::Bgra_U8;
             } break;
         }
 
         if (image_input.data != nullptr)
         {
             // If our input is just an image, copy it over.
-            memcpy(cam_data->img_buffer, image_input.data, width * height * channels);
+            memcpy(cam_buffer, image_input.data, width * height * channels);
         }
         else
         {
@@ -273,7 +279,7 @@ int main(int argc, char** argv)
 
             if (video_input.read(video_frame))
             {
-                memcpy(cam_data->img_buffer, video_frame.data, width * height * channels);
+                memcpy(cam_buffer, video_frame.data, width * height * channels);
             }
             else
             {
@@ -283,19 +289,19 @@ int main(int argc, char** argv)
             }
         }
 
-        shared_memory->last_written_cam_data_index = index;
+        ocFrameHandle handle = frame_pool->get_handle(cam_frame);
+        frame_pool->publish(cam_frame, ocImageType::Cam);
+        frame_pool->release(cam_frame);
 
-        // Announce, that the image is now ready in the shared memory
+        // Announce, that the image is now ready in the frame pool
         ipc_packet.set_message_id(ocMessageId::Camera_Image_Available);
         ipc_packet.clear_and_edit()
             .write<ocTime>(frame_time)
             .write<uint32_t>(frame_number)
-            .write<ptrdiff_t>((std::byte *)cam_data - (std::byte *)shared_memory)
-            .write<size_t>(sizeof(*cam_data));
+            .write<ocFrameHandle>(handle);
         socket->send_packet(ipc_packet);
 
         frame_number += 1;
-        index = (index + 1) % OC_NUM_CAM_BUFFERS;
         if (!resend)
         {
             video_frame_number += 1;
@@ -1,4 +1,6 @@
 #include "../common/ocArgumentParser.h"
+#include "../common/ocFramePool.h"
+#include "../common/ocFrameSlot.h"
 #include "../common/ocMember.h"
 #include "../common/ocCommon.h"
 
@@ -13,6 +15,10 @@
 #include <cstring> // strerror()
 #include <csignal>
 
+// Image_Processing may have been restarted, so the request for the whole
+// BEV is sent again after this many frames.
+#define BEV_REGION_RESEND_FRAMES 100
+
 static bool running = true;
 
 static void signal_handler(int)
@@ -20,6 +26,18 @@ static void signal_handler(int)
     running = false;
 }
 
+// Image_Processing only renders the parts of the lane BEV that others ask
+// for, but the recording needs all of it. Without it, the request is taken
+// back.
+static void request_whole_bev(ocIpcSocket *socket, bool whole = true)
+{
+    ocPacket packet(ocMessageId::Bev_Region_Request);
+    packet.clear_and_edit()
+        .write(ocBevViewId::Lane)
+        .write<uint32_t>(whole ? OC_BEV_WHOLE_VIEW : 0);
+    socket->send_packet(packet);
+}
+
 cv::Mat static convert(cv::Mat cam_image, ocPixelFormat pixel_format, bool gray, ocLogger *logger)
 {
     if (gray)
@@ -146,23 +164,36 @@ int main(int argc, const char **argv)
         filename.ends_with(".jpg") ||
         filename.ends_with(".jpeg"))
     {
-        ocCamData *cam_data = &shared_memory->cam_data[shared_memory->last_written_cam_data_index];
-
-        int type = CV_8UC1;
-        if (3 == bytes_per_pixel(cam_data->pixel_format)) type = CV_8UC3;
-        if (4 == bytes_per_pixel(cam_data->pixel_format)) type = CV_8UC4;
-        if (12 == bytes_per_pixel(cam_data->pixel_format)) type = CV_32FC3;
-
-        cv::Mat cam_image((int)cam_data->height, (int)cam_data->width, type);
-        cam_image.data = cam_data->img_buffer;
+        cv::Mat cam_image;
+        uint32_t cam_width  = 0;
+        uint32_t cam_height = 0;
+        ocPixelFormat pixel_format = ocPixelFormat::None;
+        ocFrameLease cam_frame = member.lease_latest_frame(ocImageType::Cam);
+        if (!cam_frame)
+        {
+            logger->error("There is no camera frame in the frame pool.");
+            return -1;
+        }
+        {
+            int type = CV_8UC1;
+            if (3 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_8UC3;
+            if (4 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_8UC4;
+            if (12 == bytes_per_pixel(cam_frame->pixel_format)) type = CV_32FC3;
+
+            cam_width    = cam_frame->width;
+            cam_height   = cam_frame->height;
+            pixel_format = cam_frame->pixel_format;
+            cv::Mat((int)cam_height, (int)cam_width, type, (void *)cam_frame.get_data()).copyTo(cam_image);
+        }
+        cam_frame.release();
 
         if (crop_hor || crop_ver)
         {
-            if (!crop_hor) crop.width  = (int)cam_data->width;
-            if (!crop_ver) crop.height = (int)cam_data->height;
-            if ((int)cam_data->width < crop.x + crop.width || (int)cam_data->height < crop.y + crop.height)
+            if (!crop_hor) crop.width  = (int)cam_width;
+            if (!crop_ver) crop.height = (int)cam_height;
+            if ((int)cam_width < crop.x + crop.width || (int)cam_height < crop.y + crop.height)
             {
-                logger->error("Crop size (x: %i, y: %i, w: %i, h: %i) does not fit source size (w: %i, h: %i).", crop.x, crop.y, crop.width, crop.height, cam_data->width, cam_data->height);
+                logger->error("Crop size (x: %i, y: %i, w: %i, h: %i) does not fit source size (w: %i, h: %i).", crop.x, crop.y, crop.width, crop.height, cam_width, cam_height);
                 return -1;
             }
             cam_image = cam_image(crop);
@@ -175,7 +206,7 @@ int main(int argc, const char **argv)
             cv::resize(cam_image, cam_image, new_size);
         }
 
-        cam_image = convert(cam_image, cam_data->pixel_format, gray, logger);
+        cam_image = convert(cam_image, pixel_format, gray, logger);
 
         cv::imwrite(filename.data(), cam_image);
         return 0;
@@ -185,6 +216,7 @@ int main(int argc, const char **argv)
     s.clear_and_edit()
         .write(bevRecording ? ocMessageId::Birdseye_Image_Available : ocMessageId::Camera_Image_Available);
     socket->send_packet(s);
+    if (bevRecording) request_whole_bev(socket);
 
     ocPacket recv_packet;
 
@@ -207,7 +239,22 @@ int main(int argc, const char **argv)
                 ocBufferReader reader = recv_packet.read_from_start();
                 uint8_t bit;
                 reader.read(&bit);
-                cv::Mat image(400, 400, CV_8UC1, shared_memory->bev_data[0].img_buffer);
+                static uint32_t frames_since_request = 0;
+                if (BEV_REGION_RESEND_FRAMES <= ++frames_since_request)
+                {
+                    request_whole_bev(socket);
+                    frames_since_request = 0;
+                }
+                cv::Mat image;
+                bool got_frame = read_frame(shared_memory->bev_data[0], [&](const ocBevData &bev_data)
+                {
+                    cv::Mat(400, 400, CV_8UC1, (void *)bev_data.img_buffer).copyTo(image);
+                });
+                if (!got_frame)
+                {
+                    logger->warn("Not keeping up with video stream. BEV image was overwritten.");
+                    break;
+                }
                 if (!video_writer.isOpened())
                 {
                     int32_t width    = 400;
@@ -237,23 +284,22 @@ int main(int argc, const char **argv)
             } break;
             case ocMessageId::Camera_Image_Available:            
             {
-                uint32_t newest_frame_index = shared_memory->last_written_cam_data_index;
-                ocCamData *cam_data = &shared_memory->cam_data[newest_frame_index];
-                uint32_t newest_frame_number = cam_data->frame_number;
-
                 uint32_t frame_number;
+                ocFrameHandle frame_handle;
                 recv_packet.read_from_start()
                     .skip<ocTime>()
-                    .read(&frame_number);
-                if (frame_number != newest_frame_number)
+                    .read(&frame_number)
+                    .read(&frame_handle);
+                ocFrameLease cam_frame = member.lease_frame(frame_handle);
+                if (!cam_frame)
                 {
-                    logger->warn("Not keeping up with video stream. Processing frame %i while newest is %i", frame_number, newest_frame_number);
+                    logger->warn("Not keeping up with video stream. Frame %i is not in the frame pool anymore.", frame_number);
                 }
                 else
                 {
-                    int32_t width    = (int32_t)cam_data->width;
-                    int32_t height   = (int32_t)cam_data->height;
-                    ocPixelFormat pf = cam_data->pixel_format;
+                    int32_t width    = (int32_t)cam_frame->width;
+                    int32_t height   = (int32_t)cam_frame->height;
+                    ocPixelFormat pf = cam_frame->pixel_format;
                     bool is_color = !gray && (pf != ocPixelFormat::Gray_U8);
 
                     if (!video_writer.isOpened())
@@ -282,10 +328,10 @@ int main(int argc, const char **argv)
                     if (4 == bytes_per_pixel(pf)) type = CV_8UC4;
                     if (12 == bytes_per_pixel(pf)) type = CV_32FC3;
 
-                    cv::Mat cam_image(height, width, type);
-                    cam_image.data = cam_data->img_buffer;
-
-                    cam_image = cam_image(crop);
+                    // Only the cropped part is copied out of the frame pool.
+                    cv::Mat cam_image;
+                    cv::Mat(height, width, type, (void *)cam_frame.get_data())(crop).copyTo(cam_image);
+                    cam_frame.release();
 
                     if (-1 != new_w || -1 != new_h)
                     {
@@ -294,7 +340,7 @@ int main(int argc, const char **argv)
                         cv::resize(cam_image, cam_image, new_size);
                     }
 
-                    cam_image = convert(cam_image, cam_data->pixel_format, gray, logger);
+                    cam_image = convert(cam_image, pf, gray, logger);
 
                     video_writer << cam_image;
                 }
@@ -315,6 +361,7 @@ int main(int argc, const char **argv)
         }
     } // End while
 
+    if (bevRecording) request_whole_bev(socket, false);
     socket->send(ocMessageId::Disconnect_Me);
     return 0;
 }
@@ -1,3 +1,5 @@
+#include "../common/ocFramePool.h"
+#include "../common/ocFrameSlot.h"
 #include "../common/ocMember.h"
 #include "../common/ocProfiler.h"
 #include "../common/ocSdfRenderer.h"
@@ -198,11 +200,14 @@ int main()
         {
             TIMED_BLOCK("Update Camera Image");
             update_cam = false;
-            const ocCamData *cam_data = &shared_memory->cam_data[shared_memory->last_written_cam_data_index];
-            cam_width  = cam_data->width;
-            cam_height = cam_data->height;
-            cam_buffer = (float *)realloc((void *)cam_buffer, cam_width * cam_height * bytes_per_pixel(ocPixelFormat::Rgb_F32));
-            convert_to_rgb_f32(cam_data->pixel_format, cam_data->img_buffer, cam_width, cam_height, cam_buffer, cam_width, cam_height);
+            ocFrameLease cam_frame = member.lease_latest_frame(ocImageType::Cam);
+            if (cam_frame)
+            {
+                cam_width  = cam_frame->width;
+                cam_height = cam_frame->height;
+                cam_buffer = (float *)realloc((void *)cam_buffer, cam_width * cam_height * bytes_per_pixel(ocPixelFormat::Rgb_F32));
+                convert_to_rgb_f32(cam_frame->pixel_format, cam_frame.get_data(), cam_width, cam_height, cam_buffer, cam_width, cam_height);
+            }
         }
         if (draw_cam)
         {
@@ -231,13 +236,14 @@ int main()
         }
         if (update_bin)
         {
-            update_bin = false;
             TIMED_BLOCK("Update Binary Image");
-            const ocBinData *bin_data = &shared_memory->bin_data[shared_memory->last_written_bin_data_index];
-            bin_width = bin_data->width;
-            bin_height = bin_data->height;
-            bin_buffer = (float *)realloc((void *)bin_buffer, bin_width * bin_height * bytes_per_pixel(ocPixelFormat::Rgb_F32));
-            convert_to_rgb_f32(ocPixelFormat::Gray_U8, bin_data->img_buffer, bin_width, bin_height, bin_buffer, bin_width, bin_height);
+            update_bin = !read_newest_frame(shared_memory->bin_data, shared_memory->last_written_bin_data_index, [&](const ocBinData &bin_data)
+            {
+                bin_width = bin_data.width;
+                bin_height = bin_data.height;
+                bin_buffer = (float *)realloc((void *)bin_buffer, bin_width * bin_height * bytes_per_pixel(ocPixelFormat::Rgb_F32));
+                convert_to_rgb_f32(ocPixelFormat::Gray_U8, bin_data.img_buffer, bin_width, bin_height, bin_buffer, bin_width, bin_height);
+            });
         }
         if (draw_bin)
         {
@@ -254,12 +260,13 @@ int main()
         if (update_bev)
         {
             TIMED_BLOCK("Update BEV Image");
-            update_bev = false;
-            const ocBevData *bev_data = &shared_memory->bev_data[shared_memory->last_written_bev_data_index];
-            bev_width  = (uint32_t)(bev_data->max_map_x - bev_data->min_map_x);
-            bev_height = (uint32_t)(bev_data->max_map_y - bev_data->min_map_y);
-            bev_buffer = (float *)realloc((void *)bev_buffer, bev_width * bev_height * bytes_per_pixel(ocPixelFormat::Rgb_F32));
-            convert_to_rgb_f32(ocPixelFormat::Gray_U8, bev_data->img_buffer, bev_width, bev_height, bev_buffer, bev_width, bev_height);
+            update_bev = !read_newest_frame(shared_memory->bev_data, shared_memory->last_written_bev_data_index, [&](const ocBevData &bev_data)
+            {
+                bev_width  = (uint32_t)(bev_data.max_map_x - bev_data.min_map_x);
+                bev_height = (uint32_t)(bev_data.max_map_y - bev_data.min_map_y);
+                bev_buffer = (float *)realloc((void *)bev_buffer, bev_width * bev_height * bytes_per_pixel(ocPixelFormat::Rgb_F32));
+                convert_to_rgb_f32(ocPixelFormat::Gray_U8, bev_data.img_buffer, bev_width, bev_height, bev_buffer, bev_width, bev_height);
+            });
         }
         if (draw_bev)
         {
@@ -6,6 +6,7 @@
 #include "../common/ocCarConfig.h"
 #include "../common/ocConfigFileReader.h"
 #include "../common/ocFileWatcher.h"
+#include "../common/ocFramePool.h"
 #include "../common/ocMember.h"
 #include "../common/ocPollEngine.h"
 #include "../common/ocProfiler.h"
@@ -20,6 +21,7 @@
 
 #include <cerrno> // errno
 #include <cmath>
+#include <vector>
 
 #include "detections/detection.h"
 #include "detections/crosswalk_detection.h"
@@ -101,7 +103,7 @@ int main(int argc, const char** argv)
     member.attach();
 
     ocIpcSocket *socket = member.get_socket();
-    ocSharedMemory *shared_memory = member.get_shared_memory();
+    ocFramePool *frame_pool = member.get_frame_pool();
 
     ocTime reaction_time = ocTime::milliseconds(50);
     ocTime frame_time    = ocTime::hertz(30.0f);
@@ -240,6 +242,12 @@ int main(int argc, const char** argv)
             }
         }
         car_properties.cam.pixel_format = pixel_format;
+
+        if (!frame_pool)
+        {
+            logger->error("The virtual camera needs the frame pool of the IPC hub.");
+            return -1;
+        }
     }
 
     DrawContext draw_context = {
@@ -461,7 +469,8 @@ int main(int argc, const char** argv)
     }
 
     uint32_t frame_number = 0;
-    uint32_t frame_index = 0;
+    // the renderer needs somewhere to put the image if the pool is full
+    std::vector<uint8_t> dropped_image;
 
 /*
     ocTime fps_prev_time = ocTime::now();
@@ -626,12 +635,13 @@ int main(int argc, const char** argv)
                 } break;
                 case ocMessageId::Start_Driving_Task:
                 {
-                    auto reader = ipc_packet.read_from_start();
-                    int16_t speed = reader.read<int16_t>();
-                    int8_t sf = reader.read<int8_t>();
-                    int8_t sr = reader.read<int8_t>();
-                    uint8_t nr = reader.read<uint8_t>();
-                    int32_t steps = reader.read<int32_t>();
+                    ocStartDrivingTask task;
+                    if (!ipc_packet.read(&task)) break;
+                    int16_t speed = task.speed;
+                    int8_t sf = task.steering_front;
+                    int8_t sr = task.steering_rear;
+                    uint8_t nr = task.id;
+                    int32_t steps = task.steps_ab;
                     if (!car_states[0].rc_is_active)
                     {
                         car_actions[0].speed = speed;
@@ -716,28 +726,36 @@ int main(int argc, const char** argv)
             oc_assert(ocVirtualizationMode::Virtual_Camera == virtualization_mode);
             rendering_done = true;
 
-            ocCamData *cam_data = &shared_memory->cam_data[frame_index];
-            uint8_t *cam_buffer = cam_data->img_buffer;
-
-            renderer.get_rendered_image(cam_buffer, (size_t)image_width * bytes_per_pixel(pixel_format));
-
-            cam_data->width        = (uint32_t)image_width;
-            cam_data->height       = (uint32_t)image_height;
-            cam_data->pixel_format = pixel_format;
-            cam_data->frame_number = frame_number;
-            cam_data->frame_time   = frame_car_time;
-            shared_memory->last_written_cam_data_index = frame_index;
-
-            ipc_packet.set_message_id(ocMessageId::Camera_Image_Available);
-            ipc_packet.clear_and_edit()
-                .write<ocTime>(frame_car_time)
-                .write<uint32_t>(frame_number)
-                .write<ptrdiff_t>((std::byte *)cam_data - (std::byte *)shared_memory)
-                .write<size_t>(sizeof(*cam_data));
-            send_packet(ipc_packet);
+            size_t image_size = (size_t)(image_width * image_height) * bytes_per_pixel(pixel_format);
+            ocFrame *cam_frame = frame_pool->acquire_for_write(image_size);
+            if (cam_frame)
+            {
+                renderer.get_rendered_image(frame_pool->get_data(cam_frame), (size_t)image_width * bytes_per_pixel(pixel_format));
+
+                cam_frame->width        = (uint32_t)image_width;
+                cam_frame->height       = (uint32_t)image_height;
+                cam_frame->pixel_format = pixel_format;
+                cam_frame->frame_number = frame_number;
+                cam_frame->frame_time   = frame_car_time;
+                ocFrameHandle handle = frame_pool->get_handle(cam_frame);
+                frame_pool->publish(cam_frame, ocImageType::Cam);
+                frame_pool->release(cam_frame);
+
+                ipc_packet.set_message_id(ocMessageId::Camera_Image_Available);
+                ipc_packet.clear_and_edit()
+                    .write<ocTime>(frame_car_time)
+                    .write<uint32_t>(frame_number)
+                    .write<ocFrameHandle>(handle);
+                send_packet(ipc_packet);
+            }
+            else
+            {
+                dropped_image.resize(image_size);
+                renderer.get_rendered_image(dropped_image.data(), (size_t)image_width * bytes_per_pixel(pixel_format));
+                logger->warn("No free frame in the frame pool, dropping frame %u.", frame_number);
+            }
 
             frame_number += 1;
-            frame_index = (frame_index + 1) % OC_NUM_CAM_BUFFERS;
         }
 
         if (cam_timer.is_expired())
@@ -878,7 +896,6 @@ int main(int argc, const char** argv)
                 }
 
                 frame_number += 1;
-                frame_index = (frame_index + 1) % OC_NUM_CAM_BUFFERS;
             }
 
             if (show_ui)